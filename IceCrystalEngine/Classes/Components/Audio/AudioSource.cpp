@@ -1,10 +1,13 @@
 ﻿#include <iostream>
 #include <Ice/Components/Audio/AudioSource.h>
 #include <Ice/Resources/AudioClip.h>
+#include <Ice/Resources/AudioStream.h>
 #include <Ice/Managers/AudioManager.h>
 #include <Ice/Core/Actor.h>
 #include <Ice/Core/Transform.h>
 
+#include <cmath>
+
 AudioSource::AudioSource()
     : source(0)
     , clip(nullptr)
@@ -12,28 +15,20 @@ AudioSource::AudioSource()
     , pitch(1.0f)
     , looping(false)
     , playOnReady(false)
+    , playWhenLoaded(false)
+    , state(State::Stopped)
+    , virtualTime(0.0f)
+    , priority(128)
     , spatial(true)
     , minDistance(1.0f)
     , maxDistance(100.0f)
 {
-    alGenSources(1, &source);
-
-    alSourcef(source, AL_GAIN, volume);
-    alSourcef(source, AL_PITCH, pitch);
-    alSourcei(source, AL_LOOPING, AL_FALSE);
-    alSourcef(source, AL_REFERENCE_DISTANCE, minDistance);
-    alSourcef(source, AL_MAX_DISTANCE, maxDistance);
-    alSourcef(source, AL_ROLLOFF_FACTOR, 1.0f);
+    // No OpenAL source of its own, AudioManager hands one from its voice pool out while this is playing and audible
 }
 
 AudioSource::~AudioSource()
 {
-    if (source != 0)
-    {
-        alSourceStop(source);
-        alDeleteSources(1, &source);
-        source = 0;
-    }
+    Stop();
 }
 
 void AudioSource::Ready()
@@ -46,55 +41,73 @@ void AudioSource::Ready()
 
 void AudioSource::Update()
 {
+    if (playWhenLoaded && clip != nullptr && clip->IsLoaded())
+    {
+        Play();
+    }
+
     UpdatePosition();
 }
 
 void AudioSource::Play()
 {
-    if (clip == nullptr || !clip->IsLoaded())
+    if (clip == nullptr)
     {
         return;
     }
 
-    ALuint buf = spatial ? clip->GetMonoBuffer() : clip->GetBuffer();
-    alSourcei(source, AL_BUFFER, buf);
-    UpdatePosition();
-    alSourcePlay(source);
+    playWhenLoaded = !clip->IsLoaded();
+    if (playWhenLoaded)
+    {
+        return;
+    }
+
+    // Restarts from the beginning like alSourcePlay, on a new voice if one is free (and it can be heard)
+    ReleaseVoice();
+    virtualTime = 0.0f;
+    state = State::Playing;
+    AudioManager::GetInstance().OnSourcePlay(this);
 }
 
 void AudioSource::Pause()
 {
-    alSourcePause(source);
+    if (state != State::Playing)
+    {
+        return;
+    }
+
+    // A paused source doesnt need its voice, Resume picks it back up from here
+    ReleaseVoice();
+    state = State::Paused;
+    AudioManager::GetInstance().OnSourceStop(this);
 }
 
 void AudioSource::Stop()
 {
-    alSourceStop(source);
+    playWhenLoaded = false;
+    ReleaseVoice();
+    virtualTime = 0.0f;
+    state = State::Stopped;
+    AudioManager::GetInstance().OnSourceStop(this);
 }
 
 void AudioSource::Resume()
 {
-    ALint state;
-    alGetSourcei(source, AL_SOURCE_STATE, &state);
-
-    if (state == AL_PAUSED)
+    if (state == State::Paused)
     {
-        alSourcePlay(source);
+        state = State::Playing;
+        AudioManager::GetInstance().OnSourcePlay(this);
     }
 }
 
 bool AudioSource::IsPlaying() const
 {
-    ALint state;
-    alGetSourcei(source, AL_SOURCE_STATE, &state);
-    return state == AL_PLAYING;
+    return state == State::Playing && !HasVoiceFinished();
 }
 
 bool AudioSource::IsPaused() const
 {
-    ALint state;
-    alGetSourcei(source, AL_SOURCE_STATE, &state);
-    return state == AL_PAUSED;
+    return state == State::Paused;
 }
 
 void AudioSource::SetClip(AudioClip* clip)
@@ -111,25 +124,39 @@ void AudioSource::SetClip(const std::string& clipName)
 void AudioSource::SetVolume(float volume)
 {
     this->volume = glm::clamp(volume, 0.0f, 1.0f);
-    alSourcef(source, AL_GAIN, this->volume);
+    if (source != 0)
+        alSourcef(source, AL_GAIN, this->volume);
 }
 
 void AudioSource::SetPitch(float pitch)
 {
     this->pitch = glm::clamp(pitch, 0.1f, 3.0f);
-    alSourcef(source, AL_PITCH, this->pitch);
+    if (source != 0)
+        alSourcef(source, AL_PITCH, this->pitch);
 }
 
 void AudioSource::SetLooping(bool loop)
 {
     looping = loop;
-    alSourcei(source, AL_LOOPING, loop ? AL_TRUE : AL_FALSE);
+
+    // Streams loop by wrapping their reads, AL_LOOPING would loop just the queued buffers
+    if (stream != nullptr)
+    {
+        stream->SetLooping(loop);
+        return;
+    }
+    if (source != 0)
+        alSourcei(source, AL_LOOPING, loop ? AL_TRUE : AL_FALSE);
 }
 
 void AudioSource::SetSpatial(bool spatial)
 {
     this->spatial = spatial;
-    
+    if (source == 0)
+    {
+        return;
+    }
+
     if (spatial)
     {
         alSourcei(source, AL_SOURCE_RELATIVE, AL_FALSE);
@@ -146,30 +173,150 @@ void AudioSource::SetSpatial(bool spatial)
 void AudioSource::SetMinDistance(float distance)
 {
     minDistance = distance;
-    alSourcef(source, AL_REFERENCE_DISTANCE, minDistance);
+    if (source != 0)
+        alSourcef(source, AL_REFERENCE_DISTANCE, minDistance);
 }
 
 void AudioSource::SetMaxDistance(float distance)
 {
     maxDistance = distance;
-    alSourcef(source, AL_MAX_DISTANCE, maxDistance);
+    if (source != 0)
+        alSourcef(source, AL_MAX_DISTANCE, maxDistance);
 }
 
 void AudioSource::SetPlaybackTime(float seconds)
 {
+    if (source == 0)
+    {
+        virtualTime = std::max(0.0f, seconds);
+        return;
+    }
+
+    if (stream != nullptr)
+    {
+        stream->Seek(seconds);
+        return;
+    }
     alSourcef(source, AL_SEC_OFFSET, seconds);
 }
 
 float AudioSource::GetPlaybackTime() const
 {
+    if (source == 0)
+        return virtualTime;
+
+    if (stream != nullptr)
+        return stream->GetTime();
+
     float seconds = 0.0f;
     alGetSourcef(source, AL_SEC_OFFSET, &seconds);
     return seconds;
 }
 
-void AudioSource::UpdatePosition()
+void AudioSource::AssignVoice(ALuint voice)
+{
+    source = voice;
+    if (clip == nullptr)
+    {
+        return;
+    }
+
+    ApplyProperties();
+
+    // Picks up at virtualTime, 0 for a fresh Play
+    if (clip->IsStreaming())
+    {
+        stream = std::make_unique<AudioStream>(clip, source, spatial);
+        if (stream->Start(looping, virtualTime))
+            AudioManager::GetInstance().AddStream(stream.get());
+        else
+            stream.reset();
+        return;
+    }
+
+    ALuint buf = spatial ? clip->GetMonoBuffer() : clip->GetBuffer();
+    alSourcei(source, AL_BUFFER, buf);
+    alSourcef(source, AL_SEC_OFFSET, virtualTime);
+    alSourcePlay(source);
+}
+
+ALuint AudioSource::TakeVoice()
+{
+    if (source == 0)
+    {
+        return 0;
+    }
+
+    // Remember where it was so it can carry on virtually
+    virtualTime = GetPlaybackTime();
+    ReleaseStream();
+    alSourceStop(source);
+    alSourcei(source, AL_BUFFER, 0);
+
+    ALuint voice = source;
+    source = 0;
+    return voice;
+}
+
+void AudioSource::AdvanceVirtualTime(float deltaTime)
+{
+    if (state != State::Playing || source != 0 || clip == nullptr)
+    {
+        return;
+    }
+
+    virtualTime += deltaTime * pitch;
+
+    float duration = clip->GetDuration();
+    if (looping && duration > 0.0f && virtualTime >= duration)
+    {
+        virtualTime = std::fmod(virtualTime, duration);
+    }
+}
+
+bool AudioSource::HasVoiceFinished() const
+{
+    if (source == 0)
+    {
+        float duration = clip != nullptr ? clip->GetDuration() : 0.0f;
+        return !looping && duration > 0.0f && virtualTime >= duration;
+    }
+
+    if (stream != nullptr)
+    {
+        return stream->IsFinished();
+    }
+
+    ALint sourceState;
+    alGetSourcei(source, AL_SOURCE_STATE, &sourceState);
+    return sourceState == AL_STOPPED || sourceState == AL_INITIAL;
+}
+
+float AudioSource::GetAudibility(const glm::vec3& listener) const
 {
     if (!spatial || owner == nullptr)
+    {
+        return volume;
+    }
+    return AudioManager::GetAudibility(transform->position, listener, volume, minDistance, maxDistance);
+}
+
+void AudioSource::ApplyProperties()
+{
+    alSourcef(source, AL_GAIN, volume);
+    alSourcef(source, AL_PITCH, pitch);
+    alSourcei(source, AL_LOOPING, looping && !clip->IsStreaming() ? AL_TRUE : AL_FALSE);
+    alSourcef(source, AL_REFERENCE_DISTANCE, minDistance);
+    alSourcef(source, AL_MAX_DISTANCE, maxDistance);
+    alSourcef(source, AL_ROLLOFF_FACTOR, 1.0f);
+
+    // The voice could have been anything before, a one shot or a non spatial source
+    SetSpatial(spatial);
+}
+
+void AudioSource::UpdatePosition()
+{
+    if (!spatial || owner == nullptr || source == 0)
     {
         return;
     }
@@ -177,10 +324,8 @@ void AudioSource::UpdatePosition()
     glm::vec3 pos = transform->position;
     alSource3f(source, AL_POSITION, pos.x, pos.y, pos.z);
     
-    // Get listener position and calculate distance
-    float listenerPos[3];
-    alGetListener3f(AL_POSITION, &listenerPos[0], &listenerPos[1], &listenerPos[2]);
-    glm::vec3 listener(listenerPos[0], listenerPos[1], listenerPos[2]);
+    // Distance from the listener (AudioManager keeps its position, no need to ask OpenAL for it per source)
+    const glm::vec3& listener = AudioManager::GetInstance().GetListenerPosition();
     float distance = glm::length(pos - listener);
     if (distance > maxDistance)
     {
@@ -195,4 +340,21 @@ void AudioSource::UpdatePosition()
     {
         alSourcef(source, AL_GAIN, volume);
     }
+}
+
+void AudioSource::ReleaseStream()
+{
+    if (stream == nullptr)
+        return;
+
+    AudioManager::GetInstance().RemoveStream(stream.get());
+    stream.reset();
+}
+
+void AudioSource::ReleaseVoice()
+{
+    if (source == 0)
+        return;
+
+    AudioManager::GetInstance().ReturnVoice(TakeVoice());
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 ﻿#include <Ice/Components/LuaExecutor.h>
 
 #include <Ice/Managers/LuaManager.h>
+#include <Ice/Managers/HotReloadManager.h>
 
 LuaExecutor::LuaExecutor(std::string path)
 {
@@ -10,13 +11,47 @@ LuaExecutor::LuaExecutor(std::string path)
 void LuaExecutor::Execute()
 {
     if (filePath.size() > 0)
+    {
+        WatchFile();
+        LuaManager::GetInstance().RunExecutor(this);
+    }
+}
+
+void LuaExecutor::Reload()
+{
+    if (filePath.size() == 0)
+        return;
+
+    // Stop the old version (including anything waiting in wait()) before running the new one
+    LuaManager::GetInstance().StopExecutor(this);
     LuaManager::GetInstance().RunExecutor(this);
 }
 
 void LuaExecutor::Ready()
 {
     if (filePath.size() > 0 && runOnReady)
+    {
+        WatchFile();
         LuaManager::GetInstance().RunExecutor(this);
+    }
 }
 
-LuaExecutor::~LuaExecutor() {}
\ No newline at end of file
+void LuaExecutor::WatchFile()
+{
+    if (watchedPath == filePath)
+        return;
+
+    HotReloadManager& hotReloadManager = HotReloadManager::GetInstance();
+    hotReloadManager.Unwatch(reloadWatchId);
+    reloadWatchId = hotReloadManager.Watch(filePath, [this]() { Reload(); });
+    watchedPath = filePath;
+}
+
+LuaExecutor::~LuaExecutor()
+{
+    if (HotReloadManager::IsAlive())
+        HotReloadManager::GetInstance().Unwatch(reloadWatchId);
+
+    // The actor is gone, so are its coroutines and RunService callbacks
+    LuaManager::GetInstance().StopExecutor(this);
+}
\ No newline at end of file
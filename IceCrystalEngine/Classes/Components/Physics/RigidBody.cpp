@@ -29,7 +29,7 @@ void RigidBody::Ready()
         JPH::Vec3(pos.x, pos.y, pos.z),
         JPH::Quat(ToJolt(transform->rotation)),
         motionType,
-        0 // object layer
+        ResolveLayer()
     );
     settings.mIsSensor = isTrigger;
 
@@ -45,6 +45,11 @@ void RigidBody::Ready()
 
     JPH::EActivation activation = (motionType == JPH::EMotionType::Dynamic) ? JPH::EActivation::Activate : JPH::EActivation::DontActivate;
     PhysicsManager::GetInstance().GetSystem().GetBodyInterface().AddBody(body->GetID(), activation);
+
+    ResetPose();
+
+    if (isStatic)
+        PhysicsManager::GetInstance().MarkBroadPhaseDirty();
 }
 
 void RigidBody::Update()
@@ -82,31 +87,47 @@ void RigidBody::Update()
             // Clear velocities to prevent object from continuing previous motion when unpaused
             body->SetLinearVelocity(JPH::Vec3::sZero());
             body->SetAngularVelocity(JPH::Vec3::sZero());
+
+            // Dont blend back from where it was before the edit
+            ResetPose();
         }
         
         return;
     }
 
-    // Sync physics position back to actor transform (normal runtime behavior)
-    JPH::Vec3 pos;
-    JPH::Quat rot;
-    PhysicsManager::GetInstance().GetSystem().GetBodyInterface().GetPositionAndRotation(body->GetID(), pos, rot);
+    // The transform itself is written by PhysicsManager::SyncTransforms and the stay callbacks come from
+    // PhysicsManager::Step, both only for bodies that are awake
+}
+
+void RigidBody::DispatchStayCallbacks(float deltaTime)
+{
+    if (isStatic || (activeContacts.empty() && activeTriggers.empty()) || (!OnContacting && !OnTriggerStay))
+        return;
 
-    owner->transform->position = glm::vec3(pos.GetX(), pos.GetY(), pos.GetZ());
-    owner->transform->rotation = glm::quat(rot.GetW(), rot.GetX(), rot.GetY(), rot.GetZ());
+    stayTimer += deltaTime;
+    if (stayTimer < stayCallbackInterval)
+        return;
+    stayTimer = 0.0f;
 
-    // Fire OnContacting for all active contacts
-    for (RigidBody* other : activeContacts)
+    // A callback can end a contact (or destroy the other body), so go over a copy and skip whatever is gone by then
+    if (OnContacting)
     {
-        if (OnContacting)
-            OnContacting(other);
+        stayScratch.assign(activeContacts.begin(), activeContacts.end());
+        for (RigidBody* other : stayScratch)
+        {
+            if (OnContacting && activeContacts.count(other))
+                OnContacting(other);
+        }
     }
-    
-    // Fire OnTriggerStay for all active triggers
-    for (RigidBody* other : activeTriggers)
+
+    if (OnTriggerStay)
     {
-        if (OnTriggerStay)
-            OnTriggerStay(other);
+        stayScratch.assign(activeTriggers.begin(), activeTriggers.end());
+        for (RigidBody* other : stayScratch)
+        {
+            if (OnTriggerStay && activeTriggers.count(other))
+                OnTriggerStay(other);
+        }
     }
 }
 
@@ -118,6 +139,8 @@ RigidBody::~RigidBody() {
         // Only remove body if physics system is still running
         // During shutdown, Jolt cleans up all bodies automatically
         if (physicsManager.IsInitialized()) {
+            physicsManager.RemoveRigidBody(this);
+
             JPH::BodyInterface& bodyInterface = physicsManager.GetSystem().GetBodyInterface();
             JPH::BodyID bodyID = body->GetID();
             
@@ -129,6 +152,82 @@ RigidBody::~RigidBody() {
     }
 }
 
+void RigidBody::CapturePose(uint64_t step)
+{
+    if (!body) return;
+
+    capturedStep = step;
+
+    previousPosition = currentPosition;
+    previousRotation = currentRotation;
+
+    // Between steps nothing is writing to the body, so it can be read without a lock
+    currentPosition = ToGLM(JPH::Vec3(body->GetPosition()));
+    currentRotation = ToGLM(body->GetRotation());
+    currentLinearVelocity = ToGLM(body->GetLinearVelocity());
+    currentAngularVelocity = ToGLM(body->GetAngularVelocity());
+}
+
+void RigidBody::ResetPose()
+{
+    if (!body) return;
+
+    currentPosition = ToGLM(JPH::Vec3(body->GetPosition()));
+    currentRotation = ToGLM(body->GetRotation());
+    currentLinearVelocity = ToGLM(body->GetLinearVelocity());
+    currentAngularVelocity = ToGLM(body->GetAngularVelocity());
+    previousPosition = currentPosition;
+    previousRotation = currentRotation;
+}
+
+RigidBody::PoseState RigidBody::SavePose() const
+{
+    return { previousPosition, previousRotation, currentPosition, currentRotation, currentLinearVelocity, currentAngularVelocity, capturedStep };
+}
+
+void RigidBody::RestorePose(const PoseState& pose)
+{
+    previousPosition = pose.previousPosition;
+    previousRotation = pose.previousRotation;
+    currentPosition = pose.currentPosition;
+    currentRotation = pose.currentRotation;
+    currentLinearVelocity = pose.currentLinearVelocity;
+    currentAngularVelocity = pose.currentAngularVelocity;
+    capturedStep = pose.capturedStep;
+}
+
+void RigidBody::SyncTransform(float alpha, float stepDeltaTime)
+{
+    if (!owner) return;
+
+    // Sync physics position back to actor transform, using the poses captured after each step
+    switch (interpolation)
+    {
+    case Interpolation::None:
+        owner->transform->position = currentPosition;
+        owner->transform->rotation = currentRotation;
+        break;
+
+    case Interpolation::Interpolate:
+        owner->transform->position = glm::mix(previousPosition, currentPosition, alpha);
+        owner->transform->rotation = glm::slerp(previousRotation, currentRotation, alpha);
+        break;
+
+    case Interpolation::Extrapolate:
+    {
+        float time = alpha * stepDeltaTime;
+        owner->transform->position = currentPosition + currentLinearVelocity * time;
+
+        float angularSpeed = glm::length(currentAngularVelocity);
+        if (angularSpeed > 0.0001f)
+            owner->transform->rotation = glm::normalize(glm::angleAxis(angularSpeed * time, currentAngularVelocity / angularSpeed) * currentRotation);
+        else
+            owner->transform->rotation = currentRotation;
+        break;
+    }
+    }
+}
+
 void RigidBody::FireContactStarted(RigidBody* other)
 {
     activeContacts.insert(other);
@@ -169,6 +268,12 @@ void RigidBody::FireTriggerExited(RigidBody* other)
 
 
 
+void RigidBody::ForgetContact(RigidBody* other)
+{
+    activeContacts.erase(other);
+    activeTriggers.erase(other);
+}
+
 void RigidBody::AddForce(glm::vec3 force)
 {
     PhysicsManager::GetInstance().GetSystem().GetBodyInterface().ActivateBody(body->GetID());
@@ -217,6 +322,25 @@ bool RigidBody::IsActive()
     return body->IsActive();
 }
 
+JPH::ObjectLayer RigidBody::ResolveLayer() const
+{
+    if (layer != PhysicsLayer::Auto)
+        return layer;
+
+    if (isTrigger) return PhysicsLayer::Trigger;
+    return isStatic ? PhysicsLayer::Static : PhysicsLayer::Dynamic;
+}
+
+void RigidBody::SetLayer(JPH::ObjectLayer newLayer)
+{
+    if (newLayer != PhysicsLayer::Auto && newLayer >= PhysicsLayer::Count)
+        return;
+
+    layer = newLayer;
+    if (body)
+        PhysicsManager::GetInstance().GetSystem().GetBodyInterface().SetObjectLayer(body->GetID(), ResolveLayer());
+}
+
 void RigidBody::SetKinematic(bool enabled)
 {
     auto& iface = PhysicsManager::GetInstance().GetSystem().GetBodyInterface();
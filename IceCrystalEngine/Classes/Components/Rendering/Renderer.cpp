@@ -8,6 +8,11 @@
 #include <Ice/Components/Rendering/Light.h>
 
 #include <Ice/Managers/RendererManager.h>
+#include <Ice/Managers/HotReloadManager.h>
+#include <Ice/Utils/DerivedDataCache.h>
+#include <Ice/Utils/VirtualFileSystem.h>
+
+#include <cstring>
 
 Renderer::Renderer() : Component()
 {
@@ -32,106 +37,95 @@ Renderer::Renderer(std::string modelPath, Material* material) : Component()
 
 
 
-std::string Renderer::GetCachePath()
+// Cooked meshes are stored as [meshCount] then [vertexCount][vertices][indexCount][indices] per mesh
+static std::vector<uint8_t> SerializeMeshes(const std::vector<MeshHolder>& meshes)
 {
-	return ModelPath + ".cache";
-}
-
-bool Renderer::IsCacheValid()
-{
-	namespace fs = std::filesystem;
-
-	if (!fs::exists(GetCachePath())) return false;
-
-	// If the cache exists but the source OBJ doesn't, the cache is still valid
-	if (!fs::exists(ModelPath)) return true;
+	std::vector<uint8_t> out;
+	auto write = [&out](const void* data, size_t size)
+	{
+		const uint8_t* bytes = static_cast<const uint8_t*>(data);
+		out.insert(out.end(), bytes, bytes + size);
+	};
 
-	auto cacheTime = fs::last_write_time(GetCachePath());
-	auto modelTime = fs::last_write_time(ModelPath);
+	uint64_t meshCount = meshes.size();
+	write(&meshCount, sizeof(meshCount));
+	for (const auto& mesh : meshes)
+	{
+		uint64_t vertexCount = mesh.vertices.size();
+		write(&vertexCount, sizeof(vertexCount));
+		write(mesh.vertices.data(), vertexCount * sizeof(Vertex));
 
-	return cacheTime >= modelTime;
+		uint64_t indexCount = mesh.indices.size();
+		write(&indexCount, sizeof(indexCount));
+		write(mesh.indices.data(), indexCount * sizeof(unsigned int));
+	}
+	return out;
 }
 
-
-bool Renderer::LoadFromCache() {
-	std::string cachePath = GetCachePath();
-	std::ifstream file(cachePath, std::ios::binary);
-	if (!file.is_open()) {
-		return false;
-	}
-    
-	// Read and verify version
-	uint32_t version;
-	file.read(reinterpret_cast<char*>(&version), sizeof(version));
-	if (version != CACHE_VERSION) {
-		return false;
-	}
-    
-	// Read number of meshes
-	size_t numMeshes;
-	file.read(reinterpret_cast<char*>(&numMeshes), sizeof(numMeshes));
-    
-	meshHolders.clear();
-	meshHolders.reserve(numMeshes);
-    
-	// Read each mesh
-	for (size_t i = 0; i < numMeshes; i++) {
-		// Read vertex count
-		size_t vertexCount;
-		file.read(reinterpret_cast<char*>(&vertexCount), sizeof(vertexCount));
-		std::vector<Vertex> vertices(vertexCount);
-		file.read(reinterpret_cast<char*>(vertices.data()), vertexCount * sizeof(Vertex));
-        
-		// Read indices
-		size_t indexCount;
-		file.read(reinterpret_cast<char*>(&indexCount), sizeof(indexCount));
-		std::vector<unsigned int> indices(indexCount);
-		file.read(reinterpret_cast<char*>(indices.data()), indexCount * sizeof(unsigned int));
-        
-		// Create mesh holder with move semantics
-		meshHolders.emplace_back(std::move(vertices), std::move(indices));
-	}
-    
-	if (file.fail() && !file.eof()) {
-		meshHolders.clear();
+static bool DeserializeMeshes(const std::vector<uint8_t>& data, std::vector<MeshHolder>& outMeshes)
+{
+	size_t cursor = 0;
+	auto read = [&](void* out, uint64_t size) -> bool
+	{
+		if (size > data.size() - cursor)
+			return false;
+		std::memcpy(out, data.data() + cursor, static_cast<size_t>(size));
+		cursor += static_cast<size_t>(size);
+		return true;
+	};
+
+	uint64_t meshCount = 0;
+	if (!read(&meshCount, sizeof(meshCount)))
 		return false;
+
+	outMeshes.clear();
+	for (uint64_t i = 0; i < meshCount; i++)
+	{
+		uint64_t vertexCount = 0;
+		if (!read(&vertexCount, sizeof(vertexCount)) || vertexCount > data.size() / sizeof(Vertex))
+			return false;
+		std::vector<Vertex> vertices(static_cast<size_t>(vertexCount));
+		if (!read(vertices.data(), vertexCount * sizeof(Vertex)))
+			return false;
+
+		uint64_t indexCount = 0;
+		if (!read(&indexCount, sizeof(indexCount)) || indexCount > data.size() / sizeof(unsigned int))
+			return false;
+		std::vector<unsigned int> indices(static_cast<size_t>(indexCount));
+		if (!read(indices.data(), indexCount * sizeof(unsigned int)))
+			return false;
+
+		outMeshes.emplace_back(std::move(vertices), std::move(indices));
 	}
-    
-	std::cout << "Loaded " << numMeshes << " meshes from cache" << std::endl;
 	return true;
 }
 
-void Renderer::SaveToCache() {
-	std::string cachePath = GetCachePath();
-	std::ofstream file(cachePath, std::ios::binary);
-	if (!file.is_open()) {
-		return;
-	}
-    
-	// Write version
-	file.write(reinterpret_cast<const char*>(&CACHE_VERSION), sizeof(CACHE_VERSION));
-    
-	// Write number of meshes
-	size_t numMeshes = meshHolders.size();
-	file.write(reinterpret_cast<const char*>(&numMeshes), sizeof(numMeshes));
-    
-	// Write each mesh
-	for (const auto& mesh : meshHolders) {
-		// Write vertex count and data
-		size_t vertexCount = mesh.vertices.size();
-		file.write(reinterpret_cast<const char*>(&vertexCount), sizeof(vertexCount));
-		file.write(reinterpret_cast<const char*>(mesh.vertices.data()), vertexCount * sizeof(Vertex));
-        
-		// Write index count and data
-		size_t indexCount = mesh.indices.size();
-		file.write(reinterpret_cast<const char*>(&indexCount), sizeof(indexCount));
-		file.write(reinterpret_cast<const char*>(mesh.indices.data()), indexCount * sizeof(unsigned int));
+bool Renderer::LoadMeshes(std::vector<MeshHolder>& outMeshes)
+{
+	FileData source = VirtualFileSystem::GetInstance().Read(ModelPath);
+	if (!source)
+	{
+		std::cout << "Failed to load model: " << ModelPath << std::endl;
+		return false;
 	}
-    
-	std::cout << "Saved cache with " << numMeshes << " meshes" << std::endl;
+
+	// Keyed on the OBJ's contents, so renaming / touching / checking out another branch doesnt matter
+	DerivedDataKey key("Mesh", MESH_COOKER_VERSION);
+	key.Add(source.Span());
+
+	DerivedDataCache& derivedDataCache = DerivedDataCache::GetInstance();
+	std::vector<uint8_t> cooked;
+	if (derivedDataCache.Get(key, cooked) && DeserializeMeshes(cooked, outMeshes))
+		return true;
+
+	if (!LoadFromOBJ(outMeshes))
+		return false;
+
+	derivedDataCache.Put(key, SerializeMeshes(outMeshes));
+	return true;
 }
 
-bool Renderer::LoadFromOBJ() {
+bool Renderer::LoadFromOBJ(std::vector<MeshHolder>& outMeshes) {
 	objl::Loader loader;
 	bool loadout = loader.LoadFile(ModelPath);
     
@@ -141,8 +135,8 @@ bool Renderer::LoadFromOBJ() {
 	}
     
 	std::vector<objl::Mesh>& meshes = loader.LoadedMeshes;
-	meshHolders.clear();
-	meshHolders.reserve(meshes.size());
+	outMeshes.clear();
+	outMeshes.reserve(meshes.size());
     
 	// Loop through the meshes
 	for (const auto& mesh : meshes) {
@@ -162,7 +156,7 @@ bool Renderer::LoadFromOBJ() {
 		std::vector<unsigned int> indices(mesh.Indices.begin(), mesh.Indices.end());
         
 		// Move data into mesh holder
-		meshHolders.emplace_back(std::move(vertices), std::move(indices));
+		outMeshes.emplace_back(std::move(vertices), std::move(indices));
 	}
     
 	std::cout << "Loaded " << meshes.size() << " meshes from OBJ" << std::endl;
@@ -201,9 +195,8 @@ void Renderer::CreateGLBuffers() {
 }
 
 
-Renderer::~Renderer()
-{
-	for (MeshHolder meshHolder : meshHolders)
+void Renderer::DeleteGLBuffers() {
+	for (MeshHolder& meshHolder : meshHolders)
 	{
 		glDeleteVertexArrays(1, &meshHolder.vertexArrayObject);
 		glDeleteBuffers(1, &meshHolder.vertexBufferObject);
@@ -212,25 +205,61 @@ Renderer::~Renderer()
 }
 
 
-void Renderer::InitializeRenderer()
+Renderer::~Renderer()
 {
-	std::string cachePath = GetCachePath();
-	bool loaded = false;
-    
-	// Try to load from cache first
-	if (IsCacheValid()) {
-		loaded = LoadFromCache();
+	if (HotReloadManager::IsAlive())
+		HotReloadManager::GetInstance().Unwatch(reloadWatchId);
+
+	// Dont let a reload thread write into a destroyed renderer
+	if (pendingReload.valid())
+		pendingReload.wait();
+
+	DeleteGLBuffers();
+}
+
+
+void Renderer::Reload()
+{
+	// Already cooking, pick the change up once that one is done
+	if (pendingReload.valid())
+	{
+		reloadQueued = true;
+		return;
 	}
-    
-	// If cache failed or doesn't exist, load from OBJ
-	if (!loaded) {
-		if (LoadFromOBJ()) {
-			// Save to cache for next time
-			SaveToCache();
-		} else {
-			std::cout << "Failed to load model: " << ModelPath << " - meshHolders is empty!" << std::endl;
-			return; // Failed to load model
-		}
+
+	// Parsing the OBJ is the slow part, do it off the main thread and swap the result in from Update()
+	pendingReload = std::async(std::launch::async, [this]() { return LoadMeshes(reloadedMeshes); });
+}
+
+void Renderer::FinishReload()
+{
+	if (!pendingReload.valid() || pendingReload.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+		return;
+
+	if (pendingReload.get() && !reloadedMeshes.empty())
+	{
+		DeleteGLBuffers();
+		meshHolders = std::move(reloadedMeshes);
+		CreateGLBuffers();
+	}
+	reloadedMeshes.clear();
+
+	if (reloadQueued)
+	{
+		reloadQueued = false;
+		Reload();
+	}
+}
+
+
+void Renderer::InitializeRenderer()
+{
+	reloadWatchId = HotReloadManager::GetInstance().Watch(ModelPath, [this]() { Reload(); });
+
+	// Load the cooked meshes (or cook them from the OBJ)
+	if (!LoadMeshes(meshHolders)) {
+		std::cout << "Failed to load model: " << ModelPath << " - meshHolders is empty!" << std::endl;
+		return; // Failed to load model
 	}
     
 	// Verify we have meshes before creating GL buffers
@@ -246,6 +275,9 @@ void Renderer::InitializeRenderer()
 
 void Renderer::Update()
 {
+	// Swap in a hot reloaded mesh once its done cooking
+	FinishReload();
+
 	if (material == nullptr)
 	{
 		std::cout << "Material not found" << std::endl;
@@ -296,6 +328,9 @@ void Renderer::Update()
 	int maxSpotLights = lightingManager.maxSpotLights;
 	if (numberOfSpotLights > maxSpotLights)
 		numberOfSpotLights = maxSpotLights;
+	// the NO_SPOT_LIGHTS variant compiles the spot light code out, so dont bother uploading anything
+	if (material->shader->HasKeyword("NO_SPOT_LIGHTS"))
+		numberOfSpotLights = 0;
 	
 	for (int i = 0; i < numberOfSpotLights; i++)
 	{
@@ -48,6 +48,27 @@ Actor::~Actor()
 }
 
 
+// Set Name
+void Actor::SetName(const std::string& newName)
+{
+	if (newName == name) return;
+
+	std::string oldName = name;
+	name = newName;
+	SceneManager::GetInstance().OnActorRenamed(this, oldName);
+}
+
+// Set Tag
+void Actor::SetTag(const std::string& newTag)
+{
+	if (newTag == tag) return;
+
+	std::string oldTag = tag;
+	tag = newTag;
+	SceneManager::GetInstance().OnActorRetagged(this, oldTag);
+}
+
+
 // Remove Component by Pointer
 void Actor::RemoveComponent(Component* component)
 {
@@ -56,6 +77,7 @@ void Actor::RemoveComponent(Component* component)
 		if (components->at(i) == component)
 		{
 			components->erase(components->begin() + i);
+			componentCache.clear();
 			return;
 		}
 	}
@@ -70,6 +92,7 @@ void Actor::DeleteComponent(Component* component)
 		if (components->at(i) == component)
 		{
 			components->erase(components->begin() + i);
+			componentCache.clear();
 			delete component;
 			return;
 		}
@@ -88,4 +111,5 @@ void Actor::AddComponent(Component* component)
 	component->transform = transform;
 	component->Ready();
 	components->push_back(component);
+	componentCache.clear();
 }
\ No newline at end of file
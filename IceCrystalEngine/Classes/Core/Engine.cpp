@@ -5,8 +5,11 @@
 #include <Ice/Managers/RendererManager.h>
 #include <Ice/Core/SceneInitializer.h>
 #include <Ice/Utils/FileUtil.h>
+#include <Ice/Utils/VirtualFileSystem.h>
 #include <Ice/Managers/PhysicsManager.h>
 #include <Ice/Managers/SceneManager.h>
+#include <Ice/Managers/HotReloadManager.h>
+#include <Ice/Managers/ParallelLuaManager.h>
 
 #include "Ice/Core/IGame.h"
 #include "Ice/Managers/AudioManager.h"
@@ -27,9 +30,17 @@
 
 Engine::~Engine()
 {
+    HotReloadManager::GetInstance().Stop();
     
+    // Workers have to be stopped before the actors their scripts point at go away
+    ParallelLuaManager::GetInstance().Shutdown();
+    // Statics are destroyed in reverse order of construction and the managers were created after the engine,
+    // so the actors (scripts, sources, bodies) have to go now while everything they unregister from still exists
+    SceneManager::GetInstance().DestroyAllActors();
     LuaManager::GetInstance().Cleanup();
 #ifdef _DEBUG
+    // High water marks, use them to size PhysicsSettings.json
+    PhysicsManager::GetInstance().PrintStats();
     EditorUI::GetInstance().Cleanup();
     WebEditorManager::GetInstance().Stop();
 #endif
@@ -41,6 +52,9 @@ void Engine::Init()
     // Setup the static members within FileUtil
     FileUtil::InitializeStaticMembers();
 
+    // Mount Assets.pak / EngineAssets.pak if this is a packed build
+    VirtualFileSystem::GetInstance().MountDefaultArchives();
+
     // Initialize core singletons
     WindowManager::GetInstance();
     SceneManager::GetInstance();
@@ -54,6 +68,9 @@ void Engine::Init()
     RendererManager::GetInstance();
 
     AudioManager::GetInstance().Initialize();
+
+    // Start watching the asset folders for changes
+    HotReloadManager::GetInstance().Start();
     
 #ifdef _DEBUG
     WebEditorManager::GetInstance().Start(8080);
@@ -128,6 +145,8 @@ void Engine::StartFrame()
     SceneManager::GetInstance().deltaTime = current - lastFrameTime;
     lastFrameTime = current;
 
+    LuaProfiler::GetInstance().BeginFrame();
+
 #ifdef _DEBUG
     EditorUI::GetInstance().BeginFrame();
     //DebugUtil::GetInstance().StartOfFrame();
@@ -146,6 +165,12 @@ void Engine::Update()
     bool isPaused = false;
 #endif
 
+    // Swap in any assets that changed on disk before anything uses them this frame
+    HotReloadManager::GetInstance().Update();
+
+    // Snapshot the scene and kick off the parallel Lua states, they run alongside physics and the main state
+    ParallelLuaManager::GetInstance().BeginFrame(sceneManager.deltaTime);
+
     AudioManager::GetInstance().Update();
     
     if (!isPaused)
@@ -167,9 +192,15 @@ void Engine::Update()
 
     // Fire Update within the lua RunService
     RunService::GetInstance().FireUpdate(sceneManager.deltaTime);
+
+    // Sync point, wait for the parallel Lua states and apply their queued writes
+    ParallelLuaManager::GetInstance().EndFrame();
     
     // Other engine updates (rendering still happens even when paused)
     sceneManager.Update();
+
+    // All Lua for this frame has run, collect garbage within the frame budget instead of whenever Lua feels like it
+    LuaManager::GetInstance().StepGarbageCollector();
 }
 
 void Engine::FixedUpdate(float deltaTime)
@@ -204,6 +235,12 @@ void Engine::FixedUpdate(float deltaTime)
 
         physicsAccumulator -= fixedDeltaTime;
     }
+
+    // How far we are into the next step, rigid bodies render this far between their last two poses
+    PhysicsManager::GetInstance().SetInterpolationAlpha(physicsAccumulator / fixedDeltaTime);
+
+    // One pass over the bodies that moved instead of every RigidBody reading its own pose
+    PhysicsManager::GetInstance().SyncTransforms();
 }
 
 void Engine::EndFrame()
@@ -166,7 +166,7 @@ void SceneInitializer::InitializeScene()
 	
 	// Only add mesh collider if the model loaded successfully
 	if (!floorRenderer->meshHolders.empty()) {
-		floorActor->AddComponent<MeshCollider>(floorRenderer->meshHolders[0].vertices, floorRenderer->meshHolders[0].indices, floorActor->transform->scale);
+		floorActor->AddComponent<MeshCollider>(floorRenderer->ModelPath, floorActor->transform->scale);
 	}
 	RigidBody* rb = floorActor->AddComponent<RigidBody>(0.0f);
 }
@@ -3,6 +3,7 @@
 
 #include <iostream>
 #include <Ice/Utils/FileUtil.h>
+#include <Ice/Utils/VirtualFileSystem.h>
 
 Skybox::Skybox()
 {
@@ -33,7 +34,11 @@ void Skybox::InitializeSkybox()
 	int width, height, nrChannels;
 	for (unsigned int i = 0; i < faces.size(); i++)
 	{
-		unsigned char* data = stbi_load((SkyboxPath + "/" + faces[i]).c_str(), &width, &height, &nrChannels, 0);		if (data)
+		unsigned char* data = nullptr;
+		FileData file = VirtualFileSystem::GetInstance().Read(SkyboxPath + "/" + faces[i]);
+		if (file)
+			data = stbi_load_from_memory(file.Bytes(), static_cast<int>(file.Size()), &width, &height, &nrChannels, 0);
+		if (data)
 		{
 			// Generate the texture
 			glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB, width, height, 0, GL_RGB,
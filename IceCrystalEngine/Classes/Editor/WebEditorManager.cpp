@@ -454,12 +454,12 @@ std::string WebEditorManager::HandleUpdateActorProperty(int actorId, const std::
             {
                 if (data.contains("name"))
                 {
-                    actor->name = data["name"].get<std::string>();
+                    actor->SetName(data["name"].get<std::string>());
                 }
 
                 if (data.contains("tag"))
                 {
-                    actor->tag = data["tag"].get<std::string>();
+                    actor->SetTag(data["tag"].get<std::string>());
                 }
 
                 BroadcastActorUpdated(actor);
@@ -1112,6 +1112,9 @@ void WebEditorManager::ResumeEngine()
                 
                 // Reset velocities to prevent sudden movements (using BodyInterface methods)
                 bodyInterface.SetLinearAndAngularVelocity(bodyID, JPH::Vec3::sZero(), JPH::Vec3::sZero());
+
+                // Teleported, dont interpolate from the old pose
+                rb->ResetPose();
                 
                 // Now activate if it's a dynamic body
                 if (!body->IsStatic())
@@ -1,25 +1,30 @@
 ﻿#include <Ice/Managers/AudioManager.h>
 #include <Ice/Resources/AudioClip.h>
+#include <Ice/Resources/AudioStream.h>
+#include <Ice/Resources/AudioDecoder.h>
+#include <Ice/Utils/VirtualFileSystem.h>
 #include <Ice/Managers/SceneManager.h>
 #include <Ice/Components/Camera.h>
+#include <Ice/Components/Audio/AudioSource.h>
 #include <iostream>
+#include <algorithm>
+#include <chrono>
 
 AudioManager::AudioManager()
     : device(nullptr)
     , context(nullptr)
     , initialized(false)
     , masterVolume(1.0f)
-    , nextOneShotSource(0)
+    , listenerPosition(0.0f)
+    , lastVoiceUpdateMs(0.0f)
 {
-    for (int i = 0; i < MAX_ONESHOT_SOURCES; i++)
-    {
-        oneShotSources[i] = 0;
-    }
 }
 
 AudioManager::~AudioManager()
 {
     Shutdown();
+    // Clips can be loaded without an audio device, so the decode threads might be running without Initialize
+    StopDecodeThreads();
 }
 
 AudioManager& AudioManager::GetInstance()
@@ -62,14 +67,22 @@ bool AudioManager::Initialize()
         return false;
     }
 
-    // Generate one-shot sources
-    alGenSources(MAX_ONESHOT_SOURCES, oneShotSources);
+    // Voice pool, no more than the device will actually mix at once
+    ALCint monoSources = 0;
+    alcGetIntegerv(device, ALC_MONO_SOURCES, 1, &monoSources);
+    int voiceCount = std::max(1, monoSources > 0 ? std::min(maxVoices, static_cast<int>(monoSources)) : maxVoices);
+    voices.resize(voiceCount);
+    alGenSources(voiceCount, voices.data());
+    freeVoices.assign(voices.rbegin(), voices.rend());
 
     // defualt listener properties
     SetListenerPosition(glm::vec3(0, 0, 0));
     SetListenerVelocity(glm::vec3(0, 0, 0));
     SetListenerOrientation(glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
 
+    streamThreadRunning = true;
+    streamThread = std::thread(&AudioManager::StreamLoop, this);
+
     initialized = true;
     std::cout << "AudioManager initialized." << std::endl;
     return true;
@@ -80,9 +93,26 @@ void AudioManager::Shutdown()
     if (!initialized)
         return;
 
+    // Take the voices back, they are about to be deleted, and forget the sources so one destroyed later doesn't touch the list
+    for (AudioSource* source : playingSources)
+    {
+        ReturnVoice(source->TakeVoice());
+        source->activeIndex = -1;
+    }
+    playingSources.clear();
+    StopOneShots(nullptr);
+
+    streamThreadRunning = false;
+    if (streamThread.joinable())
+        streamThread.join();
+    streams.clear();
+
     UnloadAllClips();
+    StopDecodeThreads();
 
-    alDeleteSources(MAX_ONESHOT_SOURCES, oneShotSources);
+    alDeleteSources(static_cast<ALsizei>(voices.size()), voices.data());
+    voices.clear();
+    freeVoices.clear();
 
     alcMakeContextCurrent(nullptr);
 
@@ -105,6 +135,8 @@ void AudioManager::Update()
 {
     if (!initialized) return;
 
+    UploadPendingClips(false);
+
     Camera* mainCamera = SceneManager::GetInstance().mainCamera;
     if (mainCamera)
     {
@@ -114,14 +146,16 @@ void AudioManager::Update()
             Transform* transform = cameraActor->transform;
             SetListenerPosition(transform->position);
             SetListenerOrientation(transform->forward, transform->up);
-            glm::vec3 listenerPos = transform->position;
         }
     }
+
+    UpdateVoices(SceneManager::GetInstance().deltaTime);
 }
 
 
 void AudioManager::SetListenerPosition(const glm::vec3& position)
 {
+    listenerPosition = position;
     alListener3f(AL_POSITION, position.x, position.y, position.z);
 }
 
@@ -147,7 +181,7 @@ void AudioManager::SetMasterVolume(float volume)
 }
 
 
-AudioClip* AudioManager::LoadClip(const std::string& name, const std::string& filepath)
+AudioClip* AudioManager::LoadClip(const std::string& name, const std::string& filepath, bool streaming)
 {
     // Check if already loaded
     auto it = clips.find(name);
@@ -157,7 +191,7 @@ AudioClip* AudioManager::LoadClip(const std::string& name, const std::string& fi
     }
 
     auto clip = std::make_unique<AudioClip>();
-    if (!clip->LoadFromFile(filepath))
+    if (!clip->LoadFromFile(filepath, streaming))
     {
         std::cerr << "AudioManager: Failed to load clip: " << filepath << std::endl;
         return nullptr;
@@ -169,6 +203,93 @@ AudioClip* AudioManager::LoadClip(const std::string& name, const std::string& fi
 }
 
 
+AudioClip* AudioManager::LoadClipAsync(const std::string& name, const std::string& filepath)
+{
+    auto it = clips.find(name);
+    if (it != clips.end())
+    {
+        return it->second.get();
+    }
+
+    auto clip = std::make_unique<AudioClip>();
+    AudioClip* ptr = clip.get();
+    clips[name] = std::move(clip);
+
+    // Decode only fills in the clip's own PCM, the OpenAL upload waits for the main thread
+    std::packaged_task<bool()> task([ptr, filepath]() { return ptr->Decode(filepath); });
+    pendingClips.push_back({ name, ptr, task.get_future() });
+    {
+        std::lock_guard lock(decodeMutex);
+        if (!decodeThreadsRunning)
+        {
+            decodeThreadsRunning = true;
+            // Leave a core for the main thread
+            int threadCount = std::clamp(static_cast<int>(std::thread::hardware_concurrency()) - 1, 1, MAX_DECODE_THREADS);
+            for (int i = 0; i < threadCount; i++)
+                decodeThreads.emplace_back(&AudioManager::DecodeLoop, this);
+        }
+        decodeQueue.push_back(std::move(task));
+    }
+    decodeReady.notify_one();
+    return ptr;
+}
+
+void AudioManager::DecodeLoop()
+{
+    while (true)
+    {
+        std::packaged_task<bool()> task;
+        {
+            std::unique_lock lock(decodeMutex);
+            decodeReady.wait(lock, [this]() { return !decodeThreadsRunning || !decodeQueue.empty(); });
+            // Only empty once stopping, the queue is drained first so no pending clip is left with a broken future
+            if (decodeQueue.empty())
+                return;
+
+            task = std::move(decodeQueue.front());
+            decodeQueue.pop_front();
+        }
+        task();
+    }
+}
+
+void AudioManager::StopDecodeThreads()
+{
+    {
+        std::lock_guard lock(decodeMutex);
+        decodeThreadsRunning = false;
+    }
+    decodeReady.notify_all();
+
+    for (std::thread& thread : decodeThreads)
+        thread.join();
+    decodeThreads.clear();
+}
+
+void AudioManager::FinishLoading()
+{
+    UploadPendingClips(true);
+}
+
+void AudioManager::UploadPendingClips(bool wait)
+{
+    for (auto it = pendingClips.begin(); it != pendingClips.end();)
+    {
+        if (!wait && it->decoded.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+        {
+            ++it;
+            continue;
+        }
+
+        if (!it->decoded.get() || !it->clip->Upload())
+        {
+            std::cerr << "AudioManager: Failed to load clip: " << it->name << std::endl;
+        }
+        it = pendingClips.erase(it);
+    }
+}
+
+
 AudioClip* AudioManager::GetClip(const std::string& name)
 {
     auto it = clips.find(name);
@@ -181,52 +302,349 @@ AudioClip* AudioManager::GetClip(const std::string& name)
 
 void AudioManager::UnloadClip(const std::string& name)
 {
-    clips.erase(name);
+    // A clip still decoding has to finish before it can be freed
+    for (auto it = pendingClips.begin(); it != pendingClips.end(); ++it)
+    {
+        if (it->name == name)
+        {
+            it->decoded.wait();
+            pendingClips.erase(it);
+            break;
+        }
+    }
+
+    auto it = clips.find(name);
+    if (it != clips.end())
+    {
+        StopOneShots(it->second.get());
+        clips.erase(it);
+    }
 }
 
 void AudioManager::UnloadAllClips()
 {
+    for (PendingClip& pending : pendingClips)
+    {
+        pending.decoded.wait();
+    }
+    pendingClips.clear();
+
+    StopOneShots(nullptr);
     clips.clear();
 }
 
-void AudioManager::PlayOneShot(const std::string& clipName, const glm::vec3& position, float volume, float pitch)
+void AudioManager::PlayOneShot(const std::string& clipName, const glm::vec3& position, float volume, float pitch, int priority)
 {
     AudioClip* clip = GetClip(clipName);
-    if (!clip || !clip->IsLoaded())
+
+    // One shots play a single buffer, a streaming clip needs an AudioSource
+    if (!clip || !clip->IsLoaded() || clip->IsStreaming())
+    {
+        return;
+    }
+
+    OneShot shot = { clip, position, volume, glm::clamp(pitch, 0.1f, 3.0f), glm::clamp(priority, 0, 255), 0.0f, 0 };
+
+    // Straight onto a free voice if it can be heard, otherwise it starts virtual and the next UpdateVoices ranks it
+    if (!freeVoices.empty() && GetAudibility(position, listenerPosition, volume, ONESHOT_MIN_DISTANCE, ONESHOT_MAX_DISTANCE) > MIN_AUDIBILITY)
+    {
+        ALuint voice = freeVoices.back();
+        freeVoices.pop_back();
+        RealizeOneShot(shot, voice);
+    }
+    oneShots.push_back(shot);
+}
+
+
+void AudioManager::OnSourcePlay(AudioSource* source)
+{
+    if (!initialized)
+        return;
+
+    if (source->activeIndex < 0)
+    {
+        source->activeIndex = static_cast<int>(playingSources.size());
+        playingSources.push_back(source);
+    }
+
+    // Same as a one shot, a free voice right away beats waiting a frame for UpdateVoices
+    if (source->GetVoice() == 0 && !freeVoices.empty() && source->GetAudibility(listenerPosition) > MIN_AUDIBILITY)
+    {
+        ALuint voice = freeVoices.back();
+        freeVoices.pop_back();
+        source->AssignVoice(voice);
+    }
+}
+
+void AudioManager::OnSourceStop(AudioSource* source)
+{
+    if (!initialized)
+        return;
+
+    int index = source->activeIndex;
+    if (index < 0 || index >= static_cast<int>(playingSources.size()) || playingSources[index] != source)
     {
         return;
     }
 
-    ALuint source = GetAvailableOneShotSource();
+    AudioSource* last = playingSources.back();
+    playingSources[index] = last;
+    last->activeIndex = index;
+    playingSources.pop_back();
+    source->activeIndex = -1;
+}
 
-    alSourcei(source, AL_BUFFER, clip->GetBuffer());
-    alSource3f(source, AL_POSITION, position.x, position.y, position.z);
-    alSourcef(source, AL_GAIN, volume);
-    alSourcef(source, AL_PITCH, pitch);
-    alSourcei(source, AL_LOOPING, AL_FALSE);
+void AudioManager::ReturnVoice(ALuint voice)
+{
+    if (voice != 0)
+    {
+        freeVoices.push_back(voice);
+    }
+}
 
-    alSourcePlay(source);
+float AudioManager::GetAudibility(const glm::vec3& position, const glm::vec3& listener, float volume, float minDistance, float maxDistance)
+{
+    // Squared distances first, most of the emitters in a big scene are out of range and never need the sqrt
+    glm::vec3 offset = position - listener;
+    float distanceSquared = glm::dot(offset, offset);
+    if (distanceSquared >= maxDistance * maxDistance)
+    {
+        return 0.0f;
+    }
+    if (distanceSquared <= minDistance * minDistance || maxDistance <= minDistance)
+    {
+        return volume;
+    }
+
+    float t = (std::sqrt(distanceSquared) - minDistance) / (maxDistance - minDistance);
+    return volume * (1.0f - t);
 }
 
-ALuint AudioManager::GetAvailableOneShotSource()
+void AudioManager::UpdateVoices(float deltaTime)
 {
-    // Find a source that's not playing
-    for (int i = 0; i < MAX_ONESHOT_SOURCES; i++)
+    auto start = std::chrono::steady_clock::now();
+
+    // Move virtual voices along and drop whatever finished. Backwards since stopping swaps the last one into its place.
+    for (int i = static_cast<int>(playingSources.size()) - 1; i >= 0; i--)
     {
-        int index = (nextOneShotSource + i) % MAX_ONESHOT_SOURCES;
-        ALint state;
-        alGetSourcei(oneShotSources[index], AL_SOURCE_STATE, &state);
+        AudioSource* source = playingSources[i];
+        source->AdvanceVirtualTime(deltaTime);
+        if (source->HasVoiceFinished())
+        {
+            source->Stop();
+        }
+    }
 
-        if (state != AL_PLAYING)
+    for (int i = static_cast<int>(oneShots.size()) - 1; i >= 0; i--)
+    {
+        OneShot& shot = oneShots[i];
+        bool finished;
+        if (shot.voice != 0)
+        {
+            ALint state;
+            alGetSourcei(shot.voice, AL_SOURCE_STATE, &state);
+            finished = state == AL_STOPPED;
+        }
+        else
         {
-            nextOneShotSource = (index + 1) % MAX_ONESHOT_SOURCES;
-            return oneShotSources[index];
+            shot.time += deltaTime * shot.pitch;
+            finished = shot.time >= shot.clip->GetDuration();
         }
+
+        if (finished)
+        {
+            if (shot.voice != 0)
+            {
+                alSourcei(shot.voice, AL_BUFFER, 0);
+                ReturnVoice(shot.voice);
+            }
+            oneShots[i] = oneShots.back();
+            oneShots.pop_back();
+        }
+    }
+
+    // Rank everything still playing, one pass over plain data, no OpenAL calls
+    candidates.clear();
+    for (int i = 0; i < static_cast<int>(playingSources.size()); i++)
+    {
+        AudioSource* source = playingSources[i];
+        float audibility = source->GetAudibility(listenerPosition);
+        float bonus = source->GetVoice() != 0 ? VOICE_HYSTERESIS : 1.0f;
+        candidates.push_back({ i, false, audibility > MIN_AUDIBILITY, source->GetPriority(), audibility * bonus });
+    }
+    for (int i = 0; i < static_cast<int>(oneShots.size()); i++)
+    {
+        const OneShot& shot = oneShots[i];
+        float audibility = GetAudibility(shot.position, listenerPosition, shot.volume, ONESHOT_MIN_DISTANCE, ONESHOT_MAX_DISTANCE);
+        float bonus = shot.voice != 0 ? VOICE_HYSTERESIS : 1.0f;
+        candidates.push_back({ i, true, audibility > MIN_AUDIBILITY, shot.priority, audibility * bonus });
+    }
+
+    // Audible first, then priority, then loudness. Only the split at the voice count matters, not the full order.
+    size_t realCount = std::min(candidates.size(), voices.size());
+    if (candidates.size() > realCount)
+    {
+        std::nth_element(candidates.begin(), candidates.begin() + realCount, candidates.end(), [](const VoiceCandidate& a, const VoiceCandidate& b) {
+            if (a.audible != b.audible)
+                return a.audible;
+            if (a.priority != b.priority)
+                return a.priority > b.priority;
+            return a.score > b.score;
+        });
+    }
+
+    // Everything that lost its place gives its voice back first, so the ones moving up have free voices to take
+    for (size_t i = 0; i < candidates.size(); i++)
+    {
+        const VoiceCandidate& candidate = candidates[i];
+        if (i < realCount && candidate.audible)
+            continue;
+
+        if (candidate.oneShot)
+            VirtualizeOneShot(oneShots[candidate.index]);
+        else
+            ReturnVoice(playingSources[candidate.index]->TakeVoice());
     }
 
-    // All sources busy, reuse the next one anyway
-    ALuint source = oneShotSources[nextOneShotSource];
-    alSourceStop(source);
-    nextOneShotSource = (nextOneShotSource + 1) % MAX_ONESHOT_SOURCES;
-    return source;
+    for (size_t i = 0; i < realCount && !freeVoices.empty(); i++)
+    {
+        const VoiceCandidate& candidate = candidates[i];
+        if (!candidate.audible)
+            continue;
+
+        if (candidate.oneShot)
+        {
+            OneShot& shot = oneShots[candidate.index];
+            if (shot.voice == 0)
+            {
+                ALuint voice = freeVoices.back();
+                freeVoices.pop_back();
+                RealizeOneShot(shot, voice);
+            }
+        }
+        else
+        {
+            AudioSource* source = playingSources[candidate.index];
+            if (source->GetVoice() == 0)
+            {
+                ALuint voice = freeVoices.back();
+                freeVoices.pop_back();
+                source->AssignVoice(voice);
+            }
+        }
+    }
+
+    lastVoiceUpdateMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void AudioManager::RealizeOneShot(OneShot& shot, ALuint voice)
+{
+    // Voices are shared, everything an AudioSource might have changed is set again
+    shot.voice = voice;
+    alSourcei(voice, AL_BUFFER, shot.clip->GetBuffer());
+    alSourcei(voice, AL_SOURCE_RELATIVE, AL_FALSE);
+    alSource3f(voice, AL_POSITION, shot.position.x, shot.position.y, shot.position.z);
+    alSourcef(voice, AL_GAIN, shot.volume);
+    alSourcef(voice, AL_PITCH, shot.pitch);
+    alSourcef(voice, AL_REFERENCE_DISTANCE, ONESHOT_MIN_DISTANCE);
+    alSourcef(voice, AL_MAX_DISTANCE, ONESHOT_MAX_DISTANCE);
+    alSourcef(voice, AL_ROLLOFF_FACTOR, 1.0f);
+    alSourcei(voice, AL_LOOPING, AL_FALSE);
+    alSourcef(voice, AL_SEC_OFFSET, shot.time);
+    alSourcePlay(voice);
+}
+
+void AudioManager::VirtualizeOneShot(OneShot& shot)
+{
+    if (shot.voice == 0)
+    {
+        return;
+    }
+
+    alGetSourcef(shot.voice, AL_SEC_OFFSET, &shot.time);
+    alSourceStop(shot.voice);
+    alSourcei(shot.voice, AL_BUFFER, 0);
+    ReturnVoice(shot.voice);
+    shot.voice = 0;
+}
+
+void AudioManager::StopOneShots(AudioClip* clip)
+{
+    for (int i = static_cast<int>(oneShots.size()) - 1; i >= 0; i--)
+    {
+        if (clip != nullptr && oneShots[i].clip != clip)
+            continue;
+
+        VirtualizeOneShot(oneShots[i]);
+        oneShots[i] = oneShots.back();
+        oneShots.pop_back();
+    }
+}
+
+void AudioManager::AddStream(AudioStream* stream)
+{
+    std::lock_guard lock(streamMutex);
+    if (std::find(streams.begin(), streams.end(), stream) == streams.end())
+        streams.push_back(stream);
+}
+
+void AudioManager::RemoveStream(AudioStream* stream)
+{
+    std::lock_guard lock(streamMutex);
+    streams.erase(std::remove(streams.begin(), streams.end(), stream), streams.end());
+}
+
+void AudioManager::StreamLoop()
+{
+    // 4 buffers of 32KB is ~180ms of 44.1kHz stereo, refilling every 10ms leaves plenty of room for a slow disk
+    while (streamThreadRunning)
+    {
+        {
+            std::lock_guard lock(streamMutex);
+            for (AudioStream* stream : streams)
+                stream->Service();
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+}
+
+void AudioManager::BenchmarkDecoder(const std::string& path, int iterations)
+{
+    std::unique_ptr<AudioDecoder> decoder = AudioDecoder::Open(path);
+    if (decoder == nullptr)
+    {
+        return;
+    }
+
+    uint64_t fileSize = 0;
+    if (std::unique_ptr<std::istream> file = VirtualFileSystem::GetInstance().OpenStream(path))
+    {
+        file->seekg(0, std::ios::end);
+        fileSize = static_cast<uint64_t>(file->tellg());
+    }
+
+    // Same sized reads as an AudioStream buffer
+    const size_t chunkFrames = 8192;
+    std::vector<char> scratch(chunkFrames * decoder->GetFrameSize());
+
+    uint64_t frames = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < std::max(1, iterations); i++)
+    {
+        decoder->Seek(0);
+        size_t read;
+        while ((read = decoder->Read(scratch.data(), chunkFrames)) > 0)
+        {
+            frames += read;
+        }
+    }
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    double audioSeconds = static_cast<double>(frames) / decoder->GetSampleRate();
+    double pcmMB = static_cast<double>(frames) * decoder->GetFrameSize() / (1024.0 * 1024.0);
+    double pcmBytesPerPass = static_cast<double>(frames) * decoder->GetFrameSize() / std::max(1, iterations);
+
+    std::cout << "AudioManager: decoded " << path << " " << iterations << "x, " << audioSeconds << "s of audio in " << ms << "ms"
+              << " (" << (ms > 0.0 ? audioSeconds * 1000.0 / ms : 0.0) << "x realtime, " << (ms > 0.0 ? pcmMB * 1000.0 / ms : 0.0) << " MB/s PCM"
+              << ", file is " << (pcmBytesPerPass > 0.0 ? 100.0 * fileSize / pcmBytesPerPass : 0.0) << "% of the PCM size)" << std::endl;
 }
\ No newline at end of file
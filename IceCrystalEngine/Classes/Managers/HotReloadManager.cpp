@@ -0,0 +1,259 @@
+#include <Ice/Managers/HotReloadManager.h>
+
+#include <Ice/Utils/FileUtil.h>
+
+#include <iostream>
+#include <filesystem>
+#include <algorithm>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+
+void HotReloadManager::AddRoot(const std::string& directory)
+{
+    std::string root = FileUtil::NormalizePath(directory);
+    if (std::find(roots.begin(), roots.end(), root) == roots.end())
+        roots.push_back(root);
+}
+
+void HotReloadManager::Start()
+{
+    if (!enabled || running)
+        return;
+
+    AddRoot(FileUtil::AssetDir);
+    AddRoot(FileUtil::EngineAssetDir);
+
+    running = true;
+    watcherThread = std::thread(&HotReloadManager::WatchLoop, this);
+}
+
+void HotReloadManager::Stop()
+{
+    if (!running)
+        return;
+
+    running = false;
+    if (watcherThread.joinable())
+        watcherThread.join();
+}
+
+
+int HotReloadManager::Watch(const std::string& path, std::function<void()> onChanged)
+{
+    int id = nextListenerId++;
+    listeners[id] = { FileUtil::NormalizePath(path), std::move(onChanged) };
+    return id;
+}
+
+void HotReloadManager::Unwatch(int id)
+{
+    listeners.erase(id);
+}
+
+
+void HotReloadManager::ReportChange(const std::string& path)
+{
+    std::lock_guard<std::mutex> lock(changedMutex);
+    changedPaths.push_back(path);
+}
+
+void HotReloadManager::Update()
+{
+    if (!running)
+        return;
+
+    auto now = std::chrono::steady_clock::now();
+
+    // Grab whatever the watcher thread found
+    {
+        std::lock_guard<std::mutex> lock(changedMutex);
+        for (const std::string& path : changedPaths)
+            pendingChanges[FileUtil::NormalizePath(path)] = now;
+        changedPaths.clear();
+    }
+
+    if (pendingChanges.empty())
+        return;
+
+    auto settle = std::chrono::duration<float>(settleTime);
+    for (auto it = pendingChanges.begin(); it != pendingChanges.end(); )
+    {
+        // Still being written
+        if (now - it->second < settle)
+        {
+            ++it;
+            continue;
+        }
+
+        std::string path = it->first;
+        it = pendingChanges.erase(it);
+
+        // Collect ids first, callbacks are allowed to Watch/Unwatch
+        std::vector<int> ids;
+        for (const auto& [id, listener] : listeners)
+        {
+            if (listener.path == path)
+                ids.push_back(id);
+        }
+
+        if (ids.empty())
+            continue;
+
+        std::cout << "Hot reloading " << path << std::endl;
+        for (int id : ids)
+        {
+            auto listener = listeners.find(id);
+            if (listener == listeners.end())
+                continue;
+
+            // Copy it, the listener might remove itself while running
+            std::function<void()> callback = listener->second.callback;
+            callback();
+            reloadCount++;
+        }
+    }
+}
+
+
+void HotReloadManager::WatchLoop()
+{
+#ifdef __linux__
+    InotifyLoop();
+#else
+    PollLoop();
+#endif
+}
+
+void HotReloadManager::PollLoop()
+{
+    std::unordered_map<std::string, fs::file_time_type> writeTimes;
+    bool firstScan = true;
+
+    while (running)
+    {
+        for (const std::string& root : roots)
+        {
+            std::error_code ec;
+            if (!fs::is_directory(root, ec))
+                continue;
+
+            for (auto it = fs::recursive_directory_iterator(root, fs::directory_options::skip_permission_denied, ec);
+                 !ec && it != fs::recursive_directory_iterator(); it.increment(ec))
+            {
+                if (!it->is_regular_file(ec))
+                    continue;
+
+                fs::file_time_type writeTime = it->last_write_time(ec);
+                if (ec)
+                    continue;
+
+                std::string path = it->path().generic_string();
+                auto known = writeTimes.find(path);
+                if (known == writeTimes.end())
+                {
+                    // Files created after the first scan count as changes (some editors save by replacing the file)
+                    writeTimes[path] = writeTime;
+                    if (!firstScan)
+                        ReportChange(path);
+                }
+                else if (known->second != writeTime)
+                {
+                    known->second = writeTime;
+                    ReportChange(path);
+                }
+            }
+        }
+        firstScan = false;
+
+        // Sleep in small steps so Stop() doesnt have to wait a whole interval
+        auto wakeTime = std::chrono::steady_clock::now() + std::chrono::duration<float>(pollInterval);
+        while (running && std::chrono::steady_clock::now() < wakeTime)
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+}
+
+#ifdef __linux__
+void HotReloadManager::InotifyLoop()
+{
+    int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd < 0)
+    {
+        std::cerr << "inotify unavailable, falling back to polling for hot reload" << std::endl;
+        PollLoop();
+        return;
+    }
+
+    const uint32_t mask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE;
+    std::unordered_map<int, std::string> watchDirs; // watch descriptor -> directory
+
+    // inotify isnt recursive, every directory needs its own watch
+    auto addWatch = [&](const std::string& directory)
+    {
+        int wd = inotify_add_watch(fd, directory.c_str(), mask);
+        if (wd >= 0)
+            watchDirs[wd] = directory;
+    };
+    auto addTree = [&](const std::string& root)
+    {
+        std::error_code ec;
+        if (!fs::is_directory(root, ec))
+            return;
+
+        addWatch(root);
+        for (auto it = fs::recursive_directory_iterator(root, fs::directory_options::skip_permission_denied, ec);
+             !ec && it != fs::recursive_directory_iterator(); it.increment(ec))
+        {
+            if (it->is_directory(ec))
+                addWatch(it->path().generic_string());
+        }
+    };
+
+    for (const std::string& root : roots)
+        addTree(root);
+
+    alignas(inotify_event) char buffer[16 * 1024];
+    while (running)
+    {
+        pollfd pfd = { fd, POLLIN, 0 };
+        if (poll(&pfd, 1, 100) <= 0)
+            continue;
+
+        ssize_t length = read(fd, buffer, sizeof(buffer));
+        if (length <= 0)
+            continue;
+
+        for (char* ptr = buffer; ptr < buffer + length; )
+        {
+            const inotify_event* event = reinterpret_cast<const inotify_event*>(ptr);
+            ptr += sizeof(inotify_event) + event->len;
+
+            auto dir = watchDirs.find(event->wd);
+            if (dir == watchDirs.end() || event->len == 0)
+                continue;
+
+            std::string path = (fs::path(dir->second) / event->name).generic_string();
+
+            if (event->mask & IN_ISDIR)
+            {
+                // New folder, start watching it too
+                if (event->mask & (IN_CREATE | IN_MOVED_TO))
+                    addTree(path);
+                continue;
+            }
+
+            // IN_CREATE alone is followed by IN_CLOSE_WRITE once the file is actually written
+            if (event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO))
+                ReportChange(path);
+        }
+    }
+
+    close(fd);
+}
+#endif
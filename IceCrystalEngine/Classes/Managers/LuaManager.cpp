@@ -1,7 +1,9 @@
 ﻿#include <chrono>
 #include <Ice/Managers/LuaManager.h>
+#include <Ice/Managers/ParallelLuaManager.h>
 #include <iostream>
 #include <sstream>
+#include <algorithm>
 
 #include "Ice/Components/Camera.h"
 #include "Ice/Core/Component.h"
@@ -17,14 +19,30 @@
 #include <Ice/Components/UI/RawImage.h>
 
 #include "Ice/Components/Audio/AudioSource.h"
+#include "Ice/Managers/AudioManager.h"
 #include "Ice/Components/Physics/RigidBody.h"
 
 LuaManager::LuaManager()
+    : lua(sol::default_at_panic, &LuaAllocator::Alloc, &allocator)
 {
     lua.open_libraries(sol::lib::base, sol::lib::math, sol::lib::package, sol::lib::table); // Load standard libraries
 
-    // Register wait function
+    SetGCMode(gcMode);
+
+    // Register wait functions
     lua["wait"] = &LuaManager::LuaWait;
+    lua["wait_frames"] = &LuaManager::LuaWaitFrames;
+    lua["wait_event"] = &LuaManager::LuaWaitEvent;
+    lua["fire_event"] = [](const std::string& name, sol::variadic_args va)
+    {
+        LuaManager& manager = LuaManager::GetInstance();
+        // Re-anchor the arguments on the main state, the calling thread might be gone by the time they are used
+        std::vector<sol::object> args;
+        args.reserve(va.size());
+        for (auto arg : va)
+            args.push_back(sol::make_object(manager.lua, arg.get<sol::object>()));
+        manager.FireEvent(name, args);
+    };
 
     // Replace the global print function
     lua["print"] = &LuaManager::LuaPrint;
@@ -43,50 +61,307 @@ LuaManager::LuaManager()
 
 void LuaManager::Update(double now)
 {
-    for (size_t i = 0; i < tasks.size(); )
+    frameCount++;
+
+    // Everything that became ready since the last Update (new scripts, plain yields, fired events)
+    resumeQueue.clear();
+    std::swap(resumeQueue, readyQueue);
+
+    // Only the sleepers that are actually due get touched
+    while (!timerHeap.empty() && timerHeap.top().wakeTime <= now)
     {
-        auto& task = tasks[i];
+        resumeQueue.push_back(timerHeap.top().handle);
+        timerHeap.pop();
+    }
+    while (!frameHeap.empty() && frameHeap.top().frame <= frameCount)
+    {
+        resumeQueue.push_back(frameHeap.top().handle);
+        frameHeap.pop();
+    }
 
-        // If waiting, skip until time is up
-        if (task.wakeTime > now)
-        {
-            ++i;
+    resumedLastFrame = 0;
+    // Index loop, a script can call Cleanup() and empty the queue under us
+    for (size_t i = 0; i < resumeQueue.size(); i++)
+    {
+        TaskHandle handle = resumeQueue[i];
+        // Stopped (or stopped and the slot reused) while it was waiting
+        if (!IsTaskValid(handle))
             continue;
-        }
 
-        // Resume the coroutine
-        sol::protected_function_result result = task.co();
-        
-        if (result.status() == sol::call_status::yielded)
-        {
-            // Coroutine yielded → check if it yielded a number (from wait())
-            if (lua_gettop(result.lua_state()) >= 1 && lua_isnumber(result.lua_state(), -1))
-            {
-                double seconds = lua_tonumber(result.lua_state(), -1);
-                task.wakeTime = now + seconds;
-            }
-            else
-            {
-                // Yielded but no delay specified → resume next frame
-                task.wakeTime = now;
-            }
-            ++i; // Keep task alive
-        }
-        else if (result.status() == sol::call_status::ok)
-        {
-            // Finished normally
-            tasks.erase(tasks.begin() + i);
-            // Do NOT increment i
-        }
-        else
+        ResumeTask(handle, now);
+        resumedLastFrame++;
+    }
+}
+
+void LuaManager::ResumeTask(TaskHandle handle, double now)
+{
+    // Copy these out, the script can start new tasks which may reallocate the tasks vector
+    sol::coroutine co = tasks[handle.slot].co;
+    std::vector<sol::object> args = std::move(tasks[handle.slot].resumeArgs);
+    tasks[handle.slot].resumeArgs.clear();
+
+    static const std::string unknownScript = "?";
+    static const std::string resumeName = "Resume";
+    LuaExecutor* executor = tasks[handle.slot].executor;
+    LuaProfiler::Scope scope(executor ? executor->filePath : unknownScript, resumeName, tasks[handle.slot].thread.thread_state());
+
+    // So anything the script connects knows who it belongs to
+    LuaExecutor* previousExecutor = currentExecutor;
+    currentExecutor = executor;
+
+    pendingWait = PendingWait();
+    sol::protected_function_result result = args.empty() ? co() : co(sol::as_args(args));
+
+    currentExecutor = previousExecutor;
+
+    // The script stopped its own executor
+    if (!IsTaskValid(handle))
+        return;
+
+    if (result.status() == sol::call_status::yielded)
+    {
+        ScheduleTask(handle, now);
+    }
+    else if (result.status() == sol::call_status::ok)
+    {
+        // Finished normally
+        FreeTask(handle.slot);
+    }
+    else
+    {
+        // Runtime error
+        sol::error err = result;
+        printf("Lua Error: %s\n", err.what());
+        FreeTask(handle.slot);
+    }
+}
+
+void LuaManager::ScheduleTask(TaskHandle handle, double now)
+{
+    switch (pendingWait.type)
+    {
+    case WaitType::Time:
+        timerHeap.push({ now + pendingWait.seconds, handle });
+        break;
+    case WaitType::Frames:
+        frameHeap.push({ frameCount + pendingWait.frames, handle });
+        break;
+    case WaitType::Event:
+        eventWaiters[pendingWait.event].push_back(handle);
+        break;
+    case WaitType::NextFrame:
+    default:
+        // Yielded without asking for anything (coroutine.yield()), resume next frame
+        readyQueue.push_back(handle);
+        break;
+    }
+}
+
+
+void LuaManager::Cleanup()
+{
+    ClearTasks();
+    RunService::GetInstance().Clear();
+    LuaProfiler::GetInstance().Stop(); // it wraps the state's allocator
+
+    componentRegistry.clear();
+    chunkCache.Clear();
+
+    lua.collect_garbage();
+    lua.collect_garbage();
+}
+
+void LuaManager::SetGCMode(GCMode mode)
+{
+    lua_State* L = lua.lua_state();
+    gcMode = mode;
+
+    if (mode == GCMode::Generational)
+    {
+        // Minor collections are cheap enough to let Lua run them itself
+        lua_gc(L, LUA_GCGEN, 0, 0);
+        lua_gc(L, LUA_GCRESTART);
+    }
+    else
+    {
+        // Stop the automatic collector, StepGarbageCollector does the work inside a fixed budget instead
+        lua_gc(L, LUA_GCINC, 0, 0, 0);
+        lua_gc(L, LUA_GCSTOP);
+    }
+
+    liveHeapKB = lua_gc(L, LUA_GCCOUNT);
+}
+
+void LuaManager::StepGarbageCollector()
+{
+    if (gcMode != GCMode::Incremental)
+        return;
+
+    lua_State* L = lua.lua_state();
+    auto start = std::chrono::steady_clock::now();
+
+    // If the heap has grown well past what survived the last cycle the scripts are allocating faster than
+    // the budget collects, give it more time until it catches up (otherwise memory would just keep growing)
+    int heapKB = lua_gc(L, LUA_GCCOUNT);
+    float budgetScale = 1.0f;
+    if (liveHeapKB > 0 && heapKB > liveHeapKB * 2)
+        budgetScale = std::min(static_cast<float>(heapKB) / (liveHeapKB * 2), 8.0f);
+    auto budget = std::chrono::duration<float, std::milli>(gcBudgetMs * budgetScale);
+
+    do
+    {
+        // Returns 1 when a cycle just finished
+        if (lua_gc(L, LUA_GCSTEP, gcStepKB))
         {
-            // Runtime error
-            sol::error err = result;
-            printf("Lua Error: %s\n", err.what());
-            tasks.erase(tasks.begin() + i);
-            // Do NOT increment i
+            liveHeapKB = lua_gc(L, LUA_GCCOUNT);
+            gcCycles++;
+            break;
         }
+    } while (std::chrono::steady_clock::now() - start < budget);
+
+    lastGCStepMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+
+void LuaManager::RunExecutor(LuaExecutor* executor)
+{
+    if (executor->parallel)
+    {
+        ParallelLuaManager::GetInstance().AddScript(executor);
+        return;
     }
+
+    sol::thread thread = sol::thread::create(lua);
+    sol::state_view thread_lua = thread.state();
+
+    // Read through the VFS so scripts can come from a .pak, "@path" makes errors show the file name
+    FileData source = VirtualFileSystem::GetInstance().Read(executor->filePath);
+    if (!source)
+    {
+        std::cerr << "Failed to open lua script " << executor->filePath << std::endl;
+        return;
+    }
+    sol::environment env(thread_lua, sol::create, lua.globals());
+    env["actor"] = executor->owner;
+    env["transform"] = executor->transform;
+
+    // Only parsed the first time this file (with this content) is run, after that it is a new closure over the same function
+    std::string error;
+    sol::function f = chunkCache.Instantiate(thread.thread_state(), executor->filePath, source.View(), env, error);
+    if (!f.valid())
+    {
+        printf("Lua Error: %s\n", error.c_str());
+        return;
+    }
+
+    sol::coroutine co(thread_lua, f);
+
+    TaskHandle handle = AllocateTask();
+    LuaTask& task = tasks[handle.slot];
+    task.thread = thread;
+    task.env = std::move(env);
+    task.co = std::move(co);
+    task.executor = executor;
+
+    // First resume happens on the next Update
+    readyQueue.push_back(handle);
+}
+
+void LuaManager::StopExecutor(LuaExecutor* executor)
+{
+    if (executor->parallel)
+    {
+        ParallelLuaManager::GetInstance().RemoveScript(executor);
+        return;
+    }
+
+    // Its RunService callbacks would otherwise keep running (and point at a dead actor)
+    RunService::GetInstance().DisconnectExecutor(executor);
+
+    for (uint32_t slot = 0; slot < tasks.size(); slot++)
+    {
+        if (tasks[slot].alive && tasks[slot].executor == executor)
+            FreeTask(slot);
+    }
+
+    // Heap entries for the freed tasks are skipped lazily when they come due, but an event might never fire
+    for (auto it = eventWaiters.begin(); it != eventWaiters.end(); )
+    {
+        std::vector<TaskHandle>& waiters = it->second;
+        waiters.erase(std::remove_if(waiters.begin(), waiters.end(), [this](TaskHandle handle) { return !IsTaskValid(handle); }), waiters.end());
+        it = waiters.empty() ? eventWaiters.erase(it) : std::next(it);
+    }
+}
+
+void LuaManager::FireEvent(const std::string& name, const std::vector<sol::object>& args)
+{
+    auto it = eventWaiters.find(name);
+    if (it == eventWaiters.end())
+        return;
+
+    // Take the list, anything that waits on the same event again after waking up goes in a fresh one
+    std::vector<TaskHandle> waiters = std::move(it->second);
+    eventWaiters.erase(it);
+
+    for (TaskHandle handle : waiters)
+    {
+        if (!IsTaskValid(handle))
+            continue;
+
+        tasks[handle.slot].resumeArgs = args;
+        readyQueue.push_back(handle);
+    }
+}
+
+
+LuaManager::TaskHandle LuaManager::AllocateTask()
+{
+    uint32_t slot;
+    if (!freeTaskSlots.empty())
+    {
+        slot = freeTaskSlots.back();
+        freeTaskSlots.pop_back();
+    }
+    else
+    {
+        slot = static_cast<uint32_t>(tasks.size());
+        tasks.emplace_back();
+    }
+
+    tasks[slot].alive = true;
+    liveTaskCount++;
+    return { slot, tasks[slot].generation };
+}
+
+void LuaManager::FreeTask(uint32_t slot)
+{
+    // Drop the Lua references so the thread can be collected, bump the generation so old handles go stale
+    uint32_t generation = tasks[slot].generation + 1;
+    tasks[slot] = LuaTask();
+    tasks[slot].generation = generation;
+
+    freeTaskSlots.push_back(slot);
+    liveTaskCount--;
+}
+
+bool LuaManager::IsTaskValid(TaskHandle handle) const
+{
+    return handle.slot < tasks.size() && tasks[handle.slot].alive && tasks[handle.slot].generation == handle.generation;
+}
+
+void LuaManager::ClearTasks()
+{
+    tasks.clear();
+    tasks.shrink_to_fit();
+    freeTaskSlots.clear();
+
+    timerHeap = {};
+    frameHeap = {};
+    eventWaiters.clear();
+    readyQueue.clear();
+    resumeQueue.clear();
+
+    liveTaskCount = 0;
 }
 
 
@@ -97,17 +372,40 @@ int LuaManager::LuaWait(lua_State* L)
     // expects milliseconds
     if (!lua_isnumber(L, 1))
     {
-        return luaL_error(L, "Expected a number (seconds)");
+        return luaL_error(L, "Expected a number (milliseconds)");
     }
 
     double ms = luaL_checknumber(L, 1);
-    double seconds = ms / 1000.0;
 
-    // Push the duration so the scheduler can pick it up
-    lua_pushnumber(L, seconds);
+    PendingWait& wait = GetInstance().pendingWait;
+    wait.type = WaitType::Time;
+    wait.seconds = std::max(ms, 0.0) / 1000.0;
 
-    // Yield the coroutine, returning 1 value
-    return lua_yield(L, 1);
+    return lua_yield(L, 0);
+}
+
+int LuaManager::LuaWaitFrames(lua_State* L)
+{
+    // wait_frames() is the same as wait_frames(1), resume on the next frame
+    lua_Integer frames = luaL_optinteger(L, 1, 1);
+
+    PendingWait& wait = GetInstance().pendingWait;
+    wait.type = WaitType::Frames;
+    wait.frames = static_cast<uint64_t>(std::max<lua_Integer>(frames, 1));
+
+    return lua_yield(L, 0);
+}
+
+int LuaManager::LuaWaitEvent(lua_State* L)
+{
+    // Whatever gets passed to fire_event comes back as the return values
+    const char* name = luaL_checkstring(L, 1);
+
+    PendingWait& wait = GetInstance().pendingWait;
+    wait.type = WaitType::Event;
+    wait.event = name;
+
+    return lua_yield(L, 0);
 }
 
 
@@ -249,6 +547,35 @@ void LuaManager::RegisterInputBindings()
 #pragma endregion
 }
 
+// Physics query helpers, filters are plain tables: { layers = Physics.LayerMask(PhysicsLayer.Static), triggers = false, ignore = rb }
+static PhysicsQueryFilter ReadQueryFilter(const sol::optional<sol::table>& table)
+{
+    PhysicsQueryFilter filter;
+    if (!table)
+        return filter;
+
+    filter.layerMask = table->get_or("layers", filter.layerMask);
+    filter.includeTriggers = table->get_or("triggers", filter.includeTriggers);
+    if (sol::optional<RigidBody*> ignore = table->get<sol::optional<RigidBody*>>("ignore"))
+        filter.ignore = *ignore;
+    return filter;
+}
+
+static sol::object MakeHitTable(lua_State* L, const PhysicsManager::RaycastHit& hit)
+{
+    sol::state_view lua(L);
+    if (hit.rigidBody == nullptr)
+        return sol::make_object(lua, false);
+
+    return lua.create_table_with(
+        "actor", hit.actor,
+        "rigidBody", hit.rigidBody,
+        "point", hit.point,
+        "normal", hit.normal,
+        "distance", hit.distance
+    );
+}
+
 void LuaManager::RegisterBindings() {
 
 #pragma region Scene Manager
@@ -264,18 +591,74 @@ void LuaManager::RegisterBindings() {
         "GetActorCount", &SceneManager::GetActorCount,
         "GetHoveredActor", &SceneManager::GetHoveredActor,
         "GetActorByTag", &SceneManager::GetActorByTag,
-        "GetActorsByTag", &SceneManager::GetActorsByTag
+        "GetActorsByTag", [](SceneManager& self, std::string_view tag) { return sol::as_table(self.GetActorsByTag(tag)); },
+        "GetActorByName", &SceneManager::GetActorByName,
+        "GetActorsByName", [](SceneManager& self, std::string_view name) { return sol::as_table(self.GetActorsByName(name)); },
+
+        // Spatial queries, these only find actors with a RigidBody
+        // local hits = sceneManager:OverlapSphere(center, 10, "Enemy")
+        "OverlapSphere", [](SceneManager& self, const glm::vec3& center, float radius, sol::optional<std::string_view> tag) {
+            std::vector<Actor*> results;
+            self.OverlapSphere(center, radius, results, tag.value_or(std::string_view()));
+            return sol::as_table(std::move(results));
+        },
+        // local actor, point, normal, distance = sceneManager:Raycast(origin, direction, 100)
+        "Raycast", [](sol::this_state ts, SceneManager& self, const glm::vec3& origin, const glm::vec3& direction, float maxDistance) {
+            sol::variadic_results results;
+            glm::vec3 point, normal;
+            float distance;
+            if (Actor* hit = self.Raycast(origin, direction, maxDistance, &point, &normal, &distance))
+            {
+                results.push_back(sol::make_object(ts, hit));
+                results.push_back(sol::make_object(ts, point));
+                results.push_back(sol::make_object(ts, normal));
+                results.push_back(sol::make_object(ts, distance));
+            }
+            return results;
+        },
+        // local actor, distance = sceneManager:NearestWithTag(position, "Enemy", 50)
+        "NearestWithTag", [](sol::this_state ts, SceneManager& self, const glm::vec3& position, std::string_view tag, sol::optional<float> maxDistance) {
+            sol::variadic_results results;
+            float distance;
+            if (Actor* nearest = self.NearestWithTag(position, tag, maxDistance.value_or(-1.0f), &distance))
+            {
+                results.push_back(sol::make_object(ts, nearest));
+                results.push_back(sol::make_object(ts, distance));
+            }
+            return results;
+        }
     );
 #pragma endregion
 
 #pragma region RunService
+    // local connection = RunService.Update(function(dt) ... end)
+    // connection:Disconnect()
+    lua.new_usertype<RunService::Connection>("RunServiceConnection",
+        sol::no_constructor,
+        "Disconnect", &RunService::Connection::Disconnect,
+        "Connected", sol::readonly_property(&RunService::Connection::IsConnected)
+    );
+
     lua["RunService"] = lua.create_table_with(
-        "Update", [this](sol::function f) {RunService::GetInstance().ConnectUpdate(f);},
-        "FixedUpdate", [this](sol::function f) {RunService::GetInstance().ConnectFixedUpdate(f);},
-        "LateUpdate", [this](sol::function f) {RunService::GetInstance().ConnectLateUpdate(f);}
+        "Update", [this](sol::function f) {return RunService::GetInstance().ConnectUpdate(f);},
+        "FixedUpdate", [this](sol::function f) {return RunService::GetInstance().ConnectFixedUpdate(f);},
+        "LateUpdate", [this](sol::function f) {return RunService::GetInstance().ConnectLateUpdate(f);}
     );
 #pragma endregion 
 
+#pragma region Profiler
+    lua["Profiler"] = lua.create_table_with(
+        "Start", [this]() { LuaProfiler::GetInstance().Start(lua.lua_state()); },
+        "Stop", []() { LuaProfiler::GetInstance().Stop(); },
+        "Reset", []() { LuaProfiler::GetInstance().Reset(); },
+        "IsRunning", []() { return LuaProfiler::GetInstance().IsRunning(); },
+        "Report", [](sol::optional<int> maxRows) { return LuaProfiler::GetInstance().GetFlatReport(maxRows.value_or(30)); },
+        "TreeReport", []() { return LuaProfiler::GetInstance().GetTreeReport(); },
+        "GetAllocatedBytes", []() { return static_cast<double>(LuaProfiler::GetInstance().GetAllocatedBytes()); },
+        "ExportTimeline", [](const std::string& path) { return LuaProfiler::GetInstance().ExportTimeline(path); }
+    );
+#pragma endregion
+
 #pragma region Transform
     // Register Transform
     lua.new_usertype<Transform>("Transform",
@@ -383,7 +766,20 @@ void LuaManager::RegisterBindings() {
         "SetLocalScale", sol::overload(
             [](Transform& self, glm::vec3 vec3) {self.SetLocalScale(vec3);},
             [](Transform& self, float x, float y, float z) {self.SetLocalScale(x, y, z);}
-        )
+        ),
+
+        // Flat getters, these return plain numbers so per frame code doesnt make a new vec3 userdata every call
+        // local x, y, z = transform:GetPositionXYZ()
+        "GetPositionXYZ", [](Transform& self) { return std::make_tuple(self.position.x, self.position.y, self.position.z); },
+        "GetLocalPositionXYZ", [](Transform& self) { return std::make_tuple(self.localPosition.x, self.localPosition.y, self.localPosition.z); },
+        "GetEulerAnglesXYZ", [](Transform& self) { return std::make_tuple(self.eulerAngles.x, self.eulerAngles.y, self.eulerAngles.z); },
+        "GetLocalEulerAnglesXYZ", [](Transform& self) { return std::make_tuple(self.localEulerAngles.x, self.localEulerAngles.y, self.localEulerAngles.z); },
+        "GetScaleXYZ", [](Transform& self) { return std::make_tuple(self.scale.x, self.scale.y, self.scale.z); },
+        "GetLocalScaleXYZ", [](Transform& self) { return std::make_tuple(self.localScale.x, self.localScale.y, self.localScale.z); },
+        "GetForwardXYZ", [](Transform& self) { return std::make_tuple(self.forward.x, self.forward.y, self.forward.z); },
+        "GetUpXYZ", [](Transform& self) { return std::make_tuple(self.up.x, self.up.y, self.up.z); },
+        "GetRightXYZ", [](Transform& self) { return std::make_tuple(self.right.x, self.right.y, self.right.z); },
+        "GetRotationWXYZ", [](Transform& self) { return std::make_tuple(self.rotation.w, self.rotation.x, self.rotation.y, self.rotation.z); }
     );
 #pragma endregion 
 
@@ -470,6 +866,36 @@ void LuaManager::RegisterBindings() {
             return glm::max(a, b);
         },
 
+        // In place versions, they change the vec3 they are called on instead of returning a new one (no allocation)
+        "set", [](glm::vec3& self, float x, float y, float z) {
+            self = glm::vec3(x, y, z);
+        },
+        "assign", [](glm::vec3& self, const glm::vec3& other) {
+            self = other;
+        },
+        "addInPlace", sol::overload(
+            [](glm::vec3& self, const glm::vec3& other) { self += other; },
+            [](glm::vec3& self, float x, float y, float z) { self += glm::vec3(x, y, z); }
+        ),
+        "subInPlace", sol::overload(
+            [](glm::vec3& self, const glm::vec3& other) { self -= other; },
+            [](glm::vec3& self, float x, float y, float z) { self -= glm::vec3(x, y, z); }
+        ),
+        "scaleInPlace", [](glm::vec3& self, float s) {
+            self *= s;
+        },
+        "lerpInPlace", [](glm::vec3& self, const glm::vec3& target, float t) {
+            self = glm::mix(self, target, t);
+        },
+        "normalizeInPlace", [](glm::vec3& self) {
+            float length = glm::length(self);
+            if (length > 0.0f)
+                self /= length;
+        },
+        "unpack", [](const glm::vec3& v) {
+            return std::make_tuple(v.x, v.y, v.z);
+        },
+
         // Static constants
         "zero", sol::var(glm::vec3(0.0f)),
         "one", sol::var(glm::vec3(1.0f)),
@@ -691,6 +1117,17 @@ void LuaManager::RegisterBindings() {
             }
         ),
 
+        // In place / flat versions (no allocation)
+        "set", [](glm::quat& self, float w, float x, float y, float z) {
+            self = glm::quat(w, x, y, z);
+        },
+        "assign", [](glm::quat& self, const glm::quat& other) {
+            self = other;
+        },
+        "unpack", [](const glm::quat& q) {
+            return std::make_tuple(q.w, q.x, q.y, q.z);
+        },
+
         // To string
         sol::meta_function::to_string, [](const glm::quat& q) {
             return std::format("Quaternion({}, {}, {}, {})", q.w, q.x, q.y, q.z);
@@ -757,13 +1194,121 @@ void LuaManager::RegisterBindings() {
     );
     RegisterComponent<RawImage>("RawImage", lua);
 
+    // Physics layers
+    // rb.layer = PhysicsLayer.Debris
+    // Physics.SetLayerCollision(PhysicsLayer.User0, PhysicsLayer.Dynamic, false)
+    sol::table physicsLayers = lua.create_named_table("PhysicsLayer",
+        "Static", PhysicsLayer::Static,
+        "Dynamic", PhysicsLayer::Dynamic,
+        "Trigger", PhysicsLayer::Trigger,
+        "Debris", PhysicsLayer::Debris,
+        "Auto", PhysicsLayer::Auto
+    );
+    for (JPH::ObjectLayer layer = PhysicsLayer::User0; layer < PhysicsLayer::Count; layer++)
+        physicsLayers["User" + std::to_string(layer - PhysicsLayer::User0)] = layer;
+
+    // Physics queries, hits are { actor, rigidBody, point, normal, distance } tables (nil / false on a miss)
+    // local hit = Physics.Raycast(origin, vec3(0, -1, 0), 100, { layers = Physics.LayerMask(PhysicsLayer.Static), triggers = false })
+    // local hits = Physics.RaycastBatch({ { origin, direction, 10 }, ... })
+    lua["Physics"] = lua.create_table_with(
+        "SetLayerCollision", [](JPH::ObjectLayer layer1, JPH::ObjectLayer layer2, bool collide) { PhysicsManager::GetInstance().SetLayerCollision(layer1, layer2, collide); },
+        "GetLayerCollision", [](JPH::ObjectLayer layer1, JPH::ObjectLayer layer2) { return PhysicsManager::GetInstance().GetLayerCollision(layer1, layer2); },
+        "LayerMask", [](sol::variadic_args layers) {
+            JPH::uint32 mask = 0;
+            for (JPH::ObjectLayer layer : layers)
+            {
+                // Auto is only a RigidBody setting, a query can't ask for it
+                if (layer >= PhysicsLayer::Count)
+                    throw std::runtime_error("Physics.LayerMask: " + std::to_string(layer) + " isn't a physics layer");
+                mask |= PhysicsLayer::Mask(layer);
+            }
+            return mask;
+        },
+
+        // Rollback, needs snapshotHistory in PhysicsSettings.json
+        // local tick = Physics.GetTick() ... Physics.Rollback(tick)
+        "GetTick", []() { return PhysicsManager::GetInstance().GetTick(); },
+        "Rollback", [](uint64_t tick) { return PhysicsManager::GetInstance().Rollback(tick); },
+        "BenchmarkRollback", [](int ticks) { PhysicsManager::GetInstance().BenchmarkRollback(ticks); },
+
+        "Raycast", [](sol::this_state ts, const glm::vec3& origin, const glm::vec3& direction, float maxDistance, sol::optional<sol::table> filter) {
+            PhysicsManager::RaycastHit hit;
+            PhysicsManager::GetInstance().Raycast(origin, direction, maxDistance, hit, ReadQueryFilter(filter));
+            return hit.rigidBody != nullptr ? MakeHitTable(ts, hit) : sol::make_object(ts, sol::lua_nil);
+        },
+        "RaycastAll", [](sol::this_state ts, const glm::vec3& origin, const glm::vec3& direction, float maxDistance, sol::optional<sol::table> filter) {
+            std::vector<PhysicsManager::RaycastHit> hits;
+            PhysicsManager::GetInstance().RaycastAll(origin, direction, maxDistance, hits, ReadQueryFilter(filter));
+            sol::state_view lua(ts);
+            sol::table results = lua.create_table(static_cast<int>(hits.size()), 0);
+            for (size_t i = 0; i < hits.size(); i++)
+                results[i + 1] = MakeHitTable(lua, hits[i]);
+            return results;
+        },
+        "SphereCast", [](sol::this_state ts, const glm::vec3& origin, float radius, const glm::vec3& direction, float maxDistance, sol::optional<sol::table> filter) {
+            PhysicsManager::RaycastHit hit;
+            PhysicsManager::GetInstance().SphereCast(origin, radius, direction, maxDistance, hit, ReadQueryFilter(filter));
+            return hit.rigidBody != nullptr ? MakeHitTable(ts, hit) : sol::make_object(ts, sol::lua_nil);
+        },
+        "BoxCast", [](sol::this_state ts, const glm::vec3& center, const glm::vec3& halfExtents, const glm::quat& rotation, const glm::vec3& direction, float maxDistance, sol::optional<sol::table> filter) {
+            PhysicsManager::RaycastHit hit;
+            PhysicsManager::GetInstance().BoxCast(center, halfExtents, rotation, direction, maxDistance, hit, ReadQueryFilter(filter));
+            return hit.rigidBody != nullptr ? MakeHitTable(ts, hit) : sol::make_object(ts, sol::lua_nil);
+        },
+        // These return the actors, each once
+        "OverlapSphere", [](const glm::vec3& center, float radius, sol::optional<sol::table> filter) {
+            std::vector<RigidBody*> bodies;
+            PhysicsManager::GetInstance().OverlapSphere(center, radius, bodies, ReadQueryFilter(filter));
+            std::vector<Actor*> actors;
+            for (RigidBody* body : bodies)
+                actors.push_back(body->owner);
+            return sol::as_table(std::move(actors));
+        },
+        "OverlapBox", [](const glm::vec3& center, const glm::vec3& halfExtents, const glm::quat& rotation, sol::optional<sol::table> filter) {
+            std::vector<RigidBody*> bodies;
+            PhysicsManager::GetInstance().OverlapBox(center, halfExtents, rotation, bodies, ReadQueryFilter(filter));
+            std::vector<Actor*> actors;
+            for (RigidBody* body : bodies)
+                actors.push_back(body->owner);
+            return sol::as_table(std::move(actors));
+        },
+        // rays is a list of { origin, direction, maxDistance }, the result has a hit (or false) at the same index
+        "RaycastBatch", [](sol::this_state ts, sol::table rays, sol::optional<sol::table> filter) {
+            std::vector<PhysicsManager::RaycastRequest> requests;
+            requests.reserve(rays.size());
+            for (size_t i = 1; i <= rays.size(); i++)
+            {
+                sol::table ray = rays[i];
+                requests.push_back({ ray.get<glm::vec3>(1), ray.get<glm::vec3>(2), ray.get<float>(3) });
+            }
+
+            std::vector<PhysicsManager::RaycastHit> hits;
+            PhysicsManager::GetInstance().RaycastBatch(requests, hits, ReadQueryFilter(filter));
+
+            sol::state_view lua(ts);
+            sol::table results = lua.create_table(static_cast<int>(hits.size()), 0);
+            for (size_t i = 0; i < hits.size(); i++)
+                results[i + 1] = MakeHitTable(lua, hits[i]);
+            return results;
+        }
+    );
+
     // RigidBody
+    // rb.interpolation = RigidBodyInterpolation.Extrapolate
+    lua.new_enum<RigidBody::Interpolation>("RigidBodyInterpolation", {
+        { "None", RigidBody::Interpolation::None },
+        { "Interpolate", RigidBody::Interpolation::Interpolate },
+        { "Extrapolate", RigidBody::Interpolation::Extrapolate }
+    });
+
     lua.new_usertype<RigidBody>("RigidBody",
         sol::no_constructor,
         sol::base_classes, sol::bases<Component>(),
         // Properties
         "mass", &RigidBody::mass,
         "isTrigger", &RigidBody::isTrigger,
+        "interpolation", &RigidBody::interpolation,
+        "layer", sol::property(&RigidBody::GetLayer, &RigidBody::SetLayer),
 
         // Callback bindings
         "OnContactStarted", &RigidBody::OnContactStarted,
@@ -773,6 +1318,8 @@ void LuaManager::RegisterBindings() {
         "OnTriggerEntered", &RigidBody::OnTriggerEntered,
         "OnTriggerStay", &RigidBody::OnTriggerStay,
         "OnTriggerExited", &RigidBody::OnTriggerExited,
+        // rb.stayCallbackInterval = 0.25 -- OnContacting / OnTriggerStay at most 4 times a second
+        "stayCallbackInterval", &RigidBody::stayCallbackInterval,
         
         // Methods
         "AddForce", &RigidBody::AddForce,
@@ -789,7 +1336,23 @@ void LuaManager::RegisterBindings() {
         "IsActive", &RigidBody::IsActive,
 
         "SetKinematic", &RigidBody::SetKinematic,
-        "IsKinematic", &RigidBody::IsKinematic
+        "IsKinematic", &RigidBody::IsKinematic,
+
+        // Flat versions, no vec3 userdata needed
+        "AddForceXYZ", [](RigidBody& self, float x, float y, float z) { self.AddForce(glm::vec3(x, y, z)); },
+        "AddTorqueXYZ", [](RigidBody& self, float x, float y, float z) { self.AddTorque(glm::vec3(x, y, z)); },
+        "AddImpulseXYZ", [](RigidBody& self, float x, float y, float z) { self.AddImpulse(glm::vec3(x, y, z)); },
+        "AddAngularImpulseXYZ", [](RigidBody& self, float x, float y, float z) { self.AddAngularImpulse(glm::vec3(x, y, z)); },
+        "SetLinearVelocityXYZ", [](RigidBody& self, float x, float y, float z) { self.SetLinearVelocity(glm::vec3(x, y, z)); },
+        "SetAngularVelocityXYZ", [](RigidBody& self, float x, float y, float z) { self.SetAngularVelocity(glm::vec3(x, y, z)); },
+        "GetLinearVelocityXYZ", [](RigidBody& self) {
+            glm::vec3 v = self.GetLinearVelocity();
+            return std::make_tuple(v.x, v.y, v.z);
+        },
+        "GetAngularVelocityXYZ", [](RigidBody& self) {
+            glm::vec3 v = self.GetAngularVelocity();
+            return std::make_tuple(v.x, v.y, v.z);
+        }
     );
     RegisterComponent<RigidBody>("RigidBody", lua);
 
@@ -813,10 +1376,19 @@ void LuaManager::RegisterBindings() {
         "SetMaxDistance", &AudioSource::SetMaxDistance,
         "GetMaxDistance", &AudioSource::GetMaxDistance,
         "SetPlaybackTime", &AudioSource::SetPlaybackTime,
-        "GetPlaybackTime", &AudioSource::GetPlaybackTime
+        "GetPlaybackTime", &AudioSource::GetPlaybackTime,
+        "SetPriority", &AudioSource::SetPriority,
+        "GetPriority", &AudioSource::GetPriority,
+        "IsVirtual", &AudioSource::IsVirtual
     );
     RegisterComponent<AudioSource>("AudioSource", lua);
 
+    lua["Audio"] = lua.create_table_with(
+        "BenchmarkDecoder", [](const std::string& path, sol::optional<int> iterations) { AudioManager::GetInstance().BenchmarkDecoder(path, iterations.value_or(5)); },
+        "GetRealVoiceCount", []() { return AudioManager::GetInstance().GetRealVoiceCount(); },
+        "GetVirtualVoiceCount", []() { return AudioManager::GetInstance().GetVirtualVoiceCount(); }
+    );
+
 #pragma endregion
 
 #pragma region Actor
@@ -829,8 +1401,9 @@ void LuaManager::RegisterBindings() {
     >(),
 
         // Member variables
-        "name", &Actor::name,
-        "tag", &Actor::tag,
+        // Setters go through the actor so the SceneManager name / tag lookups stay correct
+        "name", sol::property([](Actor& self) -> const std::string& { return self.name; }, &Actor::SetName),
+        "tag", sol::property([](Actor& self) -> const std::string& { return self.tag; }, &Actor::SetTag),
         "transform", &Actor::transform,
 
         // HasComponent
@@ -858,6 +1431,15 @@ void LuaManager::RegisterBindings() {
             // return sol::make_object(lua, comp);
         },
 
+        // Typed getters, skip the string lookup in componentRegistry (and Actor caches the result)
+        "GetCamera", [](Actor& self) { return self.GetComponent<Camera>(); },
+        "GetDirectionalLight", [](Actor& self) { return self.GetComponent<DirectionalLight>(); },
+        "GetPointLight", [](Actor& self) { return self.GetComponent<PointLight>(); },
+        "GetSpotLight", [](Actor& self) { return self.GetComponent<SpotLight>(); },
+        "GetRawImage", [](Actor& self) { return self.GetComponent<RawImage>(); },
+        "GetRigidBody", [](Actor& self) { return self.GetComponent<RigidBody>(); },
+        "GetAudioSource", [](Actor& self) { return self.GetComponent<AudioSource>(); },
+
         // AddComponent
         "AddComponent", [](sol::this_state ts, Actor& self, const std::string& typeName) -> sol::object {
             auto it = componentRegistry.find(typeName);
@@ -879,42 +1461,311 @@ void LuaManager::RegisterBindings() {
 
 
 // RunService
-void RunService::FireUpdate(float deltaTime)
+void RunService::Connection::Disconnect()
+{
+    RunService::GetInstance().Disconnect(*this);
+}
+
+bool RunService::Connection::IsConnected() const
+{
+    return RunService::GetInstance().IsConnected(*this);
+}
+
+const char* RunService::EventName(Event event)
 {
-    for (auto& callback : updateCallbacks)
+    switch (event)
     {
-        callback(deltaTime);
+    case Event::Update: return "Update";
+    case Event::FixedUpdate: return "FixedUpdate";
+    case Event::LateUpdate: return "LateUpdate";
+    default: return "?";
     }
 }
 
+int RunService::ErrorHandler(lua_State* L)
+{
+    // Add a traceback so the error says where in the script it happened
+    const char* message = lua_tostring(L, 1);
+    luaL_traceback(L, L, message ? message : "(error object is not a string)", 1);
+    return 1;
+}
+
+
+void RunService::FireUpdate(float deltaTime)
+{
+    Fire(Event::Update, deltaTime);
+}
+
 void RunService::FireFixedUpdate(float fixedDeltaTime)
 {
-    for (auto& callback : fixedUpdateCallbacks)
+    Fire(Event::FixedUpdate, fixedDeltaTime);
+}
+
+void RunService::FireLateUpdate(float deltaTime)
+{
+    Fire(Event::LateUpdate, deltaTime);
+}
+
+void RunService::Fire(Event event, float deltaTime)
+{
+    size_t index = static_cast<size_t>(event);
+    if (firingDepth == 0)
+        MergePending(event);
+
+    std::vector<Callback>& list = callbacks[index];
+    if (list.empty())
+        return;
+
+    LuaManager& luaManager = LuaManager::GetInstance();
+    lua_State* L = luaManager.lua.lua_state();
+
+    // One error handler for the whole batch, each call is then just rawgeti + pcall
+    lua_pushcfunction(L, &RunService::ErrorHandler);
+    int handler = lua_gettop(L);
+
+    LuaExecutor* previousExecutor = luaManager.GetCurrentExecutor();
+    firingDepth++;
+
+    // The list cant grow while firing (new connections go to pendingCallbacks), Disconnect only flags
+    for (size_t i = 0; i < list.size(); i++)
+    {
+        Callback& callback = list[i];
+        if (!callback.connected)
+            continue;
+
+        if (callback.skipCount > 0)
+        {
+            callback.skipCount--;
+            continue;
+        }
+
+        luaManager.SetCurrentExecutor(callback.executor);
+        LuaProfiler::Scope scope(callback.script, callback.name);
+        auto start = std::chrono::steady_clock::now();
+
+        lua_rawgeti(L, LUA_REGISTRYINDEX, callback.ref);
+        lua_pushnumber(L, deltaTime);
+        int status = lua_pcall(L, 1, 0, handler);
+
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        if (status != LUA_OK)
+        {
+            const char* message = lua_tostring(L, -1);
+            printf("Lua Error: %s\n", message ? message : "?");
+            lua_pop(L, 1);
+
+            if (++callback.errorStreak >= maxConsecutiveErrors)
+            {
+                std::cerr << "Disconnecting " << callback.name << " after " << callback.errorStreak << " errors in a row" << std::endl;
+                callback.connected = false;
+                needsCompact[index] = true;
+            }
+        }
+        else
+        {
+            callback.errorStreak = 0;
+        }
+
+        TrackBudget(callback, ms);
+    }
+
+    firingDepth--;
+    luaManager.SetCurrentExecutor(previousExecutor);
+    lua_pop(L, 1); // handler
+
+    if (needsCompact[index] && firingDepth == 0)
+        Compact(event);
+}
+
+void RunService::TrackBudget(Callback& callback, double ms)
+{
+    if (ms <= callbackBudgetMs)
+    {
+        callback.overrunStreak = 0;
+        return;
+    }
+
+    callback.overruns++;
+    callback.overrunStreak++;
+
+    // Dont spam the log every frame
+    if (callback.overruns == 1 || callback.overruns % 100 == 0)
+    {
+        std::cerr << callback.name << " took " << ms << " ms (budget " << callbackBudgetMs << " ms, " << callback.overruns
+                  << " overruns so far)" << std::endl;
+    }
+
+    if (callback.overrunStreak >= overrunsBeforeThrottle)
     {
-        callback(fixedDeltaTime);
+        // Keeps throttling for as long as it keeps overrunning, one run every throttleFrames + 1 events
+        if (callback.overrunStreak == overrunsBeforeThrottle)
+            std::cerr << "Throttling " << callback.name << ", it keeps going over its budget" << std::endl;
+        callback.skipCount = throttleFrames;
     }
 }
 
-void RunService::FireLateUpdate(float deltaTime)
+
+RunService::Connection RunService::ConnectUpdate(sol::function callback)
+{
+    return Connect(Event::Update, std::move(callback));
+}
+
+RunService::Connection RunService::ConnectFixedUpdate(sol::function callback)
+{
+    return Connect(Event::FixedUpdate, std::move(callback));
+}
+
+RunService::Connection RunService::ConnectLateUpdate(sol::function callback)
+{
+    return Connect(Event::LateUpdate, std::move(callback));
+}
+
+RunService::Connection RunService::Connect(Event event, sol::function function)
+{
+    Callback callback;
+    callback.id = nextId++;
+    callback.executor = LuaManager::GetInstance().GetCurrentExecutor();
+
+    // The registry is shared by every thread, so the ref stays valid after the script's coroutine is gone
+    lua_State* L = function.lua_state();
+    function.push(L);
+    std::string location = LuaProfiler::DescribeFunction(L, -1, &callback.script);
+    callback.ref = luaL_ref(L, LUA_REGISTRYINDEX);
+    callback.name = std::string("RunService.") + EventName(event) + " " + location;
+
+    pendingCallbacks[static_cast<size_t>(event)].push_back(std::move(callback));
+    return { event, pendingCallbacks[static_cast<size_t>(event)].back().id };
+}
+
+void RunService::MergePending(Event event)
+{
+    size_t index = static_cast<size_t>(event);
+    std::vector<Callback>& list = callbacks[index];
+
+    for (Callback& callback : pendingCallbacks[index])
+    {
+        // Keep each script's callbacks next to each other
+        auto last = std::find_if(list.rbegin(), list.rend(), [&callback](const Callback& other) { return other.executor == callback.executor; });
+        list.insert(last.base(), std::move(callback));
+    }
+    pendingCallbacks[index].clear();
+}
+
+void RunService::Compact(Event event)
 {
-    for (auto& callback : lateUpdateCallbacks)
+    size_t index = static_cast<size_t>(event);
+    std::vector<Callback>& list = callbacks[index];
+    lua_State* L = LuaManager::GetInstance().lua.lua_state();
+
+    for (const Callback& callback : list)
     {
-        callback(deltaTime);
+        if (!callback.connected)
+            luaL_unref(L, LUA_REGISTRYINDEX, callback.ref);
     }
+    list.erase(std::remove_if(list.begin(), list.end(), [](const Callback& callback) { return !callback.connected; }), list.end());
+    needsCompact[index] = false;
 }
 
-void RunService::ConnectUpdate(sol::function callback)
+void RunService::Disconnect(const Connection& connection)
 {
-    updateCallbacks.push_back(callback);
+    size_t index = static_cast<size_t>(connection.event);
+    if (index >= eventCount)
+        return;
+
+    for (Callback& callback : callbacks[index])
+    {
+        if (callback.id == connection.id && callback.connected)
+        {
+            callback.connected = false;
+            needsCompact[index] = true;
+            if (firingDepth == 0)
+                Compact(connection.event);
+            return;
+        }
+    }
+
+    std::vector<Callback>& pending = pendingCallbacks[index];
+    for (size_t i = 0; i < pending.size(); i++)
+    {
+        if (pending[i].id == connection.id)
+        {
+            luaL_unref(LuaManager::GetInstance().lua.lua_state(), LUA_REGISTRYINDEX, pending[i].ref);
+            pending.erase(pending.begin() + i);
+            return;
+        }
+    }
+}
+
+bool RunService::IsConnected(const Connection& connection) const
+{
+    size_t index = static_cast<size_t>(connection.event);
+    if (index >= eventCount)
+        return false;
+
+    for (const Callback& callback : callbacks[index])
+    {
+        if (callback.id == connection.id)
+            return callback.connected;
+    }
+    for (const Callback& callback : pendingCallbacks[index])
+    {
+        if (callback.id == connection.id)
+            return true;
+    }
+    return false;
 }
 
-void RunService::ConnectFixedUpdate(sol::function callback)
+void RunService::DisconnectExecutor(LuaExecutor* executor)
 {
-    fixedUpdateCallbacks.push_back(callback);
+    lua_State* L = LuaManager::GetInstance().lua.lua_state();
+
+    for (size_t index = 0; index < eventCount; index++)
+    {
+        for (Callback& callback : callbacks[index])
+        {
+            if (callback.executor == executor && callback.connected)
+            {
+                callback.connected = false;
+                needsCompact[index] = true;
+            }
+        }
+
+        std::vector<Callback>& pending = pendingCallbacks[index];
+        for (const Callback& callback : pending)
+        {
+            if (callback.executor == executor)
+                luaL_unref(L, LUA_REGISTRYINDEX, callback.ref);
+        }
+        pending.erase(std::remove_if(pending.begin(), pending.end(), [executor](const Callback& callback) { return callback.executor == executor; }),
+                      pending.end());
+
+        if (needsCompact[index] && firingDepth == 0)
+            Compact(static_cast<Event>(index));
+    }
 }
 
-void RunService::ConnectLateUpdate(sol::function callback)
+void RunService::Clear()
 {
-    lateUpdateCallbacks.push_back(callback);
+    lua_State* L = LuaManager::GetInstance().lua.lua_state();
+
+    for (size_t index = 0; index < eventCount; index++)
+    {
+        for (const Callback& callback : callbacks[index])
+            luaL_unref(L, LUA_REGISTRYINDEX, callback.ref);
+        for (const Callback& callback : pendingCallbacks[index])
+            luaL_unref(L, LUA_REGISTRYINDEX, callback.ref);
+
+        callbacks[index].clear();
+        pendingCallbacks[index].clear();
+        needsCompact[index] = false;
+    }
 }
 
+int RunService::GetCallbackCount() const
+{
+    int count = 0;
+    for (size_t index = 0; index < eventCount; index++)
+        count += static_cast<int>(callbacks[index].size() + pendingCallbacks[index].size());
+    return count;
+}
@@ -0,0 +1,645 @@
+#include <Ice/Managers/ParallelLuaManager.h>
+
+#include <Ice/Managers/LuaManager.h>
+#include <Ice/Managers/SceneManager.h>
+#include <Ice/Core/Actor.h>
+#include <Ice/Core/Transform.h>
+#include <Ice/Components/LuaExecutor.h>
+#include <Ice/Components/Physics/RigidBody.h>
+#include <Ice/Utils/VirtualFileSystem.h>
+
+#include <iostream>
+#include <chrono>
+#include <limits>
+#include <cmath>
+
+
+// LuaWorkerVM
+LuaWorkerVM::LuaWorkerVM(int index, const SceneSnapshot& snapshot)
+    : index(index), snapshot(snapshot), lua(sol::default_at_panic, &LuaAllocator::Alloc, &allocator)
+{
+    lua.open_libraries(sol::lib::base, sol::lib::math, sol::lib::table);
+
+    // Every thread made from this state copies the extra space, so the C functions can always find their VM
+    *static_cast<LuaWorkerVM**>(lua_getextraspace(lua.lua_state())) = this;
+
+    // Same budgeted incremental collection as the main state, just on the worker thread
+    lua_gc(lua.lua_state(), LUA_GCINC, 0, 0, 0);
+    lua_gc(lua.lua_state(), LUA_GCSTOP);
+
+    RegisterBindings();
+    liveHeapKB = lua_gc(lua.lua_state(), LUA_GCCOUNT);
+}
+
+void LuaWorkerVM::RegisterBindings()
+{
+    lua_State* L = lua.lua_state();
+
+    lua_register(L, "print", &LuaWorkerVM::LuaPrint);
+
+    // Reads, all against the snapshot taken at the start of the frame
+    // local x, y, z = Scene.GetPosition(actor)
+    static const luaL_Reg sceneFunctions[] = {
+        { "GetPosition", &LuaWorkerVM::LuaGetVec3<&ActorSnapshot::position> },
+        { "GetEulerAngles", &LuaWorkerVM::LuaGetVec3<&ActorSnapshot::eulerAngles> },
+        { "GetScale", &LuaWorkerVM::LuaGetVec3<&ActorSnapshot::scale> },
+        { "GetForward", &LuaWorkerVM::LuaGetVec3<&ActorSnapshot::forward> },
+        { "GetRight", &LuaWorkerVM::LuaGetVec3<&ActorSnapshot::right> },
+        { "GetUp", &LuaWorkerVM::LuaGetVec3<&ActorSnapshot::up> },
+        { "GetLinearVelocity", &LuaWorkerVM::LuaGetVec3<&ActorSnapshot::linearVelocity> },
+        { "GetAngularVelocity", &LuaWorkerVM::LuaGetVec3<&ActorSnapshot::angularVelocity> },
+        { "GetRotation", &LuaWorkerVM::LuaGetRotation },
+        { "GetName", &LuaWorkerVM::LuaGetName },
+        { "GetTag", &LuaWorkerVM::LuaGetTag },
+        { "Exists", &LuaWorkerVM::LuaExists },
+        { "FindByTag", &LuaWorkerVM::LuaFindByTag },
+        { "FindAllByTag", &LuaWorkerVM::LuaFindAllByTag },
+        { "FindNearestByTag", &LuaWorkerVM::LuaFindNearestByTag },
+        { "GetTime", &LuaWorkerVM::LuaGetTime },
+        { nullptr, nullptr }
+    };
+    lua_newtable(L);
+    luaL_setfuncs(L, sceneFunctions, 0);
+    lua_setglobal(L, "Scene");
+
+    // Writes, queued and applied on the main thread at the sync point
+    // Commands.AddForce(actor, 0, 100, 0)
+    static const luaL_Reg commandFunctions[] = {
+        { "SetPosition", &LuaWorkerVM::LuaPushCommand<LuaCommand::Type::SetPosition> },
+        { "Translate", &LuaWorkerVM::LuaPushCommand<LuaCommand::Type::Translate> },
+        { "SetRotation", &LuaWorkerVM::LuaPushCommand<LuaCommand::Type::SetRotation> },
+        { "Rotate", &LuaWorkerVM::LuaPushCommand<LuaCommand::Type::Rotate> },
+        { "SetScale", &LuaWorkerVM::LuaPushCommand<LuaCommand::Type::SetScale> },
+        { "LookAt", &LuaWorkerVM::LuaPushCommand<LuaCommand::Type::LookAt> },
+        { "AddForce", &LuaWorkerVM::LuaPushCommand<LuaCommand::Type::AddForce> },
+        { "AddTorque", &LuaWorkerVM::LuaPushCommand<LuaCommand::Type::AddTorque> },
+        { "AddImpulse", &LuaWorkerVM::LuaPushCommand<LuaCommand::Type::AddImpulse> },
+        { "SetLinearVelocity", &LuaWorkerVM::LuaPushCommand<LuaCommand::Type::SetLinearVelocity> },
+        { "SetAngularVelocity", &LuaWorkerVM::LuaPushCommand<LuaCommand::Type::SetAngularVelocity> },
+        { nullptr, nullptr }
+    };
+    lua_newtable(L);
+    luaL_setfuncs(L, commandFunctions, 0);
+    lua_setglobal(L, "Commands");
+
+    // Parallel.Update(function(dt) ... end), Parallel.FireEvent("name") wakes wait_event("name") in the main state
+    static const luaL_Reg parallelFunctions[] = {
+        { "Update", &LuaWorkerVM::LuaUpdate },
+        { "FireEvent", &LuaWorkerVM::LuaFireEvent },
+        { nullptr, nullptr }
+    };
+    lua_newtable(L);
+    luaL_setfuncs(L, parallelFunctions, 0);
+    lua_pushinteger(L, index);
+    lua_setfield(L, -2, "workerIndex");
+    lua_setglobal(L, "Parallel");
+}
+
+void LuaWorkerVM::LoadScript(LuaExecutor* executor, Actor* actor, const std::string& path, const std::string& source)
+{
+    Script script;
+    script.executor = executor;
+    script.actor = actor;
+    script.path = path;
+    script.env = sol::environment(lua, sol::create, lua.globals());
+    // Just a handle here, pass it to Scene / Commands
+    script.env["actor"] = sol::lightuserdata_value(actor);
+
+    std::string error;
+    sol::protected_function chunk = chunkCache.Instantiate(lua.lua_state(), path, source, script.env, error);
+    if (!chunk.valid())
+    {
+        printf("Lua Error: %s\n", error.c_str());
+        return;
+    }
+
+    scripts.push_back(std::move(script));
+
+    // The top level of the script runs now, that is where it connects Parallel.Update
+    loadingScript = &scripts.back();
+    sol::protected_function_result result = chunk();
+    loadingScript = nullptr;
+
+    if (!result.valid())
+    {
+        sol::error err = result;
+        printf("Lua Error: %s\n", err.what());
+        scripts.pop_back();
+    }
+}
+
+void LuaWorkerVM::RemoveScript(LuaExecutor* executor)
+{
+    scripts.erase(std::remove_if(scripts.begin(), scripts.end(), [executor](const Script& script) { return script.executor == executor; }),
+                  scripts.end());
+}
+
+void LuaWorkerVM::Tick(float deltaTime)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    for (Script& script : scripts)
+    {
+        for (sol::protected_function& callback : script.updateCallbacks)
+        {
+            sol::protected_function_result result = callback(deltaTime);
+            if (!result.valid())
+            {
+                sol::error err = result;
+                log.push_back(std::string("Lua Error: ") + err.what());
+            }
+        }
+    }
+
+    StepGarbageCollector();
+
+    lastTickMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void LuaWorkerVM::StepGarbageCollector()
+{
+    lua_State* L = lua.lua_state();
+    auto start = std::chrono::steady_clock::now();
+
+    // Same catch up rule as LuaManager::StepGarbageCollector
+    int heapKB = lua_gc(L, LUA_GCCOUNT);
+    float budgetScale = 1.0f;
+    if (liveHeapKB > 0 && heapKB > liveHeapKB * 2)
+        budgetScale = std::min(static_cast<float>(heapKB) / (liveHeapKB * 2), 8.0f);
+    auto budget = std::chrono::duration<float, std::milli>(gcBudgetMs * budgetScale);
+
+    do
+    {
+        if (lua_gc(L, LUA_GCSTEP, 8))
+        {
+            liveHeapKB = lua_gc(L, LUA_GCCOUNT);
+            break;
+        }
+    } while (std::chrono::steady_clock::now() - start < budget);
+}
+
+
+LuaWorkerVM& LuaWorkerVM::GetVM(lua_State* L)
+{
+    return **static_cast<LuaWorkerVM**>(lua_getextraspace(L));
+}
+
+const ActorSnapshot* LuaWorkerVM::CheckActor(lua_State* L, int arg)
+{
+    luaL_checktype(L, arg, LUA_TLIGHTUSERDATA);
+    return GetVM(L).snapshot.Find(static_cast<Actor*>(lua_touserdata(L, arg)));
+}
+
+template <glm::vec3 ActorSnapshot::*Field>
+int LuaWorkerVM::LuaGetVec3(lua_State* L)
+{
+    const ActorSnapshot* actor = CheckActor(L, 1);
+    if (actor == nullptr)
+        return 0;
+
+    const glm::vec3& value = actor->*Field;
+    lua_pushnumber(L, value.x);
+    lua_pushnumber(L, value.y);
+    lua_pushnumber(L, value.z);
+    return 3;
+}
+
+template <LuaCommand::Type Type>
+int LuaWorkerVM::LuaPushCommand(lua_State* L)
+{
+    luaL_checktype(L, 1, LUA_TLIGHTUSERDATA);
+    Actor* actor = static_cast<Actor*>(lua_touserdata(L, 1));
+    glm::vec3 value(static_cast<float>(luaL_checknumber(L, 2)), static_cast<float>(luaL_checknumber(L, 3)),
+                    static_cast<float>(luaL_checknumber(L, 4)));
+
+    GetVM(L).commands.push_back({ Type, actor, value });
+    return 0;
+}
+
+int LuaWorkerVM::LuaGetRotation(lua_State* L)
+{
+    const ActorSnapshot* actor = CheckActor(L, 1);
+    if (actor == nullptr)
+        return 0;
+
+    lua_pushnumber(L, actor->rotation.w);
+    lua_pushnumber(L, actor->rotation.x);
+    lua_pushnumber(L, actor->rotation.y);
+    lua_pushnumber(L, actor->rotation.z);
+    return 4;
+}
+
+int LuaWorkerVM::LuaGetName(lua_State* L)
+{
+    const ActorSnapshot* actor = CheckActor(L, 1);
+    if (actor == nullptr)
+        return 0;
+
+    lua_pushlstring(L, actor->name.data(), actor->name.size());
+    return 1;
+}
+
+int LuaWorkerVM::LuaGetTag(lua_State* L)
+{
+    const ActorSnapshot* actor = CheckActor(L, 1);
+    if (actor == nullptr)
+        return 0;
+
+    lua_pushlstring(L, actor->tag.data(), actor->tag.size());
+    return 1;
+}
+
+int LuaWorkerVM::LuaExists(lua_State* L)
+{
+    lua_pushboolean(L, lua_islightuserdata(L, 1) && CheckActor(L, 1) != nullptr);
+    return 1;
+}
+
+int LuaWorkerVM::LuaFindByTag(lua_State* L)
+{
+    const SceneSnapshot& snapshot = GetVM(L).snapshot;
+    auto it = snapshot.byTag.find(luaL_checkstring(L, 1));
+    if (it == snapshot.byTag.end() || it->second.empty())
+        return 0;
+
+    lua_pushlightuserdata(L, it->second.front());
+    return 1;
+}
+
+int LuaWorkerVM::LuaFindAllByTag(lua_State* L)
+{
+    const SceneSnapshot& snapshot = GetVM(L).snapshot;
+    auto it = snapshot.byTag.find(luaL_checkstring(L, 1));
+
+    int count = it != snapshot.byTag.end() ? static_cast<int>(it->second.size()) : 0;
+    lua_createtable(L, count, 0);
+    for (int i = 0; i < count; i++)
+    {
+        lua_pushlightuserdata(L, it->second[i]);
+        lua_rawseti(L, -2, i + 1);
+    }
+    return 1;
+}
+
+int LuaWorkerVM::LuaFindNearestByTag(lua_State* L)
+{
+    // local target, distance = Scene.FindNearestByTag("enemy", x, y, z)
+    const SceneSnapshot& snapshot = GetVM(L).snapshot;
+    auto it = snapshot.byTag.find(luaL_checkstring(L, 1));
+    glm::vec3 point(static_cast<float>(luaL_checknumber(L, 2)), static_cast<float>(luaL_checknumber(L, 3)),
+                    static_cast<float>(luaL_checknumber(L, 4)));
+    if (it == snapshot.byTag.end())
+        return 0;
+
+    Actor* nearest = nullptr;
+    float nearestDistance = std::numeric_limits<float>::max();
+    for (Actor* candidate : it->second)
+    {
+        const ActorSnapshot* actor = snapshot.Find(candidate);
+        glm::vec3 offset = actor->position - point;
+        float distance = glm::dot(offset, offset);
+        if (distance < nearestDistance)
+        {
+            nearestDistance = distance;
+            nearest = candidate;
+        }
+    }
+
+    if (nearest == nullptr)
+        return 0;
+
+    lua_pushlightuserdata(L, nearest);
+    lua_pushnumber(L, std::sqrt(nearestDistance));
+    return 2;
+}
+
+int LuaWorkerVM::LuaGetTime(lua_State* L)
+{
+    lua_pushnumber(L, GetVM(L).snapshot.time);
+    return 1;
+}
+
+int LuaWorkerVM::LuaUpdate(lua_State* L)
+{
+    luaL_checktype(L, 1, LUA_TFUNCTION);
+
+    LuaWorkerVM& vm = GetVM(L);
+    if (vm.loadingScript == nullptr)
+        return luaL_error(L, "Parallel.Update can only be called from the top level of a script");
+
+    vm.loadingScript->updateCallbacks.push_back(sol::protected_function(L, 1));
+    return 0;
+}
+
+int LuaWorkerVM::LuaFireEvent(lua_State* L)
+{
+    GetVM(L).events.push_back(luaL_checkstring(L, 1));
+    return 0;
+}
+
+int LuaWorkerVM::LuaPrint(lua_State* L)
+{
+    // Printed by the main thread at the sync point, so output from different workers never interleaves
+    std::string line = "[Worker " + std::to_string(GetVM(L).index) + "] ";
+    int count = lua_gettop(L);
+    for (int i = 1; i <= count; i++)
+    {
+        size_t length = 0;
+        const char* text = luaL_tolstring(L, i, &length);
+        if (i > 1)
+            line += "\t";
+        line.append(text, length);
+        lua_pop(L, 1);
+    }
+
+    GetVM(L).log.push_back(std::move(line));
+    return 0;
+}
+
+
+// ParallelLuaManager
+void ParallelLuaManager::AddScript(LuaExecutor* executor)
+{
+    // Read it now on the main thread, the VFS isnt touched from the workers
+    FileData source = VirtualFileSystem::GetInstance().Read(executor->filePath);
+    if (!source)
+    {
+        std::cerr << "Failed to open lua script " << executor->filePath << std::endl;
+        return;
+    }
+
+    pendingAdds.push_back({ executor, executor->owner, executor->filePath, std::string(source.View()) });
+}
+
+void ParallelLuaManager::RemoveScript(LuaExecutor* executor)
+{
+    // Never made it in, just forget it
+    pendingAdds.erase(std::remove_if(pendingAdds.begin(), pendingAdds.end(), [executor](const PendingAdd& add) { return add.executor == executor; }),
+                      pendingAdds.end());
+
+    if (assignments.find(executor) != assignments.end())
+        pendingRemoves.push_back(executor);
+}
+
+void ParallelLuaManager::EnsureStarted()
+{
+    if (!vms.empty())
+        return;
+
+    int stateCount = std::max(1, workerCount);
+    for (int i = 0; i < stateCount; i++)
+        vms.push_back(std::make_unique<LuaWorkerVM>(i, snapshot));
+
+    if (workerCount > 0)
+    {
+        for (int i = 0; i < workerCount; i++)
+            threads.emplace_back(&ParallelLuaManager::WorkerLoop, this, i);
+    }
+
+    std::cout << "Started " << stateCount << " parallel Lua states" << (workerCount > 0 ? "" : " (inline)") << std::endl;
+}
+
+void ParallelLuaManager::ApplyPending()
+{
+    // Removes first, a hot reload queues a remove and an add for the same executor
+    for (LuaExecutor* executor : pendingRemoves)
+    {
+        auto it = assignments.find(executor);
+        if (it == assignments.end())
+            continue;
+
+        it->second->RemoveScript(executor);
+        assignments.erase(it);
+    }
+    pendingRemoves.clear();
+
+    if (pendingAdds.empty())
+        return;
+
+    EnsureStarted();
+
+    // Moved out first, loading a script can spawn actors that queue more adds
+    std::vector<PendingAdd> adds = std::move(pendingAdds);
+    pendingAdds.clear();
+
+    for (PendingAdd& add : adds)
+    {
+        // Least loaded state
+        LuaWorkerVM* vm = std::min_element(vms.begin(), vms.end(), [](const auto& a, const auto& b) {
+            return a->GetScriptCount() < b->GetScriptCount();
+        })->get();
+
+        vm->LoadScript(add.executor, add.actor, add.path, add.source);
+        assignments[add.executor] = vm;
+    }
+}
+
+void ParallelLuaManager::TakeSnapshot()
+{
+    snapshot.actors.clear();
+    snapshot.lookup.clear();
+    // Keep the tag lists around, the same tags show up every frame
+    for (auto& [tag, actors] : snapshot.byTag)
+        actors.clear();
+
+    std::vector<Actor*>* actors = SceneManager::GetInstance().GetActors();
+    snapshot.actors.reserve(actors->size());
+
+    for (Actor* actor : *actors)
+    {
+        Transform* transform = actor->transform;
+        RigidBody* rigidBody = actor->GetComponent<RigidBody>();
+
+        ActorSnapshot entry;
+        entry.actor = actor;
+        entry.name = actor->name;
+        entry.tag = actor->tag;
+        entry.position = transform->position;
+        entry.rotation = transform->rotation;
+        entry.eulerAngles = transform->eulerAngles;
+        entry.scale = transform->scale;
+        entry.forward = transform->forward;
+        entry.right = transform->right;
+        entry.up = transform->up;
+        entry.hasRigidBody = rigidBody != nullptr;
+        // The Jolt body only exists once the collider shape is ready, until then there is no velocity to read
+        bool hasBody = rigidBody && rigidBody->GetBody();
+        entry.linearVelocity = hasBody ? rigidBody->GetLinearVelocity() : glm::vec3(0.0f);
+        entry.angularVelocity = hasBody ? rigidBody->GetAngularVelocity() : glm::vec3(0.0f);
+
+        snapshot.lookup[actor] = snapshot.actors.size();
+        snapshot.byTag[actor->tag].push_back(actor);
+        snapshot.actors.push_back(std::move(entry));
+    }
+}
+
+void ParallelLuaManager::BeginFrame(float deltaTime)
+{
+    // Zero cost until the first parallel script shows up
+    if (vms.empty() && pendingAdds.empty())
+        return;
+
+    if (frameInFlight)
+        EndFrame();
+
+    snapshot.time += deltaTime;
+    TakeSnapshot();
+    ApplyPending();
+
+    lastCommandCount = 0;
+    frameInFlight = true;
+
+    if (threads.empty())
+    {
+        // Inline mode, still isolated states and deferred writes, just no threads
+        for (auto& vm : vms)
+            vm->Tick(deltaTime);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        frameDeltaTime = deltaTime;
+        workersRunning = static_cast<int>(threads.size());
+        frameIndex++;
+    }
+    wakeWorkers.notify_all();
+}
+
+void ParallelLuaManager::EndFrame()
+{
+    if (!frameInFlight)
+        return;
+
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        workersDone.wait(lock, [this]() { return workersRunning == 0; });
+    }
+    frameInFlight = false;
+
+    // Main thread scripts could have destroyed actors while the workers were running
+    std::vector<Actor*>* actors = SceneManager::GetInstance().GetActors();
+    std::unordered_set<Actor*> alive(actors->begin(), actors->end());
+
+    // Always in VM order, so the result doesnt depend on which worker finished first
+    for (auto& vm : vms)
+    {
+        for (const std::string& line : vm->log)
+            std::cout << line << std::endl;
+        vm->log.clear();
+
+        ApplyCommands(*vm, alive);
+
+        for (const std::string& event : vm->events)
+            LuaManager::GetInstance().FireEvent(event);
+        vm->events.clear();
+    }
+}
+
+void ParallelLuaManager::ApplyCommands(LuaWorkerVM& vm, const std::unordered_set<Actor*>& alive)
+{
+    for (const LuaCommand& command : vm.commands)
+    {
+        if (alive.find(command.actor) == alive.end())
+            continue;
+
+        Transform* transform = command.actor->transform;
+        switch (command.type)
+        {
+        case LuaCommand::Type::SetPosition: transform->SetPosition(command.value); continue;
+        case LuaCommand::Type::Translate: transform->Translate(command.value); continue;
+        case LuaCommand::Type::SetRotation: transform->SetRotation(command.value); continue;
+        case LuaCommand::Type::Rotate: transform->Rotate(command.value); continue;
+        case LuaCommand::Type::SetScale: transform->SetScale(command.value); continue;
+        case LuaCommand::Type::LookAt: transform->LookAt(command.value); continue;
+        default: break;
+        }
+
+        RigidBody* rigidBody = command.actor->GetComponent<RigidBody>();
+        if (rigidBody == nullptr)
+            continue;
+
+        switch (command.type)
+        {
+        case LuaCommand::Type::AddForce: rigidBody->AddForce(command.value); break;
+        case LuaCommand::Type::AddTorque: rigidBody->AddTorque(command.value); break;
+        case LuaCommand::Type::AddImpulse: rigidBody->AddImpulse(command.value); break;
+        case LuaCommand::Type::SetLinearVelocity: rigidBody->SetLinearVelocity(command.value); break;
+        case LuaCommand::Type::SetAngularVelocity: rigidBody->SetAngularVelocity(command.value); break;
+        default: break;
+        }
+    }
+
+    lastCommandCount += static_cast<int>(vm.commands.size());
+    vm.commands.clear();
+}
+
+void ParallelLuaManager::WorkerLoop(int worker)
+{
+    uint64_t seenFrame = 0;
+    while (true)
+    {
+        float deltaTime;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wakeWorkers.wait(lock, [this, seenFrame]() { return stopping || frameIndex != seenFrame; });
+            if (stopping)
+                return;
+
+            seenFrame = frameIndex;
+            deltaTime = frameDeltaTime;
+        }
+
+        vms[worker]->Tick(deltaTime);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            workersRunning--;
+        }
+        workersDone.notify_one();
+    }
+}
+
+void ParallelLuaManager::Shutdown()
+{
+    if (frameInFlight)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        workersDone.wait(lock, [this]() { return workersRunning == 0; });
+        frameInFlight = false;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wakeWorkers.notify_all();
+    for (std::thread& thread : threads)
+    {
+        if (thread.joinable())
+            thread.join();
+    }
+    threads.clear();
+    stopping = false;
+
+    vms.clear();
+    assignments.clear();
+    pendingAdds.clear();
+    pendingRemoves.clear();
+}
+
+
+int ParallelLuaManager::GetScriptCount() const
+{
+    int count = 0;
+    for (const auto& vm : vms)
+        count += vm->GetScriptCount();
+    return count;
+}
+
+float ParallelLuaManager::GetLastWorkerMs(int worker) const
+{
+    if (worker < 0 || worker >= static_cast<int>(vms.size()))
+        return 0.0f;
+    return vms[worker]->lastTickMs;
+}
@@ -1,12 +1,112 @@
 #include <Ice/Managers/PhysicsManager.h>
 #include <Ice/Components/Physics/RigidBody.h>
 
+#include <Jolt/Physics/Collision/RayCast.h>
+#include <Jolt/Physics/Collision/CastResult.h>
+#include <Jolt/Physics/Collision/CollisionCollectorImpl.h>
+#include <Jolt/Physics/Collision/BroadPhase/BroadPhaseQuery.h>
+#include <Jolt/Physics/Collision/NarrowPhaseQuery.h>
+#include <Jolt/Physics/Body/BodyLock.h>
+#include <Jolt/Physics/Body/BodyFilter.h>
+#include <Jolt/Physics/Collision/ShapeCast.h>
+#include <Jolt/Physics/Collision/CollideShape.h>
+#include <Jolt/Physics/Collision/Shape/SphereShape.h>
+#include <Jolt/Physics/Collision/Shape/BoxShape.h>
+#include <Jolt/Physics/StateRecorderImpl.h>
+
+#include <algorithm>
+#include <iostream>
+#include <chrono>
+#include <thread>
+
+#include <Ice/Utils/FileUtil.h>
+#include <JSON/json.h>
+
+using json = nlohmann::json;
+
 PhysicsManager& PhysicsManager::GetInstance()
 {
     static PhysicsManager instance; // Static local variable ensures a single instance
     return instance;
 }
 
+PhysicsLayerConfig::PhysicsLayerConfig()
+{
+    for (JPH::ObjectLayer layer = 0; layer < PhysicsLayer::Count; layer++)
+    {
+        collisionMasks[layer] = 0;
+        broadPhaseLayers[layer] = PhysicsBroadPhaseLayer::Moving;
+    }
+    broadPhaseLayers[PhysicsLayer::Static] = PhysicsBroadPhaseLayer::Static;
+    broadPhaseLayers[PhysicsLayer::Trigger] = PhysicsBroadPhaseLayer::Trigger;
+    broadPhaseLayers[PhysicsLayer::Debris] = PhysicsBroadPhaseLayer::Debris;
+
+    // Everything that moves (Dynamic and the user layers) hits everything except debris,
+    // static never hits static, triggers only care about moving bodies and debris only lands on static geometry
+    for (JPH::ObjectLayer layer = PhysicsLayer::Dynamic; layer < PhysicsLayer::Count; layer++)
+    {
+        if (layer == PhysicsLayer::Trigger || layer == PhysicsLayer::Debris)
+            continue;
+
+        SetCollision(layer, PhysicsLayer::Static, true);
+        SetCollision(layer, PhysicsLayer::Trigger, true);
+        for (JPH::ObjectLayer other = layer; other < PhysicsLayer::Count; other++)
+        {
+            if (other != PhysicsLayer::Trigger && other != PhysicsLayer::Debris)
+                SetCollision(layer, other, true);
+        }
+    }
+    SetCollision(PhysicsLayer::Debris, PhysicsLayer::Static, true);
+}
+
+void PhysicsLayerConfig::SetCollision(JPH::ObjectLayer layer1, JPH::ObjectLayer layer2, bool collide)
+{
+    if (layer1 >= PhysicsLayer::Count || layer2 >= PhysicsLayer::Count)
+        return;
+
+    // Always symmetric
+    if (collide)
+    {
+        collisionMasks[layer1] |= 1u << layer2;
+        collisionMasks[layer2] |= 1u << layer1;
+    }
+    else
+    {
+        collisionMasks[layer1] &= ~(1u << layer2);
+        collisionMasks[layer2] &= ~(1u << layer1);
+    }
+
+    RebuildBroadPhaseMasks();
+}
+
+void PhysicsLayerConfig::RebuildBroadPhaseMasks()
+{
+    // A layer has to look in a broadphase tree if any layer stored in that tree collides with it
+    for (JPH::ObjectLayer layer = 0; layer < PhysicsLayer::Count; layer++)
+    {
+        broadPhaseMasks[layer] = 0;
+        for (JPH::ObjectLayer other = 0; other < PhysicsLayer::Count; other++)
+        {
+            if (collisionMasks[layer] & (1u << other))
+                broadPhaseMasks[layer] |= 1u << static_cast<JPH::BroadPhaseLayer::Type>(broadPhaseLayers[other]);
+        }
+    }
+}
+
+
+PhysicsContactListener::EventBuffer& PhysicsContactListener::GetThreadBuffer()
+{
+    // There is only ever one listener, so a plain thread_local is enough to find this thread's buffer
+    thread_local EventBuffer* buffer = nullptr;
+    if (buffer == nullptr)
+    {
+        std::lock_guard<std::mutex> lock(buffersMutex);
+        buffers.push_back(std::make_unique<EventBuffer>());
+        buffer = buffers.back().get();
+    }
+    return *buffer;
+}
+
 void PhysicsContactListener::OnContactAdded(
     const JPH::Body& inBody1,
     const JPH::Body& inBody2,
@@ -17,32 +117,17 @@ void PhysicsContactListener::OnContactAdded(
     RigidBody* rb2 = reinterpret_cast<RigidBody*>(inBody2.GetUserData());
     
     if (!rb1 || !rb2) return;
-    
-    bool isTrigger1 = inBody1.IsSensor();
-    bool isTrigger2 = inBody2.IsSensor();
-    
-    // Store contact pair
-    BodyPairKey key(inBody1.GetID(), inBody2.GetID());
-    activeContacts[key] = {rb1, rb2};
-    
-    if (isTrigger1 || isTrigger2)
-    {
-        // Trigger interaction
-        if (!isTrigger1 && isTrigger2)
-        {
-            rb1->FireTriggerEntered(rb2);
-        }
-        if (!isTrigger2 && isTrigger1)
-        {
-            rb2->FireTriggerEntered(rb1);
-        }
-    }
-    else
-    {
-        // Normal collision
-        rb1->FireContactStarted(rb2);
-        rb2->FireContactStarted(rb1);
-    }
+
+    // Job thread, just record it
+    ContactEvent event{ BodyPairKey(inBody1.GetID(), inBody2.GetID()), true };
+    event.subShapes = (static_cast<uint64_t>(inManifold.mSubShapeID1.GetValue()) << 32) | inManifold.mSubShapeID2.GetValue();
+    bool body1First = inBody1.GetID().GetIndexAndSequenceNumber() < inBody2.GetID().GetIndexAndSequenceNumber();
+    event.rigidBody1 = body1First ? rb1 : rb2;
+    event.rigidBody2 = body1First ? rb2 : rb1;
+    event.isSensor1 = body1First ? inBody1.IsSensor() : inBody2.IsSensor();
+    event.isSensor2 = body1First ? inBody2.IsSensor() : inBody1.IsSensor();
+
+    GetThreadBuffer().events.push_back(event);
 }
 
 void PhysicsContactListener::OnContactPersisted(
@@ -51,73 +136,244 @@ void PhysicsContactListener::OnContactPersisted(
     const JPH::ContactManifold& inManifold,
     JPH::ContactSettings& ioSettings)
 {
-    // OnContacting and OnTriggerStay are handled in RigidBody::Update()
+    // OnContacting and OnTriggerStay come from PhysicsManager::DispatchStayCallbacks, for the awake bodies only
 }
 
 void PhysicsContactListener::OnContactRemoved(const JPH::SubShapeIDPair& inSubShapePair)
 {
-    BodyPairKey key(inSubShapePair.GetBody1ID(), inSubShapePair.GetBody2ID());
-    
-    auto it = activeContacts.find(key);
-    if (it == activeContacts.end())
+    ContactEvent event{ BodyPairKey(inSubShapePair.GetBody1ID(), inSubShapePair.GetBody2ID()), false };
+    event.subShapes = (static_cast<uint64_t>(inSubShapePair.GetSubShapeID1().GetValue()) << 32) | inSubShapePair.GetSubShapeID2().GetValue();
+
+    GetThreadBuffer().events.push_back(event);
+}
+
+void PhysicsContactListener::DispatchEvents()
+{
+    dispatching.clear();
+    for (auto& buffer : buffers)
     {
-        return;
+        dispatching.insert(dispatching.end(), buffer->events.begin(), buffer->events.end());
+        buffer->events.clear();
     }
-    
-    RigidBody* rb1 = it->second.first;
-    RigidBody* rb2 = it->second.second;
-    
-    if (rb1 && rb2)
+
+    if (dispatching.empty())
+        return;
+
+    // Same order every time no matter which thread found what. Adds go before removes for the same pair,
+    // so a compound shape swapping which sub shape is touching doesnt end and restart the contact.
+    std::sort(dispatching.begin(), dispatching.end(), [](const ContactEvent& a, const ContactEvent& b) {
+        if (a.key.value != b.key.value) return a.key.value < b.key.value;
+        if (a.added != b.added) return a.added;
+        return a.subShapes < b.subShapes;
+    });
+
+    // Index loop, a callback can destroy a rigid body which clears it out of the events left in here
+    for (size_t i = 0; i < dispatching.size(); i++)
     {
-        JPH::Body* body1 = rb1->GetBody();
-        JPH::Body* body2 = rb2->GetBody();
-        
-        if (!body1 || !body2)
-        {
-            activeContacts.erase(it);
-            return;
-        }
-        
-        bool isTrigger1 = body1->IsSensor();
-        bool isTrigger2 = body2->IsSensor();
-        
-        
-        if (isTrigger1 || isTrigger2)
+        const ContactEvent& event = dispatching[i];
+
+        if (event.added)
         {
-            if (!isTrigger1 && isTrigger2)
+            if (event.rigidBody1 == nullptr || event.rigidBody2 == nullptr)
+                continue;
+
+            auto [it, inserted] = activePairs.try_emplace(event.key);
+            ContactPair& pair = it->second;
+            if (inserted)
             {
-                rb1->FireTriggerExited(rb2);
+                pair.rigidBody1 = event.rigidBody1;
+                pair.rigidBody2 = event.rigidBody2;
+                pair.isSensor1 = event.isSensor1;
+                pair.isSensor2 = event.isSensor2;
             }
-            if (!isTrigger2 && isTrigger1)
+
+            if (pair.subShapeContacts++ == 0)
             {
-                rb2->FireTriggerExited(rb1);
+                // Copied, the callbacks can change the map
+                ContactPair started = pair;
+                FireStarted(started);
             }
         }
         else
         {
-            rb1->FireContactEnded(rb2);
-            rb2->FireContactEnded(rb1);
+            auto it = activePairs.find(event.key);
+            if (it == activePairs.end())
+                continue;
+
+            if (--it->second.subShapeContacts > 0)
+                continue;
+
+            ContactPair pair = it->second;
+            activePairs.erase(it);
+            FireEnded(pair);
         }
     }
-    
-    activeContacts.erase(it);
+    dispatching.clear();
+}
+
+void PhysicsContactListener::FireStarted(const ContactPair& pair)
+{
+    if (pair.isSensor1 || pair.isSensor2)
+    {
+        // Trigger interaction
+        if (!pair.isSensor1 && pair.isSensor2)
+            pair.rigidBody1->FireTriggerEntered(pair.rigidBody2);
+        if (!pair.isSensor2 && pair.isSensor1)
+            pair.rigidBody2->FireTriggerEntered(pair.rigidBody1);
+    }
+    else
+    {
+        // Normal collision
+        pair.rigidBody1->FireContactStarted(pair.rigidBody2);
+        pair.rigidBody2->FireContactStarted(pair.rigidBody1);
+    }
 }
 
+void PhysicsContactListener::FireEnded(const ContactPair& pair)
+{
+    if (pair.isSensor1 || pair.isSensor2)
+    {
+        if (!pair.isSensor1 && pair.isSensor2)
+            pair.rigidBody1->FireTriggerExited(pair.rigidBody2);
+        if (!pair.isSensor2 && pair.isSensor1)
+            pair.rigidBody2->FireTriggerExited(pair.rigidBody1);
+    }
+    else
+    {
+        pair.rigidBody1->FireContactEnded(pair.rigidBody2);
+        pair.rigidBody2->FireContactEnded(pair.rigidBody1);
+    }
+}
+
+void PhysicsContactListener::DiscardEvents()
+{
+    for (auto& buffer : buffers)
+        buffer->events.clear();
+}
+
+void PhysicsContactListener::ForgetRigidBody(RigidBody* rigidBody)
+{
+    for (auto it = activePairs.begin(); it != activePairs.end(); )
+    {
+        ContactPair& pair = it->second;
+        if (pair.rigidBody1 == rigidBody || pair.rigidBody2 == rigidBody)
+        {
+            RigidBody* other = pair.rigidBody1 == rigidBody ? pair.rigidBody2 : pair.rigidBody1;
+            other->ForgetContact(rigidBody);
+            it = activePairs.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+
+    // Destroyed from inside a callback, dont hand it to anything later in this dispatch
+    for (ContactEvent& event : dispatching)
+    {
+        if (event.rigidBody1 == rigidBody || event.rigidBody2 == rigidBody)
+        {
+            event.rigidBody1 = nullptr;
+            event.rigidBody2 = nullptr;
+        }
+    }
+}
+
+bool PhysicsSettings::Load(const std::string& path)
+{
+    if (!FileUtil::FileExists(FileUtil::SubstituteVariables(path)))
+        return false;
+
+    try
+    {
+        json data = json::parse(FileUtil::ReadFile(path));
+        maxBodies = data.value("maxBodies", maxBodies);
+        numBodyMutexes = data.value("numBodyMutexes", numBodyMutexes);
+        maxBodyPairs = data.value("maxBodyPairs", maxBodyPairs);
+        maxContactConstraints = data.value("maxContactConstraints", maxContactConstraints);
+        threadCount = data.value("threadCount", threadCount);
+        collisionSteps = data.value("collisionSteps", collisionSteps);
+        tempAllocatorMB = data.value("tempAllocatorMB", tempAllocatorMB);
+        deterministic = data.value("deterministic", deterministic);
+        snapshotHistory = data.value("snapshotHistory", snapshotHistory);
+        snapshotKeyframeInterval = data.value("snapshotKeyframeInterval", snapshotKeyframeInterval);
+    }
+    catch (json::exception& e)
+    {
+        std::cerr << "Failed to load physics settings " << path << ": " << e.what() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+
+void* TrackingTempAllocator::Allocate(JPH::uint size)
+{
+    if (size == 0)
+        return nullptr;
+
+    size_t alignedSize = JPH::AlignUp(size, JPH_RVECTOR_ALIGNMENT);
+    if (usage + alignedSize > capacity)
+    {
+        // Too small for this level, keep going on the heap and count it so it shows up in the stats
+        overflowCount++;
+        void* block = JPH::AlignedAllocate(size, JPH_RVECTOR_ALIGNMENT);
+        overflowBlocks.push_back(block);
+        return block;
+    }
+
+    usage += alignedSize;
+    peakUsage = std::max(peakUsage, usage);
+    return inner.Allocate(size);
+}
+
+void TrackingTempAllocator::Free(void* address, JPH::uint size)
+{
+    if (address == nullptr)
+        return;
+
+    auto it = std::find(overflowBlocks.begin(), overflowBlocks.end(), address);
+    if (it != overflowBlocks.end())
+    {
+        JPH::AlignedFree(address);
+        overflowBlocks.erase(it);
+        return;
+    }
+
+    usage -= JPH::AlignUp(size, JPH_RVECTOR_ALIGNMENT);
+    inner.Free(address, size);
+}
+
+
 PhysicsManager::PhysicsManager()
 {
     JPH::Factory::sInstance = new JPH::Factory();
     JPH::RegisterTypes();
+
+    settings = startupSettings;
+    settings.Load(settingsPath);
+    settings.collisionSteps = std::max(1, settings.collisionSteps);
+
+    int threadCount = settings.threadCount >= 0 ? settings.threadCount : static_cast<int>(std::thread::hardware_concurrency()) - 1;
+    tempAllocator = std::make_unique<TrackingTempAllocator>(settings.tempAllocatorMB * 1024 * 1024);
+    jobSystem = std::make_unique<JPH::JobSystemThreadPool>(JPH::cMaxPhysicsJobs, JPH::cMaxPhysicsBarriers, std::max(0, threadCount));
     
     physicsSystem.Init(
-        maxBodies,
-        numBodyMutexes,
-        maxBodyPairs,
-        maxContactConstraints,
+        settings.maxBodies,
+        settings.numBodyMutexes,
+        settings.maxBodyPairs,
+        settings.maxContactConstraints,
         broadPhase,
         layerFilter,
         pairFilter
     );
 
+    JPH::PhysicsSettings physicsSettings = physicsSystem.GetPhysicsSettings();
+    physicsSettings.mDeterministicSimulation = settings.deterministic;
+    physicsSystem.SetPhysicsSettings(physicsSettings);
+
+    history.Configure(settings.snapshotHistory, settings.snapshotKeyframeInterval);
+
     // Register contact listener
     physicsSystem.SetContactListener(&contactListener);
 
@@ -133,12 +389,294 @@ PhysicsManager::~PhysicsManager()
 
 void PhysicsManager::Step(float fixedDeltaTime)
 {
-    physicsSystem.Update(
+    // Lots of static bodies were just added (level load), rebuild the trees once instead of stepping with unbalanced ones
+    if (broadPhaseDirty)
+    {
+        physicsSystem.OptimizeBroadPhase();
+        broadPhaseDirty = false;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    JPH::EPhysicsUpdateError errors = physicsSystem.Update(
         fixedDeltaTime,
-        1,                // collision steps
-        &tempAllocator,   // <-- REQUIRED
-        &jobSystem        // <-- REQUIRED
+        settings.collisionSteps,
+        tempAllocator.get(),
+        jobSystem.get()
     );
+    lastStepDeltaTime = fixedDeltaTime;
+    UpdateStats(errors, std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count());
+
+    CaptureActivePoses();
+    RecordSnapshot();
+
+    // Contact callbacks (which can run Lua) happen here on the main thread, never from inside the step
+    contactListener.DispatchEvents();
+    DispatchStayCallbacks(fixedDeltaTime);
+}
+
+void PhysicsManager::DispatchStayCallbacks(float fixedDeltaTime)
+{
+    // Only the bodies Jolt simulated this step, a sleeping pile of debris never gets here.
+    // Index loop over a copy, RemoveRigidBody nulls out bodies a callback destroys.
+    stayBodies = movingBodies;
+    for (size_t i = 0; i < stayBodies.size(); i++)
+    {
+        if (stayBodies[i] != nullptr)
+            stayBodies[i]->DispatchStayCallbacks(fixedDeltaTime);
+    }
+    stayBodies.clear();
+}
+
+void PhysicsManager::UpdateStats(JPH::EPhysicsUpdateError errors, float stepMs)
+{
+    stats.bodies = physicsSystem.GetNumBodies();
+    stats.peakBodies = std::max(stats.peakBodies, stats.bodies);
+    stats.peakActiveBodies = std::max(stats.peakActiveBodies, physicsSystem.GetNumActiveBodies(JPH::EBodyType::RigidBody));
+    stats.peakTempAllocatorBytes = tempAllocator->GetPeakUsage();
+    stats.tempAllocatorOverflows = tempAllocator->GetOverflowCount();
+    stats.lastStepMs = stepMs;
+    stats.peakStepMs = std::max(stats.peakStepMs, stepMs);
+
+    if (errors == JPH::EPhysicsUpdateError::None)
+        return;
+
+    // Jolt keeps going but drops contacts, say so the first time instead of objects silently falling through things
+    auto report = [errors](JPH::EPhysicsUpdateError flag, int& counter, const char* setting) {
+        if ((errors & flag) != flag)
+            return;
+        if (counter++ == 0)
+            std::cerr << "[Physics] Ran out of room, raise " << setting << " in the physics settings" << std::endl;
+    };
+    report(JPH::EPhysicsUpdateError::BodyPairCacheFull, stats.bodyPairCacheFullSteps, "maxBodyPairs");
+    report(JPH::EPhysicsUpdateError::ManifoldCacheFull, stats.manifoldCacheFullSteps, "maxContactConstraints");
+    report(JPH::EPhysicsUpdateError::ContactConstraintsFull, stats.contactConstraintsFullSteps, "maxContactConstraints");
+}
+
+void PhysicsManager::PrintStats() const
+{
+    std::cout << "[Physics] bodies " << stats.peakBodies << "/" << settings.maxBodies
+              << ", peak active " << stats.peakActiveBodies
+              << ", temp allocator peak " << stats.peakTempAllocatorBytes / 1024 << " KB/" << settings.tempAllocatorMB * 1024 << " KB"
+              << " (" << stats.tempAllocatorOverflows << " overflows)"
+              << ", steps out of body pairs " << stats.bodyPairCacheFullSteps
+              << ", out of manifolds " << stats.manifoldCacheFullSteps
+              << ", out of contact constraints " << stats.contactConstraintsFullSteps
+              << ", peak step " << stats.peakStepMs << " ms" << std::endl;
+}
+
+void PhysicsManager::CaptureActivePoses()
+{
+    stepIndex++;
+
+    // Only what Jolt simulated this step, sleeping bodies are skipped entirely
+    physicsSystem.GetActiveBodies(JPH::EBodyType::RigidBody, activeBodyIds);
+
+    // Nothing is writing to the bodies between steps, so no locks are needed
+    const JPH::BodyLockInterfaceNoLock& bodies = physicsSystem.GetBodyLockInterfaceNoLock();
+
+    std::vector<RigidBody*> previouslyMoving;
+    previouslyMoving.swap(movingBodies);
+    movingBodies.reserve(activeBodyIds.size());
+
+    for (const JPH::BodyID& id : activeBodyIds)
+    {
+        const JPH::Body* body = bodies.TryGetBody(id);
+        if (body == nullptr)
+            continue;
+
+        RigidBody* rigidBody = reinterpret_cast<RigidBody*>(body->GetUserData());
+        if (rigidBody == nullptr)
+            continue;
+
+        rigidBody->CapturePose(stepIndex);
+        movingBodies.push_back(rigidBody);
+    }
+
+    // Fell asleep this step, stop blending and write the resting pose once more
+    for (RigidBody* rigidBody : previouslyMoving)
+    {
+        if (rigidBody->GetCapturedStep() != stepIndex)
+        {
+            rigidBody->ResetPose();
+            settledBodies.push_back(rigidBody);
+        }
+    }
+}
+
+void PhysicsManager::SyncTransforms()
+{
+    for (RigidBody* rigidBody : movingBodies)
+        rigidBody->SyncTransform(interpolationAlpha, lastStepDeltaTime);
+
+    for (RigidBody* rigidBody : settledBodies)
+        rigidBody->SyncTransform(interpolationAlpha, lastStepDeltaTime);
+    settledBodies.clear();
+}
+
+void PhysicsManager::SaveState(std::vector<uint8_t>& outState) const
+{
+    JPH::StateRecorderImpl recorder;
+    physicsSystem.SaveState(recorder);
+
+    std::string data = recorder.GetData();
+    outState.assign(data.begin(), data.end());
+}
+
+bool PhysicsManager::RestoreState(const std::vector<uint8_t>& state)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    JPH::StateRecorderImpl recorder;
+    recorder.WriteBytes(state.data(), state.size());
+    if (!physicsSystem.RestoreState(recorder))
+    {
+        std::cerr << "[Physics] Failed to restore physics state, bodies were added or removed since it was saved" << std::endl;
+        return false;
+    }
+    RefreshAfterRestore();
+
+    stats.lastRestoreMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return true;
+}
+
+bool PhysicsManager::Rollback(uint64_t tick)
+{
+    if (!history.Get(tick, snapshotScratch))
+        return false;
+
+    // Set first, the restored bodies get captured at this tick
+    uint64_t currentTick = stepIndex;
+    stepIndex = tick;
+    if (!RestoreState(snapshotScratch))
+    {
+        stepIndex = currentTick;
+        return false;
+    }
+
+    history.DiscardAfter(tick);
+    return true;
+}
+
+void PhysicsManager::RecordSnapshot()
+{
+    if (!history.IsEnabled())
+        return;
+
+    auto start = std::chrono::steady_clock::now();
+    SaveState(snapshotScratch);
+    history.Push(stepIndex, snapshotScratch);
+
+    stats.lastSnapshotBytes = snapshotScratch.size();
+    stats.lastSaveMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void PhysicsManager::RefreshAfterRestore()
+{
+    // Whatever the rolled back step reported never happened
+    contactListener.DiscardEvents();
+
+    JPH::BodyIDVector bodyIds;
+    physicsSystem.GetBodies(bodyIds);
+    const JPH::BodyLockInterfaceNoLock& bodies = physicsSystem.GetBodyLockInterfaceNoLock();
+
+    // Any body could have moved, so every non static one gets its pose written once (no blending across the jump)
+    movingBodies.clear();
+    for (const JPH::BodyID& id : bodyIds)
+    {
+        const JPH::Body* body = bodies.TryGetBody(id);
+        if (body == nullptr || body->IsStatic())
+            continue;
+
+        RigidBody* rigidBody = reinterpret_cast<RigidBody*>(body->GetUserData());
+        if (rigidBody == nullptr)
+            continue;
+
+        rigidBody->ResetPose();
+        rigidBody->CapturePose(stepIndex);
+        if (body->IsActive())
+            movingBodies.push_back(rigidBody);
+        else
+            settledBodies.push_back(rigidBody);
+    }
+}
+
+void PhysicsManager::BenchmarkRollback(int ticks)
+{
+    uint64_t newest = stepIndex;
+    std::vector<uint8_t> expected;
+    if (ticks <= 0 || newest < static_cast<uint64_t>(ticks) || !history.Contains(newest - ticks) || !history.Get(newest, expected))
+    {
+        std::cout << "[Physics] Rollback benchmark needs " << ticks << " steps of history, raise snapshotHistory in the physics settings" << std::endl;
+        return;
+    }
+
+    // Everything the benchmark touches, put back at the end so the game carries on exactly as if it never ran.
+    // The contact pairs and the bodies' contact sets stay as they are, the resimulated steps discard their events
+    // instead of dispatching them (and nothing is queued between steps, events are dispatched at the end of Step).
+    std::vector<uint8_t> liveState;
+    SaveState(liveState);
+    SnapshotRingBuffer liveHistory = history;
+    std::vector<RigidBody*> liveMoving = movingBodies;
+    std::vector<RigidBody*> liveSettled = settledBodies;
+    PhysicsStats liveStats = stats;
+
+    // RefreshAfterRestore resets the pose of every non static body, not just the moving ones
+    std::vector<std::pair<RigidBody*, RigidBody::PoseState>> livePoses;
+    JPH::BodyIDVector bodyIds;
+    physicsSystem.GetBodies(bodyIds);
+    const JPH::BodyLockInterfaceNoLock& bodies = physicsSystem.GetBodyLockInterfaceNoLock();
+    for (const JPH::BodyID& id : bodyIds)
+    {
+        const JPH::Body* body = bodies.TryGetBody(id);
+        if (body == nullptr || body->IsStatic())
+            continue;
+
+        RigidBody* rigidBody = reinterpret_cast<RigidBody*>(body->GetUserData());
+        if (rigidBody != nullptr)
+            livePoses.emplace_back(rigidBody, rigidBody->SavePose());
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    if (!Rollback(newest - ticks))
+        return;
+    float restoreMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    // Physics only, the game doesnt get its fixed updates or contact callbacks again
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < ticks; i++)
+    {
+        physicsSystem.Update(lastStepDeltaTime, settings.collisionSteps, tempAllocator.get(), jobSystem.get());
+        CaptureActivePoses();
+        RecordSnapshot();
+        contactListener.DiscardEvents();
+    }
+    float resimulateMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    std::vector<uint8_t> actual;
+    SaveState(actual);
+
+    std::cout << "[Physics] Rollback of " << ticks << " steps: restore " << restoreMs << " ms, resimulate " << resimulateMs << " ms"
+              << ", snapshot " << expected.size() / 1024 << " KB, history " << history.GetMemoryUsage() / 1024 << " KB"
+              << (actual == expected ? ", deterministic" : ", DIVERGED from the recorded state") << std::endl;
+
+    // Back to the live world, gameplay may have moved bodies since the last step so this isnt the same as expected
+    stepIndex = newest;
+    RestoreState(liveState);
+    history = std::move(liveHistory);
+    movingBodies = std::move(liveMoving);
+    settledBodies = std::move(liveSettled);
+    for (const auto& [rigidBody, pose] : livePoses)
+        rigidBody->RestorePose(pose);
+    stats = liveStats;
+}
+
+void PhysicsManager::RemoveRigidBody(RigidBody* rigidBody)
+{
+    contactListener.ForgetRigidBody(rigidBody);
+
+    movingBodies.erase(std::remove(movingBodies.begin(), movingBodies.end(), rigidBody), movingBodies.end());
+    std::replace(stayBodies.begin(), stayBodies.end(), rigidBody, static_cast<RigidBody*>(nullptr));
+    settledBodies.erase(std::remove(settledBodies.begin(), settledBodies.end(), rigidBody), settledBodies.end());
 }
 
 
@@ -149,4 +687,254 @@ void PhysicsManager::SetGravity(const glm::vec3 gravity)
     // Force a verification in release too
     volatile auto g = physicsSystem.GetGravity();
     (void)g;
-}
\ No newline at end of file
+}
+
+
+// Query filters, built from a PhysicsQueryFilter for each query
+class QueryObjectLayerFilter : public JPH::ObjectLayerFilter
+{
+public:
+    explicit QueryObjectLayerFilter(JPH::uint32 layerMask) : layerMask(layerMask) {}
+
+    bool ShouldCollide(JPH::ObjectLayer layer) const override
+    {
+        return layer < 32 && (layerMask & (1u << layer)) != 0;
+    }
+
+private:
+    JPH::uint32 layerMask;
+};
+
+class QueryBodyFilter : public JPH::BodyFilter
+{
+public:
+    explicit QueryBodyFilter(const PhysicsQueryFilter& filter) : filter(filter) {}
+
+    bool ShouldCollideLocked(const JPH::Body& body) const override
+    {
+        if (!filter.includeTriggers && body.IsSensor())
+            return false;
+        return filter.ignore == nullptr || body.GetUserData() != reinterpret_cast<JPH::uint64>(filter.ignore);
+    }
+
+private:
+    const PhysicsQueryFilter& filter;
+};
+
+
+bool PhysicsManager::Raycast(glm::vec3 origin, glm::vec3 direction, float maxDistance, RaycastHit& hit, const PhysicsQueryFilter& filter)
+{
+    float length = glm::length(direction);
+    if (length <= 0.0f || maxDistance <= 0.0f)
+        return false;
+
+    // Jolt rays are origin + direction * fraction, so the direction carries the length
+    glm::vec3 ray = direction / length * maxDistance;
+    JPH::RRayCast rayCast{ JPH::RVec3(ToJolt(origin)), ToJolt(ray) };
+    JPH::RayCastResult result;
+    QueryObjectLayerFilter layerFilter(filter.layerMask);
+    QueryBodyFilter bodyFilter(filter);
+    if (!physicsSystem.GetNarrowPhaseQuery().CastRay(rayCast, result, {}, layerFilter, bodyFilter))
+        return false;
+
+    JPH::BodyLockRead lock(physicsSystem.GetBodyLockInterface(), result.mBodyID);
+    if (!lock.Succeeded())
+        return false;
+
+    const JPH::Body& body = lock.GetBody();
+    JPH::RVec3 point = rayCast.GetPointOnRay(result.mFraction);
+
+    hit.rigidBody = reinterpret_cast<RigidBody*>(body.GetUserData());
+    hit.actor = hit.rigidBody != nullptr ? hit.rigidBody->owner : nullptr;
+    hit.point = ToGLM(JPH::Vec3(point));
+    hit.normal = ToGLM(body.GetWorldSpaceSurfaceNormal(result.mSubShapeID2, point));
+    hit.distance = result.mFraction * maxDistance;
+    return hit.rigidBody != nullptr;
+}
+
+int PhysicsManager::RaycastAll(glm::vec3 origin, glm::vec3 direction, float maxDistance, std::vector<RaycastHit>& hits, const PhysicsQueryFilter& filter)
+{
+    float length = glm::length(direction);
+    if (length <= 0.0f || maxDistance <= 0.0f)
+        return 0;
+
+    glm::vec3 ray = direction / length * maxDistance;
+    JPH::RRayCast rayCast{ JPH::RVec3(ToJolt(origin)), ToJolt(ray) };
+    JPH::AllHitCollisionCollector<JPH::CastRayCollector> collector;
+    QueryObjectLayerFilter layerFilter(filter.layerMask);
+    QueryBodyFilter bodyFilter(filter);
+    physicsSystem.GetNarrowPhaseQuery().CastRay(rayCast, JPH::RayCastSettings(), collector, {}, layerFilter, bodyFilter);
+    collector.Sort();
+
+    // Mesh shapes can report a body more than once (one per triangle), only the nearest counts
+    int count = 0;
+    std::vector<JPH::BodyID> seen;
+    for (const JPH::RayCastResult& result : collector.mHits)
+    {
+        if (std::find(seen.begin(), seen.end(), result.mBodyID) != seen.end())
+            continue;
+        seen.push_back(result.mBodyID);
+
+        JPH::BodyLockRead lock(physicsSystem.GetBodyLockInterface(), result.mBodyID);
+        if (!lock.Succeeded())
+            continue;
+
+        const JPH::Body& body = lock.GetBody();
+        RigidBody* rigidBody = reinterpret_cast<RigidBody*>(body.GetUserData());
+        if (rigidBody == nullptr)
+            continue;
+
+        JPH::RVec3 point = rayCast.GetPointOnRay(result.mFraction);
+        RaycastHit& hit = hits.emplace_back();
+        hit.rigidBody = rigidBody;
+        hit.actor = rigidBody->owner;
+        hit.point = ToGLM(JPH::Vec3(point));
+        hit.normal = ToGLM(body.GetWorldSpaceSurfaceNormal(result.mSubShapeID2, point));
+        hit.distance = result.mFraction * maxDistance;
+        count++;
+    }
+    return count;
+}
+
+bool PhysicsManager::SphereCast(glm::vec3 origin, float radius, glm::vec3 direction, float maxDistance, RaycastHit& hit, const PhysicsQueryFilter& filter)
+{
+    if (radius <= 0.0f)
+        return Raycast(origin, direction, maxDistance, hit, filter);
+
+    JPH::SphereShape sphere(radius);
+    sphere.SetEmbedded();
+    return CastShape(sphere, origin, glm::quat(1.0f, 0.0f, 0.0f, 0.0f), direction, maxDistance, hit, filter);
+}
+
+bool PhysicsManager::BoxCast(glm::vec3 center, glm::vec3 halfExtents, glm::quat rotation, glm::vec3 direction, float maxDistance, RaycastHit& hit, const PhysicsQueryFilter& filter)
+{
+    float smallest = std::min(halfExtents.x, std::min(halfExtents.y, halfExtents.z));
+    if (smallest <= 0.0f)
+        return false;
+
+    // The convex radius cant be bigger than the box, thin probes would assert otherwise
+    JPH::BoxShape box(ToJolt(halfExtents), std::min(JPH::cDefaultConvexRadius, smallest));
+    box.SetEmbedded();
+    return CastShape(box, center, rotation, direction, maxDistance, hit, filter);
+}
+
+bool PhysicsManager::CastShape(const JPH::Shape& shape, glm::vec3 center, glm::quat rotation, glm::vec3 direction, float maxDistance, RaycastHit& hit, const PhysicsQueryFilter& filter)
+{
+    float length = glm::length(direction);
+    if (length <= 0.0f || maxDistance <= 0.0f)
+        return false;
+
+    // Everything is relative to the start position, keeps precision when far from the origin
+    JPH::RVec3 baseOffset(ToJolt(center));
+    JPH::RShapeCast shapeCast = JPH::RShapeCast::sFromWorldTransform(&shape, JPH::Vec3::sReplicate(1.0f),
+        JPH::RMat44::sRotationTranslation(ToJolt(rotation), baseOffset), ToJolt(direction / length * maxDistance));
+
+    JPH::ShapeCastSettings settings;
+    settings.mReturnDeepestPoint = true; // something already overlapping at the start is a hit at distance 0
+    JPH::ClosestHitCollisionCollector<JPH::CastShapeCollector> collector;
+    QueryObjectLayerFilter layerFilter(filter.layerMask);
+    QueryBodyFilter bodyFilter(filter);
+    physicsSystem.GetNarrowPhaseQuery().CastShape(shapeCast, settings, baseOffset, collector, {}, layerFilter, bodyFilter);
+    if (!collector.HadHit() || !ResolveHit(collector.mHit.mBodyID2, hit))
+        return false;
+
+    const JPH::ShapeCastResult& result = collector.mHit;
+    hit.point = ToGLM(JPH::Vec3(baseOffset + result.mContactPointOn2));
+    hit.normal = ToGLM(-result.mPenetrationAxis.NormalizedOr(JPH::Vec3::sZero()));
+    hit.distance = result.mFraction * maxDistance;
+    return true;
+}
+
+void PhysicsManager::OverlapSphere(glm::vec3 center, float radius, std::vector<RigidBody*>& results, const PhysicsQueryFilter& filter)
+{
+    if (radius <= 0.0f)
+        return;
+
+    JPH::SphereShape sphere(radius);
+    sphere.SetEmbedded();
+    CollideShape(sphere, center, glm::quat(1.0f, 0.0f, 0.0f, 0.0f), results, filter);
+}
+
+void PhysicsManager::OverlapBox(glm::vec3 center, glm::vec3 halfExtents, glm::quat rotation, std::vector<RigidBody*>& results, const PhysicsQueryFilter& filter)
+{
+    float smallest = std::min(halfExtents.x, std::min(halfExtents.y, halfExtents.z));
+    if (smallest <= 0.0f)
+        return;
+
+    JPH::BoxShape box(ToJolt(halfExtents), std::min(JPH::cDefaultConvexRadius, smallest));
+    box.SetEmbedded();
+    CollideShape(box, center, rotation, results, filter);
+}
+
+void PhysicsManager::CollideShape(const JPH::Shape& shape, glm::vec3 center, glm::quat rotation, std::vector<RigidBody*>& results, const PhysicsQueryFilter& filter)
+{
+    JPH::RVec3 baseOffset(ToJolt(center));
+    JPH::AllHitCollisionCollector<JPH::CollideShapeCollector> collector;
+    QueryObjectLayerFilter layerFilter(filter.layerMask);
+    QueryBodyFilter bodyFilter(filter);
+    physicsSystem.GetNarrowPhaseQuery().CollideShape(&shape, JPH::Vec3::sReplicate(1.0f), JPH::RMat44::sRotationTranslation(ToJolt(rotation), baseOffset),
+        JPH::CollideShapeSettings(), baseOffset, collector, {}, layerFilter, bodyFilter);
+
+    // One result per touching sub shape, so the same body can show up several times
+    size_t first = results.size();
+    const JPH::BodyInterface& bodies = physicsSystem.GetBodyInterface();
+    for (const JPH::CollideShapeResult& result : collector.mHits)
+    {
+        RigidBody* rigidBody = reinterpret_cast<RigidBody*>(bodies.GetUserData(result.mBodyID2));
+        if (rigidBody != nullptr && std::find(results.begin() + first, results.end(), rigidBody) == results.end())
+            results.push_back(rigidBody);
+    }
+}
+
+bool PhysicsManager::ResolveHit(const JPH::BodyID& bodyId, RaycastHit& hit)
+{
+    hit.rigidBody = reinterpret_cast<RigidBody*>(physicsSystem.GetBodyInterface().GetUserData(bodyId));
+    hit.actor = hit.rigidBody != nullptr ? hit.rigidBody->owner : nullptr;
+    return hit.rigidBody != nullptr;
+}
+
+void PhysicsManager::RaycastBatch(const std::vector<RaycastRequest>& rays, std::vector<RaycastHit>& hits, const PhysicsQueryFilter& filter)
+{
+    hits.assign(rays.size(), RaycastHit());
+
+    auto castRange = [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++)
+        {
+            if (!Raycast(rays[i].origin, rays[i].direction, rays[i].maxDistance, hits[i], filter))
+                hits[i] = RaycastHit();
+        }
+    };
+
+    // A few rays per job, not worth waking the workers for a handful
+    size_t raysPerJob = std::max<size_t>(16, rays.size() / (static_cast<size_t>(jobSystem->GetMaxConcurrency()) * 4));
+    if (rays.size() <= raysPerJob)
+    {
+        castRange(0, rays.size());
+        return;
+    }
+
+    JPH::JobSystem::Barrier* barrier = jobSystem->CreateBarrier();
+    for (size_t begin = 0; begin < rays.size(); begin += raysPerJob)
+    {
+        size_t end = std::min(begin + raysPerJob, rays.size());
+        JPH::JobHandle job = jobSystem->CreateJob("RaycastBatch", JPH::Color::sGreen, [&castRange, begin, end]() { castRange(begin, end); });
+        barrier->AddJob(job);
+    }
+    // The calling thread helps out with the jobs while it waits
+    jobSystem->WaitForJobs(barrier);
+    jobSystem->DestroyBarrier(barrier);
+}
+
+void PhysicsManager::OverlapSphereBounds(glm::vec3 center, float radius, std::vector<RigidBody*>& results)
+{
+    JPH::AllHitCollisionCollector<JPH::CollideShapeBodyCollector> collector;
+    physicsSystem.GetBroadPhaseQuery().CollideSphere(ToJolt(center), radius, collector);
+
+    const JPH::BodyInterface& bodies = physicsSystem.GetBodyInterface();
+    for (const JPH::BodyID& id : collector.mHits)
+    {
+        RigidBody* rigidBody = reinterpret_cast<RigidBody*>(bodies.GetUserData(id));
+        if (rigidBody != nullptr)
+            results.push_back(rigidBody);
+    }
+}
@@ -22,6 +22,7 @@ SceneManager& SceneManager::GetInstance()
 #include <Ice/Components/Rendering/Light.h>
 #include <Ice/Components/Freecam.h>
 #include <Ice/Components/Physics/RigidBody.h>
+#include <Ice/Managers/PhysicsManager.h>
 
 #include <Ice/Core/Skybox.h>
 #include <Ice/IEditor/GizmoRenderer.h>
@@ -31,6 +32,8 @@ SceneManager& SceneManager::GetInstance()
 
 #include <imgui/imgui.h>
 #include <typeinfo>
+#include <limits>
+#include <cmath>
 
 using namespace std::chrono;
 
@@ -53,11 +56,19 @@ SceneManager::SceneManager()
 // Deconstructor
 SceneManager::~SceneManager()
 {
-	for (int i = 0; i < actors->size(); i++)
+	DestroyAllActors();
+	delete actors;
+}
+
+void SceneManager::DestroyAllActors()
+{
+	// ~Actor removes itself from the list, so always delete the last one
+	while (!actors->empty())
 	{
-		delete actors->at(i);
+		delete actors->back();
 	}
-	delete actors;
+	mainCamera = nullptr;
+	hoveredActor = nullptr;
 }
 
 // Update
@@ -452,6 +463,9 @@ void SceneManager::Update()
 
 	Actor* currentHoveredActor = nullptr;
 	glm::vec3 hoveredColor;
+
+	// RigidBodies only need a tick while paused (the editor moving them), PhysicsManager does the rest for awake bodies only
+	bool isEnginePaused = EditorUI::GetInstance().IsEnginePaused() || WebEditorManager::GetInstance().IsEnginePaused();
 	
 	// Will read picking color AFTER rendering is complete
 	
@@ -469,17 +483,23 @@ void SceneManager::Update()
 		for (int j = 0; j < actors->at(i)->components->size(); j++)
 		{
 			Component* component = actors->at(i)->components->at(j);
+
+			if (dynamic_cast<RigidBody*>(component) != nullptr)
+			{
+				if (isEnginePaused)
+					component->Update();
+				continue;
+			}
 			
 			// Always update rendering components (Camera, Renderer, DirectionalLight, PointLight, SpotLight)
-			// and editor components (Freecam for camera control, RigidBody for transform sync)
+			// and editor components (Freecam for camera control)
 			// Only update gameplay components when not paused
 			bool isRenderingComponent = (dynamic_cast<Camera*>(component) != nullptr ||
 			                              dynamic_cast<Renderer*>(component) != nullptr ||
 			                              dynamic_cast<DirectionalLight*>(component) != nullptr ||
 			                              dynamic_cast<PointLight*>(component) != nullptr ||
 			                              dynamic_cast<SpotLight*>(component) != nullptr ||
-			                              dynamic_cast<Freecam*>(component) != nullptr ||
-			                              dynamic_cast<RigidBody*>(component) != nullptr);
+			                              dynamic_cast<Freecam*>(component) != nullptr);
 			
 			if (isRenderingComponent || isPlayingGame)
 			{
@@ -500,15 +520,14 @@ void SceneManager::Update()
 			Component* component = actors->at(i)->components->at(j);
 			
 			// Always update rendering components (Camera, Renderer, DirectionalLight, PointLight, SpotLight)
-			// and editor components (Freecam for camera control, RigidBody for transform sync)
+			// and editor components (Freecam for camera control)
 			// Only update gameplay components when not paused
 			bool isRenderingComponent = (dynamic_cast<Camera*>(component) != nullptr ||
 			                              dynamic_cast<Renderer*>(component) != nullptr ||
 			                              dynamic_cast<DirectionalLight*>(component) != nullptr ||
 			                              dynamic_cast<PointLight*>(component) != nullptr ||
 			                              dynamic_cast<SpotLight*>(component) != nullptr ||
-			                              dynamic_cast<Freecam*>(component) != nullptr ||
-			                              dynamic_cast<RigidBody*>(component) != nullptr);
+			                              dynamic_cast<Freecam*>(component) != nullptr);
 			
 			if (isRenderingComponent || isPlayingGame)
 			{
@@ -667,11 +686,17 @@ void SceneManager::AddActor(Actor* actor)
 	usedActorColors.push_back(color);
 	// set the color
 	actor->uniqueColor = color;
+
+	IndexAdd(nameIndex, actor->name, actor);
+	IndexAdd(tagIndex, actor->tag, actor);
 }
 
 // Remove Actor
 void SceneManager::RemoveActor(Actor* actor)
 {
+	IndexRemove(nameIndex, actor->name, actor);
+	IndexRemove(tagIndex, actor->tag, actor);
+
 	// loop through the actors
 	for (int i = 0; i < actors->size(); i++)
 	{
@@ -689,32 +714,116 @@ void SceneManager::RemoveActor(Actor* actor)
 }
 
 // Get Actor by Tag
-Actor* SceneManager::GetActorByTag(std::string tag)
+Actor* SceneManager::GetActorByTag(std::string_view tag)
 {
-	for (int i = 0; i < actors->size(); i++)
+	const std::vector<Actor*>& found = IndexFind(tagIndex, tag);
+	return found.empty() ? nullptr : found.front();
+}
+
+// Get Actors by Tag
+const std::vector<Actor*>& SceneManager::GetActorsByTag(std::string_view tag)
+{
+	return IndexFind(tagIndex, tag);
+}
+
+// Get Actor by Name
+Actor* SceneManager::GetActorByName(std::string_view name)
+{
+	const std::vector<Actor*>& found = IndexFind(nameIndex, name);
+	return found.empty() ? nullptr : found.front();
+}
+
+// Get Actors by Name
+const std::vector<Actor*>& SceneManager::GetActorsByName(std::string_view name)
+{
+	return IndexFind(nameIndex, name);
+}
+
+void SceneManager::OnActorRenamed(Actor* actor, const std::string& oldName)
+{
+	IndexRemove(nameIndex, oldName, actor);
+	IndexAdd(nameIndex, actor->name, actor);
+}
+
+void SceneManager::OnActorRetagged(Actor* actor, const std::string& oldTag)
+{
+	IndexRemove(tagIndex, oldTag, actor);
+	IndexAdd(tagIndex, actor->tag, actor);
+}
+
+void SceneManager::IndexAdd(ActorIndex& index, const std::string& key, Actor* actor)
+{
+	index[key].push_back(actor);
+}
+
+void SceneManager::IndexRemove(ActorIndex& index, const std::string& key, Actor* actor)
+{
+	auto it = index.find(key);
+	if (it == index.end())
+		return;
+
+	std::vector<Actor*>& list = it->second;
+	list.erase(std::remove(list.begin(), list.end(), actor), list.end());
+	if (list.empty())
+		index.erase(it);
+}
+
+const std::vector<Actor*>& SceneManager::IndexFind(const ActorIndex& index, std::string_view key)
+{
+	static const std::vector<Actor*> none;
+	auto it = index.find(key);
+	return it != index.end() ? it->second : none;
+}
+
+
+// Overlap Sphere
+void SceneManager::OverlapSphere(glm::vec3 center, float radius, std::vector<Actor*>& results, std::string_view tag)
+{
+	std::vector<RigidBody*> bodies;
+	PhysicsManager::GetInstance().OverlapSphereBounds(center, radius, bodies);
+
+	for (RigidBody* body : bodies)
 	{
-		if (actors->at(i)->tag == tag)
-		{
-			return actors->at(i);
-		}
+		Actor* actor = body->owner;
+		if (actor != nullptr && (tag.empty() || actor->tag == tag))
+			results.push_back(actor);
 	}
-	return nullptr;
 }
 
-// Get Actors by Tag
-std::vector<Actor*> SceneManager::GetActorsByTag(std::string tag)
+// Raycast
+Actor* SceneManager::Raycast(glm::vec3 origin, glm::vec3 direction, float maxDistance, glm::vec3* point, glm::vec3* normal, float* distance)
+{
+	PhysicsManager::RaycastHit hit;
+	if (!PhysicsManager::GetInstance().Raycast(origin, direction, maxDistance, hit))
+		return nullptr;
+
+	if (point) *point = hit.point;
+	if (normal) *normal = hit.normal;
+	if (distance) *distance = hit.distance;
+	return hit.actor;
+}
+
+// Nearest With Tag
+Actor* SceneManager::NearestWithTag(glm::vec3 position, std::string_view tag, float maxDistance, float* distance)
 {
-	std::vector<Actor*> actorsWithTag = std::vector<Actor*>();
+	// Only the actors with the tag, straight out of the index
+	Actor* nearest = nullptr;
+	float nearestDistance2 = maxDistance >= 0.0f ? maxDistance * maxDistance : std::numeric_limits<float>::max();
 
-	for (int i = 0; i < actors->size(); i++)
+	for (Actor* actor : IndexFind(tagIndex, tag))
 	{
-		if (actors->at(i)->tag == tag)
+		glm::vec3 offset = actor->transform->position - position;
+		float distance2 = glm::dot(offset, offset);
+		if (distance2 <= nearestDistance2)
 		{
-			actorsWithTag.push_back(actors->at(i));
+			nearestDistance2 = distance2;
+			nearest = actor;
 		}
 	}
 
-	return actorsWithTag;
+	if (nearest != nullptr && distance != nullptr)
+		*distance = std::sqrt(nearestDistance2);
+	return nearest;
 }
 
 
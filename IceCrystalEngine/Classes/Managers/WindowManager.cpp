@@ -3,6 +3,7 @@
 #include <iostream>
 
 #include "Ice/Utils/stb_image.h"
+#include <Ice/Utils/VirtualFileSystem.h>
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 
@@ -95,8 +96,12 @@ void WindowManager::InitializeWindow()
 
     // Set the window icon
     GLFWimage images[1];
-    images[0].pixels = stbi_load("Assets/Logo.png", &images[0].width, &images[0].height, 0, 4);
-    glfwSetWindowIcon(window, 1, images);
+    images[0].pixels = nullptr;
+    FileData logo = VirtualFileSystem::GetInstance().Read("{ASSET_DIR}Logo.png");
+    if (logo)
+        images[0].pixels = stbi_load_from_memory(logo.Bytes(), static_cast<int>(logo.Size()), &images[0].width, &images[0].height, 0, 4);
+    if (images[0].pixels)
+        glfwSetWindowIcon(window, 1, images);
     stbi_image_free(images[0].pixels);
 }
 
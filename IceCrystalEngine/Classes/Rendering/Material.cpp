@@ -3,18 +3,41 @@
 #include <iostream>
 #include <JSON/json.h>
 #include <Ice/Utils/FileUtil.h>
+#include <Ice/Rendering/ShaderCache.h>
+#include <Ice/Managers/HotReloadManager.h>
 
 using json = nlohmann::json;
 
 Material::Material()
 {
 	Material::InitializeMaterial();
+	reloadWatchId = HotReloadManager::GetInstance().Watch(materialPath, [this]() { Reload(); });
 }
 
 Material::Material(std::string path)
 {
 	materialPath = path;
 	Material::InitializeMaterial();
+	reloadWatchId = HotReloadManager::GetInstance().Watch(materialPath, [this]() { Reload(); });
+}
+
+Material::~Material()
+{
+	if (HotReloadManager::IsAlive())
+		HotReloadManager::GetInstance().Unwatch(reloadWatchId);
+}
+
+void Material::Reload()
+{
+	// Forget everything from the old file, properties that were removed shouldnt stick around
+	keywords.clear();
+	floatProperties.clear();
+	intProperties.clear();
+	vec2Properties.clear();
+	vec3Properties.clear();
+	vec4Properties.clear();
+
+	Material::InitializeMaterial();
 }
 
 void Material::InitializeMaterial()
@@ -40,9 +63,18 @@ void Material::InitializeMaterial()
 			texture = std::make_shared<Texture>();
 		}
 
-		// Get the shader path
+		// Get the shader path (materials using the same shader share one Shader and GL program)
+		// along with any permutation keywords it wants enabled
 		std::string shaderPath = jsonData["Shader"];
-		shader = std::make_shared<Shader>(shaderPath);
+		if (jsonData.contains("Keywords") && jsonData["Keywords"].is_array())
+		{
+			for (auto& keyword : jsonData["Keywords"])
+			{
+				if (keyword.is_string())
+					keywords.push_back(keyword.get<std::string>());
+			}
+		}
+		shader = ShaderCache::GetInstance().GetShader(shaderPath, keywords);
 
 		// Get the color
 		color = glm::vec3(jsonData["Color"][0], jsonData["Color"][1], jsonData["Color"][2]);
@@ -52,7 +84,7 @@ void Material::InitializeMaterial()
 		for (auto& [key, value] : jsonData.items())
 		{
 			// Skip known properties
-			if (key == "Name" || key == "Texture" || key == "Shader" || key == "Color" || key == "Smoothness")
+			if (key == "Name" || key == "Texture" || key == "Shader" || key == "Color" || key == "Smoothness" || key == "Keywords")
 				continue;
 
 			// Detect type and store accordingly
@@ -79,7 +111,7 @@ void Material::InitializeMaterial()
 		}
 		
 	}
-	catch (json::parse_error& e)
+	catch (json::exception& e) // parse errors, but also a wrong type in a half saved file while hot reloading
 	{
 		// Handle Errors
 		std::cout << "Failed to parse material file: " << materialPath << std::endl;
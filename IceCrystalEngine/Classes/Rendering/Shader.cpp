@@ -1,8 +1,12 @@
 #include <Ice/Rendering/Shader.h>
+#include <Ice/Rendering/ShaderCache.h>
+#include <Ice/Rendering/ShaderPreprocessor.h>
+#include <Ice/Managers/HotReloadManager.h>
 
 #include <Ice/Utils/FileUtil.h>
 #include <iostream>
 #include <fstream>
+#include <algorithm>
 
 #include <Ice/Managers/LightingManager.h>
 
@@ -12,20 +16,18 @@ Shader::Shader() : Handle(0) // This will just use default.vert and default.frag
 {
     InitializeShader();
 }
-Shader::Shader(std::string shaderName)
+Shader::Shader(std::string shaderName) : Shader(shaderName, std::vector<std::string>())
 {
-    if (!FileUtil::FileExists(shaderName + ".vert"))
+}
+Shader::Shader(std::string shaderName, const std::vector<std::string>& keywords) : Keywords(keywords)
+{
+    // Fall back to the engine's default shader instead of killing the whole engine over a missing file
+    if (!FileUtil::FileExists(shaderName + ".vert") || !FileUtil::FileExists(shaderName + ".frag"))
     {
-        std::cerr << "Failed to load vertex shader: " << shaderName << "\n";
-        abort();
+        std::cerr << "Failed to load shader: " << shaderName << ", using the default shader instead\n";
+        shaderName = "{ENGINE_ASSET_DIR}Shaders/default";
     }
     VertexShaderPath = shaderName + ".vert";
-
-    if (!FileUtil::FileExists(shaderName + ".frag"))
-    {
-        std::cerr << "Failed to load fragment shader: " << shaderName << "\n";
-        abort();
-    }
     FragmentShaderPath = shaderName + ".frag";
 
     if (FileUtil::FileExists(shaderName + ".geom"))
@@ -55,95 +57,112 @@ void Shader::Use()
 	glUseProgram(Handle);
 }
 
+bool Shader::HasKeyword(const std::string& keyword) const
+{
+    return std::find(Keywords.begin(), Keywords.end(), keyword) != Keywords.end();
+}
+
 Shader::~Shader()
 {
+    UnwatchFiles();
+
     if (Handle != 0)
     {
-        glDeleteProgram(Handle);
+        ShaderCache::GetInstance().Release(Handle);
         Handle = 0;
     }
 }
 
-void Shader::InitializeShader()
+std::string Shader::PreprocessStage(const std::string& path)
 {
-    // Read the vertex shader file
-    std::string vertexShaderFileContents = FileUtil::ReadFile(VertexShaderPath);
-    const char* vertexShaderSource = vertexShaderFileContents.c_str();
+    ShaderPreprocessor::Result result = ShaderPreprocessor::Process(FileUtil::ReadFile(path), path, {}, Keywords);
 
-    // vertex shader
-    unsigned int vertexShader = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertexShader, 1, &vertexShaderSource, NULL);
-    glCompileShader(vertexShader);
+    // Keep track of everything this shader was built from (even if it failed) so fixing any of them triggers a reload
+    Files.insert(Files.end(), result.files.begin(), result.files.end());
 
-    int success;
-    char infoLog[512];
-    glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &success);
-    if (!success)
+    if (!result.success)
     {
-        glGetShaderInfoLog(vertexShader, 512, NULL, infoLog);
-        std::cout << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" << infoLog << std::endl;
+        std::cerr << "ERROR::SHADER::PREPROCESS_FAILED\n" << result.error << std::endl;
+        return "";
     }
+    return result.source;
+}
 
-    
-	// Read the fragment shader file
-    std::string fragmentShaderFileContents = FileUtil::ReadFile(FragmentShaderPath);
-    const char* fragmentShaderSource = fragmentShaderFileContents.c_str();
+GLuint Shader::BuildProgram()
+{
+    Files.clear();
+
+    // Read the shader files and expand #includes / keywords
+    std::string vertexShaderFileContents = PreprocessStage(VertexShaderPath);
+    std::string fragmentShaderFileContents = PreprocessStage(FragmentShaderPath);
+    std::string geometryShaderFileContents;
+    if (!GeometryShaderPath.empty())
+        geometryShaderFileContents = PreprocessStage(GeometryShaderPath);
+
+    // Compile and link (or reuse an identical program that was already linked, in memory or on disk)
+    return ShaderCache::GetInstance().Acquire(vertexShaderFileContents, fragmentShaderFileContents, geometryShaderFileContents, VertexShaderPath);
+}
 
-    // fragment shader
-    unsigned int fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragmentShader, 1, &fragmentShaderSource, NULL);
-    glCompileShader(fragmentShader);
+void Shader::InitializeShader()
+{
+    Handle = BuildProgram();
 
-    glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &success);
-    if (!success)
+    // Set default values
+    Use();
+    setInt("directionalShadowMap", LightingManager::directionalShadowMapUnit);
+
+    WatchFiles();
+}
+
+bool Shader::Reload()
+{
+    GLuint program = BuildProgram();
+
+    // Files might have changed (new #include), so always rewatch
+    WatchFiles();
+
+    // Keep using the old program if the new one doesnt compile, so a typo doesnt kill the whole scene
+    if (program == 0)
     {
-        glGetShaderInfoLog(fragmentShader, 512, NULL, infoLog);
-        std::cout << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n" << infoLog << std::endl;
+        std::cerr << "Failed to reload shader " << VertexShaderPath << ", keeping the previous version" << std::endl;
+        return false;
     }
 
+    GLuint oldHandle = Handle;
+    Handle = program;
+    ShaderCache::GetInstance().Release(oldHandle);
 
-    // Read the geometry shader file
-    unsigned int geometryShader = 0;
-    if (!GeometryShaderPath.empty())
+    Use();
+    setInt("directionalShadowMap", LightingManager::directionalShadowMapUnit);
+    return true;
+}
+
+void Shader::WatchFiles()
+{
+    UnwatchFiles();
+
+    HotReloadManager& hotReloadManager = HotReloadManager::GetInstance();
+    for (const std::string& file : Files)
     {
-        std::string geometryShaderFileContents = FileUtil::ReadFile(GeometryShaderPath);
-        const char* geometryShaderSource = geometryShaderFileContents.c_str();
-
-        // geometry shader
-        geometryShader = glCreateShader(GL_GEOMETRY_SHADER);
-        glShaderSource(geometryShader, 1, &geometryShaderSource, NULL);
-        glCompileShader(geometryShader);
-        
-        glGetShaderiv(geometryShader, GL_COMPILE_STATUS, &success);
-        if (!success)
-        {
-            glGetShaderInfoLog(geometryShader, 512, NULL, infoLog);
-            std::cout << "ERROR::SHADER::GEOMETRY::COMPILATION_FAILED\n" << infoLog << std::endl;
-        }
+        reloadWatchIds.push_back(hotReloadManager.Watch(file, [this]() { Reload(); }));
     }
+}
 
-    // link shaders
-    Handle = glCreateProgram();
-    glAttachShader(Handle, vertexShader);
-    glAttachShader(Handle, fragmentShader);
-    if (geometryShader != 0)
+void Shader::UnwatchFiles()
+{
+    // Shaders cached in other singletons can be freed after the hot reload manager at exit
+    if (!HotReloadManager::IsAlive())
     {
-        glAttachShader(Handle, geometryShader);
+        reloadWatchIds.clear();
+        return;
     }
-    glLinkProgram(Handle);
 
-    glGetProgramiv(Handle, GL_LINK_STATUS, &success);
-    if (!success) {
-        glGetProgramInfoLog(Handle, 512, NULL, infoLog);
-        std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << " " << VertexShaderPath << std::endl;
+    HotReloadManager& hotReloadManager = HotReloadManager::GetInstance();
+    for (int id : reloadWatchIds)
+    {
+        hotReloadManager.Unwatch(id);
     }
-    glDeleteShader(vertexShader);
-    glDeleteShader(fragmentShader);
-    glDeleteShader(geometryShader);
-
-    // Set default values
-    Use();
-    setInt("directionalShadowMap", LightingManager::directionalShadowMapUnit);
+    reloadWatchIds.clear();
 }
 
 
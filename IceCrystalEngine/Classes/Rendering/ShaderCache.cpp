@@ -0,0 +1,267 @@
+#include <Ice/Rendering/ShaderCache.h>
+#include <Ice/Rendering/Shader.h>
+
+#include <Ice/Utils/FileUtil.h>
+#include <Ice/Utils/HashUtil.h>
+
+#include <iostream>
+#include <vector>
+#include <cstring>
+#include <algorithm>
+
+// Written in front of every program binary
+struct ShaderBinaryHeader
+{
+    uint32_t binaryFormat;
+    uint32_t binaryLength;
+};
+
+// Bump to invalidate every cached program binary
+static constexpr uint32_t SHADER_BINARY_VERSION = 2;
+
+
+void ShaderCache::QueryDriver()
+{
+    if (driverQueried) return;
+    driverQueried = true;
+
+    // Binaries are only valid for the exact driver that produced them
+    const char* vendor = reinterpret_cast<const char*>(glGetString(GL_VENDOR));
+    const char* renderer = reinterpret_cast<const char*>(glGetString(GL_RENDERER));
+    const char* version = reinterpret_cast<const char*>(glGetString(GL_VERSION));
+
+    driverHash = HashUtil::Hash(std::string_view(vendor ? vendor : ""));
+    driverHash = HashUtil::Hash(std::string_view(renderer ? renderer : ""), driverHash);
+    driverHash = HashUtil::Hash(std::string_view(version ? version : ""), driverHash);
+
+    GLint formatCount = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+    binariesSupported = formatCount > 0;
+}
+
+DerivedDataKey ShaderCache::GetBinaryKey(const std::string& vertexSource, const std::string& fragmentSource, const std::string& geometrySource)
+{
+    // Binaries are only valid for the exact driver that produced them
+    DerivedDataKey key("ShaderProgram", SHADER_BINARY_VERSION);
+    key.Add(driverHash);
+    key.Add(std::string_view(vertexSource));
+    key.Add(std::string_view(fragmentSource));
+    key.Add(std::string_view(geometrySource));
+    return key;
+}
+
+
+GLuint ShaderCache::Acquire(const std::string& vertexSource, const std::string& fragmentSource, const std::string& geometrySource, const std::string& debugName)
+{
+    QueryDriver();
+
+    uint64_t sourceHash = HashUtil::Hash(vertexSource);
+    sourceHash = HashUtil::Hash(fragmentSource, sourceHash);
+    sourceHash = HashUtil::Hash(geometrySource, sourceHash);
+
+    // Already linked this run
+    auto it = programs.find(sourceHash);
+    if (it != programs.end())
+    {
+        it->second.refCount++;
+        memoryHits++;
+        return it->second.handle;
+    }
+
+    // Linked on a previous run
+    GLuint program = 0;
+    DerivedDataKey binaryKey = GetBinaryKey(vertexSource, fragmentSource, geometrySource);
+    if (persistToDisk && binariesSupported)
+    {
+        program = LoadBinary(binaryKey);
+        if (program != 0)
+            diskHits++;
+    }
+
+    // Compile from source
+    if (program == 0)
+    {
+        program = CompileProgram(vertexSource, fragmentSource, geometrySource, debugName);
+        compiles++;
+
+        if (program != 0 && persistToDisk && binariesSupported)
+            SaveBinary(binaryKey, program);
+    }
+
+    if (program == 0)
+        return 0;
+
+    ProgramEntry& entry = programs[sourceHash];
+    entry.handle = program;
+    entry.refCount = 1;
+    programHashes[program] = sourceHash;
+    return program;
+}
+
+void ShaderCache::Release(GLuint program)
+{
+    if (program == 0) return;
+
+    auto hashIt = programHashes.find(program);
+    if (hashIt == programHashes.end())
+        return;
+
+    auto it = programs.find(hashIt->second);
+    if (it != programs.end() && --it->second.refCount <= 0)
+    {
+        glDeleteProgram(program);
+        programs.erase(it);
+        programHashes.erase(hashIt);
+    }
+}
+
+std::shared_ptr<Shader> ShaderCache::GetShader(const std::string& shaderName)
+{
+    return GetShader(shaderName, {});
+}
+
+std::shared_ptr<Shader> ShaderCache::GetShader(const std::string& shaderName, const std::vector<std::string>& keywords)
+{
+    // Sort the keywords so the order they were listed in doesnt create a separate variant
+    std::vector<std::string> sortedKeywords = keywords;
+    std::sort(sortedKeywords.begin(), sortedKeywords.end());
+    sortedKeywords.erase(std::unique(sortedKeywords.begin(), sortedKeywords.end()), sortedKeywords.end());
+
+    std::string key = FileUtil::SubstituteVariables(shaderName);
+    for (const std::string& keyword : sortedKeywords)
+        key += "|" + keyword;
+
+    auto it = shaders.find(key);
+    if (it != shaders.end())
+    {
+        if (std::shared_ptr<Shader> existing = it->second.lock())
+            return existing;
+    }
+
+    std::shared_ptr<Shader> shader = std::make_shared<Shader>(shaderName, sortedKeywords);
+    shaders[key] = shader;
+    return shader;
+}
+
+
+GLuint ShaderCache::LoadBinary(const DerivedDataKey& key)
+{
+    std::vector<uint8_t> data;
+    if (!DerivedDataCache::GetInstance().Get(key, data) || data.size() < sizeof(ShaderBinaryHeader))
+        return 0;
+
+    ShaderBinaryHeader header;
+    std::memcpy(&header, data.data(), sizeof(header));
+    if (header.binaryLength == 0 || header.binaryLength > data.size() - sizeof(header))
+        return 0;
+
+    GLuint program = glCreateProgram();
+    glProgramBinary(program, header.binaryFormat, data.data() + sizeof(header), header.binaryLength);
+
+    // The driver is allowed to reject a binary at any time (e.g. after an update), fall back to compiling if it does
+    int success;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (!success)
+    {
+        glDeleteProgram(program);
+        return 0;
+    }
+
+    return program;
+}
+
+void ShaderCache::SaveBinary(const DerivedDataKey& key, GLuint program)
+{
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+        return;
+
+    std::vector<uint8_t> data(sizeof(ShaderBinaryHeader) + length);
+    GLenum format = 0;
+    glGetProgramBinary(program, length, nullptr, &format, data.data() + sizeof(ShaderBinaryHeader));
+
+    ShaderBinaryHeader header;
+    header.binaryFormat = format;
+    header.binaryLength = static_cast<uint32_t>(length);
+    std::memcpy(data.data(), &header, sizeof(header));
+
+    DerivedDataCache::GetInstance().Put(key, data);
+}
+
+
+GLuint ShaderCache::CompileProgram(const std::string& vertexSource, const std::string& fragmentSource, const std::string& geometrySource, const std::string& debugName)
+{
+    const char* vertexShaderSource = vertexSource.c_str();
+
+    // vertex shader
+    unsigned int vertexShader = glCreateShader(GL_VERTEX_SHADER);
+    glShaderSource(vertexShader, 1, &vertexShaderSource, NULL);
+    glCompileShader(vertexShader);
+
+    int success;
+    char infoLog[512];
+    glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &success);
+    if (!success)
+    {
+        glGetShaderInfoLog(vertexShader, 512, NULL, infoLog);
+        std::cout << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" << infoLog << std::endl;
+    }
+
+    const char* fragmentShaderSource = fragmentSource.c_str();
+
+    // fragment shader
+    unsigned int fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+    glShaderSource(fragmentShader, 1, &fragmentShaderSource, NULL);
+    glCompileShader(fragmentShader);
+
+    glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &success);
+    if (!success)
+    {
+        glGetShaderInfoLog(fragmentShader, 512, NULL, infoLog);
+        std::cout << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n" << infoLog << std::endl;
+    }
+
+    // geometry shader
+    unsigned int geometryShader = 0;
+    if (!geometrySource.empty())
+    {
+        const char* geometryShaderSource = geometrySource.c_str();
+
+        geometryShader = glCreateShader(GL_GEOMETRY_SHADER);
+        glShaderSource(geometryShader, 1, &geometryShaderSource, NULL);
+        glCompileShader(geometryShader);
+
+        glGetShaderiv(geometryShader, GL_COMPILE_STATUS, &success);
+        if (!success)
+        {
+            glGetShaderInfoLog(geometryShader, 512, NULL, infoLog);
+            std::cout << "ERROR::SHADER::GEOMETRY::COMPILATION_FAILED\n" << infoLog << std::endl;
+        }
+    }
+
+    // link shaders
+    GLuint program = glCreateProgram();
+    // Ask the driver to keep the binary around so it can be written to disk
+    glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    glAttachShader(program, vertexShader);
+    glAttachShader(program, fragmentShader);
+    if (geometryShader != 0)
+    {
+        glAttachShader(program, geometryShader);
+    }
+    glLinkProgram(program);
+
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (!success) {
+        glGetProgramInfoLog(program, 512, NULL, infoLog);
+        std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << " " << debugName << std::endl;
+        glDeleteProgram(program);
+        program = 0;
+    }
+    glDeleteShader(vertexShader);
+    glDeleteShader(fragmentShader);
+    glDeleteShader(geometryShader);
+
+    return program;
+}
@@ -0,0 +1,197 @@
+#include <Ice/Rendering/ShaderPreprocessor.h>
+
+#include <Ice/Utils/FileUtil.h>
+
+#include <algorithm>
+#include <sstream>
+
+// Strip leading/trailing whitespace
+static std::string Trim(const std::string& str)
+{
+    size_t start = str.find_first_not_of(" \t\r");
+    if (start == std::string::npos) return "";
+    size_t end = str.find_last_not_of(" \t\r");
+    return str.substr(start, end - start + 1);
+}
+
+// Returns the text after a directive ("#include", "#pragma keywords") or nothing if the line isnt that directive
+static bool MatchDirective(const std::string& line, const std::string& directive, std::string& outRest)
+{
+    if (line.empty() || line[0] != '#')
+        return false;
+
+    // Allow whitespace between the # and the directive name ("#  include")
+    std::string compact = "#" + Trim(line.substr(1));
+    if (compact.compare(0, directive.size(), directive) != 0)
+        return false;
+
+    // Make sure we matched the whole word ("#include" shouldnt match "#includes")
+    if (compact.size() > directive.size() && compact[directive.size()] != ' ' && compact[directive.size()] != '\t' &&
+        compact[directive.size()] != '"' && compact[directive.size()] != '<')
+        return false;
+
+    outRest = Trim(compact.substr(directive.size()));
+    return true;
+}
+
+
+bool ShaderPreprocessor::ReadFromDisk(const std::string& path, std::string& outContents)
+{
+    if (!FileUtil::FileExists(path))
+        return false;
+
+    outContents = FileUtil::ReadFile(path);
+    return true;
+}
+
+std::string ShaderPreprocessor::GetDirectory(const std::string& path)
+{
+    size_t pos = path.find_last_of("\\/");
+    if (pos == std::string::npos)
+        return "";
+    return path.substr(0, pos + 1);
+}
+
+
+ShaderPreprocessor::Result ShaderPreprocessor::Process(const std::string& source, const std::string& path,
+                                                       const std::vector<std::string>& defines,
+                                                       const std::vector<std::string>& keywords,
+                                                       const FileReader& reader)
+{
+    Result result;
+    result.files.push_back(path);
+
+    if (!ProcessFile(source, 0, 0, reader, result))
+    {
+        result.success = false;
+        return result;
+    }
+
+    // Build the block of injected defines
+    std::string injected;
+    for (const std::string& define : defines)
+    {
+        injected += "#define " + define + "\n";
+    }
+    for (const std::string& keyword : keywords)
+    {
+        // Keywords the shader doesnt know about are dropped, so they dont create pointless variants
+        if (std::find(result.keywords.begin(), result.keywords.end(), keyword) != result.keywords.end())
+            injected += "#define " + keyword + "\n";
+    }
+
+    if (injected.empty())
+        return result;
+
+    // Defines have to come after #version (it must be the first thing in the shader)
+    size_t versionPos = result.source.find("#version");
+    if (versionPos == std::string::npos)
+    {
+        result.source = injected + "#line 1 0\n" + result.source;
+        return result;
+    }
+
+    size_t lineEnd = result.source.find('\n', versionPos);
+    if (lineEnd == std::string::npos)
+    {
+        result.source += "\n" + injected;
+        return result;
+    }
+
+    // Count which line of the root file comes next so error messages still point at the right line
+    int nextLine = 1 + static_cast<int>(std::count(result.source.begin(), result.source.begin() + lineEnd, '\n')) + 1;
+    result.source.insert(lineEnd + 1, injected + "#line " + std::to_string(nextLine) + " 0\n");
+    return result;
+}
+
+
+bool ShaderPreprocessor::ProcessFile(const std::string& source, int fileIndex, int depth, const FileReader& reader, Result& result)
+{
+    if (depth > maxIncludeDepth)
+    {
+        result.error = "Include depth exceeded " + std::to_string(maxIncludeDepth) + " in " + result.files[fileIndex];
+        return false;
+    }
+
+    // Some of the shaders are saved with a UTF-8 BOM, which the GLSL compiler chokes on
+    size_t start = source.compare(0, 3, "\xEF\xBB\xBF") == 0 ? 3 : 0;
+
+    std::istringstream stream(source.substr(start));
+    std::string rawLine;
+    int lineNumber = 0;
+
+    while (std::getline(stream, rawLine))
+    {
+        lineNumber++;
+        std::string line = Trim(rawLine);
+        std::string rest;
+
+        // #include "file"
+        if (MatchDirective(line, "#include", rest))
+        {
+            if (rest.size() < 2 || !((rest.front() == '"' && rest.back() == '"') || (rest.front() == '<' && rest.back() == '>')))
+            {
+                result.error = result.files[fileIndex] + "(" + std::to_string(lineNumber) + "): malformed #include";
+                return false;
+            }
+
+            std::string includeName = rest.substr(1, rest.size() - 2);
+
+            // Absolute and {VARIABLE} paths are used as is, everything else is relative to the including file
+            std::string includePath = includeName;
+            bool isAbsolute = includeName[0] == '/' || includeName[0] == '{' || includeName.find(':') != std::string::npos;
+            if (!isAbsolute)
+                includePath = GetDirectory(result.files[fileIndex]) + includeName;
+
+            // Only include each file once
+            if (std::find(result.files.begin(), result.files.end(), includePath) != result.files.end())
+            {
+                result.source += "\n";
+                continue;
+            }
+
+            std::string includeSource;
+            if (!reader(includePath, includeSource))
+            {
+                result.error = result.files[fileIndex] + "(" + std::to_string(lineNumber) + "): failed to open include " + includePath;
+                return false;
+            }
+
+            int includeIndex = static_cast<int>(result.files.size());
+            result.files.push_back(includePath);
+
+            result.source += "#line 1 " + std::to_string(includeIndex) + "\n";
+            if (!ProcessFile(includeSource, includeIndex, depth + 1, reader, result))
+                return false;
+            result.source += "#line " + std::to_string(lineNumber + 1) + " " + std::to_string(fileIndex) + "\n";
+            continue;
+        }
+
+        // #pragma keywords A B C
+        if (MatchDirective(line, "#pragma keywords", rest))
+        {
+            std::istringstream keywordStream(rest);
+            std::string keyword;
+            while (keywordStream >> keyword)
+            {
+                if (std::find(result.keywords.begin(), result.keywords.end(), keyword) == result.keywords.end())
+                    result.keywords.push_back(keyword);
+            }
+            // keep an empty line so line numbers stay the same
+            result.source += "\n";
+            continue;
+        }
+
+        // Only the root file gets a #version
+        if (fileIndex != 0 && MatchDirective(line, "#version", rest))
+        {
+            result.source += "\n";
+            continue;
+        }
+
+        result.source += rawLine;
+        result.source += "\n";
+    }
+
+    return true;
+}
@@ -4,6 +4,11 @@
 
 #include <iostream>
 #include <Ice/Utils/FileUtil.h>
+#include <Ice/Managers/HotReloadManager.h>
+#include <Ice/Utils/VirtualFileSystem.h>
+#include <Ice/Utils/DerivedDataCache.h>
+
+#include <cstring>
 
 Texture::Texture()
 {
@@ -16,6 +21,13 @@ Texture::Texture(std::string texturePath)
 	InitializeTexture();
 }
 
+Texture::~Texture()
+{
+	if (HotReloadManager::IsAlive())
+		HotReloadManager::GetInstance().Unwatch(reloadWatchId);
+	glDeleteTextures(1, &Handle);
+}
+
 
 
 void Texture::InitializeTexture()
@@ -36,27 +48,83 @@ void Texture::InitializeTexture()
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
+	UploadImage();
+
+	reloadWatchId = HotReloadManager::GetInstance().Watch(TexturePath, [this]() { Reload(); });
+}
+
+void Texture::Reload()
+{
+	// Upload into the same handle so everything already pointing at it picks up the new image
+	UploadImage();
+}
+
+// Decoded images are cached as [width][height][channels] followed by the raw pixels
+struct CookedTextureHeader
+{
+	int32_t width;
+	int32_t height;
+	int32_t channels;
+};
+
+bool Texture::LoadPixels(std::vector<uint8_t>& outCooked)
+{
+	FileData file = VirtualFileSystem::GetInstance().Read(TexturePath);
+	if (!file)
+		return false;
+
+	// Decoding PNGs is slow, reading the decoded pixels back is not
+	DerivedDataKey key("Texture", TEXTURE_COOKER_VERSION);
+	key.Add(file.Span());
+	key.Add(std::string_view("flip"));
+
+	DerivedDataCache& derivedDataCache = DerivedDataCache::GetInstance();
+	if (derivedDataCache.Get(key, outCooked) && outCooked.size() >= sizeof(CookedTextureHeader))
+		return true;
+
 	// set flip on load to true
 	stbi_set_flip_vertically_on_load(true);
-	
-	// Load the image
+
 	int width, height, nrChannels;
-	unsigned char* data = stbi_load(TexturePath.c_str(), &width, &height, &nrChannels, 0);
-	if (data)
-	{
-		GLenum format = GL_RGB;
-		if (nrChannels == 4)
-			format = GL_RGBA;
-		else if (nrChannels == 1)
-			format = GL_RED;
-    
-		glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-		glGenerateMipmap(GL_TEXTURE_2D);
-	}
-	else
+	unsigned char* data = stbi_load_from_memory(file.Bytes(), static_cast<int>(file.Size()), &width, &height, &nrChannels, 0);
+	if (!data)
+		return false;
+
+	CookedTextureHeader header = { width, height, nrChannels };
+	size_t pixelSize = static_cast<size_t>(width) * height * nrChannels;
+	outCooked.resize(sizeof(header) + pixelSize);
+	std::memcpy(outCooked.data(), &header, sizeof(header));
+	std::memcpy(outCooked.data() + sizeof(header), data, pixelSize);
+
+	// Free the image memory
+	stbi_image_free(data);
+
+	derivedDataCache.Put(key, outCooked);
+	return true;
+}
+
+void Texture::UploadImage()
+{
+	glBindTexture(GL_TEXTURE_2D, Handle);
+
+	// Load the image
+	std::vector<uint8_t> cooked;
+	if (!LoadPixels(cooked))
 	{
 		std::cout << "Failed to load texture: " << TexturePath << std::endl;
+		return;
 	}
-	// Free the image memory
-	stbi_image_free(data);
-}
\ No newline at end of file
+
+	CookedTextureHeader header;
+	std::memcpy(&header, cooked.data(), sizeof(header));
+	const uint8_t* data = cooked.data() + sizeof(header);
+
+	GLenum format = GL_RGB;
+	if (header.channels == 4)
+		format = GL_RGBA;
+	else if (header.channels == 1)
+		format = GL_RED;
+
+	glTexImage2D(GL_TEXTURE_2D, 0, format, header.width, header.height, 0, format, GL_UNSIGNED_BYTE, data);
+	glGenerateMipmap(GL_TEXTURE_2D);
+}
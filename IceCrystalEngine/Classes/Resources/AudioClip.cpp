@@ -1,9 +1,11 @@
 ﻿#include <Ice/Resources/AudioClip.h>
+#include <Ice/Resources/AudioDecoder.h>
 
 #include <fstream>
 #include <vector>
 #include <cstring>
 #include <iostream>
+#include <memory>
 
 AudioClip::AudioClip()
     : buffer(0)
@@ -11,6 +13,9 @@ AudioClip::AudioClip()
     , duration(0.0f)
     , sampleRate(0)
     , channels(0)
+    , bitsPerSample(0)
+    , frameCount(0)
+    , streaming(false)
 {
 }
 
@@ -19,16 +24,35 @@ AudioClip::~AudioClip()
     Unload();
 }
 
-bool AudioClip::LoadFromFile(const std::string& filepath)
+bool AudioClip::LoadFromFile(const std::string& filepath, bool streaming)
 {
     Unload();
 
-    if (filepath.size() >= 4 && filepath.substr(filepath.size() - 4) == ".wav")
+    if (!AudioDecoder::IsSupported(filepath))
     {
-        return LoadWAV(filepath);
+        return false;
+    }
+
+    if (!streaming)
+    {
+        return Decode(filepath) && Upload();
+    }
+
+    // Only the header is read here, the samples stay on disk until an AudioStream asks for them
+    std::unique_ptr<AudioDecoder> decoder = AudioDecoder::Open(filepath);
+    if (decoder == nullptr)
+    {
+        return false;
     }
 
-    return false;
+    sampleRate = decoder->GetSampleRate();
+    channels = decoder->GetChannels();
+    bitsPerSample = decoder->GetBitsPerSample();
+    frameCount = decoder->GetFrameCount();
+    duration = static_cast<float>(frameCount) / sampleRate;
+    path = filepath;
+    this->streaming = true;
+    return true;
 }
 
 void AudioClip::Unload()
@@ -43,9 +67,15 @@ void AudioClip::Unload()
         alDeleteBuffers(1, &monoBuffer);
         monoBuffer = 0;
     }
+    rawData.clear();
+    rawData.shrink_to_fit();
     duration = 0.0f;
     sampleRate = 0;
     channels = 0;
+    bitsPerSample = 0;
+    frameCount = 0;
+    streaming = false;
+    path.clear();
 }
 
 ALuint AudioClip::GetMonoBuffer()
@@ -103,121 +133,72 @@ void AudioClip::CreateMonoBuffer()
     alBufferData(monoBuffer, monoFormat, monoData.data(), monoData.size(), sampleRate);
 }
 
-bool AudioClip::LoadWAV(const std::string& filepath)
+bool AudioClip::Decode(const std::string& filepath)
 {
-    std::ifstream file(filepath, std::ios::binary);
-    if (!file.is_open())
+    std::unique_ptr<AudioDecoder> decoder = AudioDecoder::Open(filepath);
+    if (decoder == nullptr)
     {
-        std::cout << "Failed to open file " << filepath << std::endl;
         return false;
     }
 
-    // RIFF header
-    char riff[4];
-    file.read(riff, 4);
-    if (strncmp(riff, "RIFF", 4) != 0)
+    sampleRate = decoder->GetSampleRate();
+    channels = decoder->GetChannels();
+    bitsPerSample = decoder->GetBitsPerSample();
+    path = filepath;
+
+    // The frame count can be missing from a FLAC header, so decode until it runs out rather than trusting it
+    const size_t frameSize = decoder->GetFrameSize();
+    const size_t chunkFrames = 64 * 1024;
+    rawData.clear();
+    rawData.reserve(static_cast<size_t>(decoder->GetFrameCount()) * frameSize);
+
+    size_t frames = 0;
+    for (;;)
     {
-        std::cout << "File does not appear to be a valid WAV file!" << std::endl;
-        return false;
+        rawData.resize((frames + chunkFrames) * frameSize);
+        size_t read = decoder->Read(rawData.data() + frames * frameSize, chunkFrames);
+        frames += read;
+        if (read < chunkFrames)
+            break;
     }
+    rawData.resize(frames * frameSize);
 
-    file.seekg(4, std::ios::cur);
+    frameCount = frames;
+    duration = static_cast<float>(frames) / sampleRate;
+    return frames > 0;
+}
 
-    // WAVE header
-    char wave[4];
-    file.read(wave, 4);
-    if (strncmp(wave, "WAVE", 4) != 0)
+bool AudioClip::Upload()
+{
+    if (rawData.empty())
     {
-        std::cout << "File does not appear to be a valid WAV file!" << std::endl;
         return false;
     }
 
-    // Find fmt chunk
-    char chunkId[4];
-    uint32_t chunkSize;
-
-    while (file.read(chunkId, 4))
+    // Determine OpenAL format
+    ALenum format;
+    if (channels == 1)
+    {
+        format = (bitsPerSample == 8) ? AL_FORMAT_MONO8 : AL_FORMAT_MONO16;
+    }
+    else
     {
-        file.read(reinterpret_cast<char*>(&chunkSize), 4);
+        format = (bitsPerSample == 8) ? AL_FORMAT_STEREO8 : AL_FORMAT_STEREO16;
+    }
 
-        if (strncmp(chunkId, "fmt ", 4) == 0)
-        {
-            uint16_t audioFormat;
-            uint16_t numChannels;
-            uint32_t sampleRateVal;
-            uint32_t byteRate;
-            uint16_t blockAlign;
-
-            file.read(reinterpret_cast<char*>(&audioFormat), 2);
-            file.read(reinterpret_cast<char*>(&numChannels), 2);
-            file.read(reinterpret_cast<char*>(&sampleRateVal), 4);
-            file.read(reinterpret_cast<char*>(&byteRate), 4);
-            file.read(reinterpret_cast<char*>(&blockAlign), 2);
-            file.read(reinterpret_cast<char*>(&bitsPerSample), 2);
-
-            // Skip any extra format bytes
-            if (chunkSize > 16)
-            {
-                file.seekg(chunkSize - 16, std::ios::cur);
-            }
-
-            channels = numChannels;
-            sampleRate = sampleRateVal;
-
-            // Determine OpenAL format
-            ALenum format;
-            if (numChannels == 1)
-            {
-                format = (bitsPerSample == 8) ? AL_FORMAT_MONO8 : AL_FORMAT_MONO16;
-            }
-            else
-            {
-                format = (bitsPerSample == 8) ? AL_FORMAT_STEREO8 : AL_FORMAT_STEREO16;
-            }
-
-            // Find data chunk
-            while (file.read(chunkId, 4))
-            {
-                file.read(reinterpret_cast<char*>(&chunkSize), 4);
-
-                if (std::strncmp(chunkId, "data", 4) == 0)
-                {
-                    std::vector<char> data(chunkSize);
-                    file.read(data.data(), chunkSize);
-
-                    // Store for potential mono conversion
-                    rawData = data;
-                    
-                    // Calculate duration
-                    duration = static_cast<float>(chunkSize) / (sampleRateVal * numChannels * (bitsPerSample / 8));
-
-                    // Create OpenAL buffer
-                    alGenBuffers(1, &buffer);
-                    alBufferData(buffer, format, data.data(), chunkSize, sampleRateVal);
-
-                    ALenum error = alGetError();
-                    if (error != AL_NO_ERROR)
-                    {
-                        std::cout << "OpenAL error: " << error << std::endl;
-                        std::cout << "Format: " << format << " Channels: " << numChannels << " BitsPerSample: " << bitsPerSample << " SampleRate: " << sampleRateVal << " DataSize: " << chunkSize << std::endl;
-                        alDeleteBuffers(1, &buffer);
-                        buffer = 0;
-                        return false;
-                    }
-
-                    return true;
-                }
-                else
-                {
-                    file.seekg(chunkSize, std::ios::cur);
-                }
-            }
-        }
-        else
-        {
-            file.seekg(chunkSize, std::ios::cur);
-        }
+    // Create OpenAL buffer
+    alGenBuffers(1, &buffer);
+    alBufferData(buffer, format, rawData.data(), static_cast<ALsizei>(rawData.size()), sampleRate);
+
+    ALenum error = alGetError();
+    if (error != AL_NO_ERROR)
+    {
+        std::cout << "OpenAL error: " << error << std::endl;
+        std::cout << "Format: " << format << " Channels: " << channels << " BitsPerSample: " << bitsPerSample << " SampleRate: " << sampleRate << " DataSize: " << rawData.size() << std::endl;
+        alDeleteBuffers(1, &buffer);
+        buffer = 0;
+        return false;
     }
 
-    return false;
-}
\ No newline at end of file
+    return true;
+}
@@ -0,0 +1,161 @@
+#include <Ice/Resources/AudioDecoder.h>
+#include <Ice/Resources/FlacDecoder.h>
+#include <Ice/Utils/VirtualFileSystem.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <iostream>
+
+static std::string GetExtension(const std::string& path)
+{
+    size_t dot = path.find_last_of('.');
+    if (dot == std::string::npos)
+        return "";
+
+    std::string extension = path.substr(dot);
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return extension;
+}
+
+static std::unique_ptr<AudioDecoder> CreateDecoder(const std::string& extension)
+{
+    if (extension == ".wav")
+        return std::make_unique<WavDecoder>();
+    if (extension == ".flac")
+        return std::make_unique<FlacDecoder>();
+    return nullptr;
+}
+
+std::unique_ptr<AudioDecoder> AudioDecoder::Open(const std::string& path)
+{
+    std::unique_ptr<AudioDecoder> decoder = CreateDecoder(GetExtension(path));
+    if (decoder == nullptr)
+    {
+        std::cout << "Unsupported audio format: " << path << std::endl;
+        return nullptr;
+    }
+
+    decoder->stream = VirtualFileSystem::GetInstance().OpenStream(path);
+    if (decoder->stream == nullptr)
+    {
+        std::cout << "Failed to open file " << path << std::endl;
+        return nullptr;
+    }
+
+    if (!decoder->ReadHeader())
+    {
+        std::cout << "Failed to read audio header: " << path << std::endl;
+        return nullptr;
+    }
+
+    return decoder;
+}
+
+bool AudioDecoder::IsSupported(const std::string& path)
+{
+    return CreateDecoder(GetExtension(path)) != nullptr;
+}
+
+
+bool WavDecoder::ReadHeader()
+{
+    std::istream& file = *stream;
+
+    // RIFF header
+    char riff[4];
+    file.read(riff, 4);
+    if (!file || strncmp(riff, "RIFF", 4) != 0)
+    {
+        std::cout << "File does not appear to be a valid WAV file!" << std::endl;
+        return false;
+    }
+
+    file.seekg(4, std::ios::cur);
+
+    // WAVE header
+    char wave[4];
+    file.read(wave, 4);
+    if (!file || strncmp(wave, "WAVE", 4) != 0)
+    {
+        std::cout << "File does not appear to be a valid WAV file!" << std::endl;
+        return false;
+    }
+
+    // Find fmt chunk, then the data chunk after it
+    char chunkId[4];
+    uint32_t chunkSize;
+    bool foundFormat = false;
+
+    while (file.read(chunkId, 4))
+    {
+        file.read(reinterpret_cast<char*>(&chunkSize), 4);
+
+        if (strncmp(chunkId, "fmt ", 4) == 0)
+        {
+            uint16_t audioFormat;
+            uint16_t numChannels;
+            uint32_t sampleRateVal;
+            uint32_t byteRate;
+            uint16_t blockAlign;
+            uint16_t bits;
+
+            file.read(reinterpret_cast<char*>(&audioFormat), 2);
+            file.read(reinterpret_cast<char*>(&numChannels), 2);
+            file.read(reinterpret_cast<char*>(&sampleRateVal), 4);
+            file.read(reinterpret_cast<char*>(&byteRate), 4);
+            file.read(reinterpret_cast<char*>(&blockAlign), 2);
+            file.read(reinterpret_cast<char*>(&bits), 2);
+
+            // Skip any extra format bytes
+            if (chunkSize > 16)
+            {
+                file.seekg(chunkSize - 16, std::ios::cur);
+            }
+
+            channels = numChannels;
+            sampleRate = sampleRateVal;
+            bitsPerSample = bits;
+            foundFormat = true;
+        }
+        else if (foundFormat && strncmp(chunkId, "data", 4) == 0)
+        {
+            if ((bitsPerSample != 8 && bitsPerSample != 16) || (channels != 1 && channels != 2))
+            {
+                std::cout << "Unsupported WAV format, Channels: " << channels << " BitsPerSample: " << bitsPerSample << std::endl;
+                return false;
+            }
+
+            dataOffset = static_cast<uint64_t>(file.tellg());
+            frameCount = chunkSize / GetFrameSize();
+            position = 0;
+            return true;
+        }
+        else
+        {
+            file.seekg(chunkSize, std::ios::cur);
+        }
+    }
+
+    return false;
+}
+
+size_t WavDecoder::Read(void* out, size_t count)
+{
+    size_t frames = static_cast<size_t>(std::min<uint64_t>(count, frameCount - position));
+    if (frames == 0)
+        return 0;
+
+    stream->read(static_cast<char*>(out), frames * GetFrameSize());
+    size_t read = static_cast<size_t>(stream->gcount()) / GetFrameSize();
+    position += read;
+    return read;
+}
+
+bool WavDecoder::Seek(uint64_t frame)
+{
+    position = std::min(frame, frameCount);
+    stream->clear();
+    stream->seekg(static_cast<std::streamoff>(dataOffset + position * GetFrameSize()));
+    return static_cast<bool>(*stream);
+}
@@ -0,0 +1,280 @@
+#include <Ice/Resources/AudioStream.h>
+#include <Ice/Resources/AudioClip.h>
+#include <Ice/Resources/AudioDecoder.h>
+
+#include <algorithm>
+#include <iostream>
+
+AudioStream::AudioStream(AudioClip* clip, ALuint source, bool mono)
+    : clip(clip)
+    , source(source)
+    , mono(mono && clip->GetChannelCount() == 2)
+{
+    // Every stream has its own decoder, several sources can play the same clip from different positions
+    decoder = AudioDecoder::Open(clip->GetPath());
+    if (decoder == nullptr)
+    {
+        std::cout << "AudioStream: Failed to open " << clip->GetPath() << std::endl;
+        return;
+    }
+
+    int bits = decoder->GetBitsPerSample();
+    blockAlign = decoder->GetFrameSize();
+
+    int outChannels = this->mono ? 1 : decoder->GetChannels();
+    if (outChannels == 1)
+        format = bits == 8 ? AL_FORMAT_MONO8 : AL_FORMAT_MONO16;
+    else
+        format = bits == 8 ? AL_FORMAT_STEREO8 : AL_FORMAT_STEREO16;
+
+    alGenBuffers(BUFFER_COUNT, buffers);
+
+    // Whole frames only so a chunk never splits a sample between two buffers
+    readScratch.resize(BUFFER_SIZE - BUFFER_SIZE % blockAlign);
+}
+
+AudioStream::~AudioStream()
+{
+    std::lock_guard lock(mutex);
+    alSourceStop(source);
+    ClearQueue();
+    if (buffers[0] != 0)
+        alDeleteBuffers(BUFFER_COUNT, buffers);
+}
+
+bool AudioStream::Start(bool loop, float startTime)
+{
+    std::lock_guard lock(mutex);
+    if (decoder == nullptr)
+        return false;
+
+    looping = loop;
+
+    // Restarting (from the beginning unless a virtual voice is being picked back up) like alSourcePlay does for a normal clip
+    uint64_t frame = TimeToFrame(startTime);
+    alSourceStop(source);
+    ClearQueue();
+    Rewind(frame);
+    startFrame = frame;
+    playedFrames = 0;
+
+    alSourcei(source, AL_LOOPING, AL_FALSE);
+    for (int i = 0; i < BUFFER_COUNT; i++)
+    {
+        if (!FillBuffer(buffers[i]))
+            break;
+        Queue(buffers[i]);
+    }
+
+    if (queuedFrames.empty())
+        return false;
+
+    playing = true;
+    alSourcePlay(source);
+    return true;
+}
+
+void AudioStream::Stop()
+{
+    std::lock_guard lock(mutex);
+    playing = false;
+    alSourceStop(source);
+    ClearQueue();
+}
+
+void AudioStream::Service()
+{
+    std::lock_guard lock(mutex);
+    if (!playing || decoder == nullptr)
+        return;
+
+    ALint processed = 0;
+    alGetSourcei(source, AL_BUFFERS_PROCESSED, &processed);
+    while (processed-- > 0)
+    {
+        ALuint buffer;
+        alSourceUnqueueBuffers(source, 1, &buffer);
+        if (!queuedFrames.empty())
+        {
+            playedFrames += queuedFrames.front();
+            queuedFrames.pop_front();
+        }
+
+        if (FillBuffer(buffer))
+            Queue(buffer);
+    }
+
+    ALint state;
+    alGetSourcei(source, AL_SOURCE_STATE, &state);
+    if (state == AL_STOPPED)
+    {
+        // Ran dry before it got refilled (hitch), pick up where it left off. A stream that queued its last chunk just ended.
+        if (!queuedFrames.empty())
+            alSourcePlay(source);
+        else
+            playing = false;
+    }
+}
+
+void AudioStream::SetLooping(bool loop)
+{
+    std::lock_guard lock(mutex);
+    looping = loop;
+
+    // Turning looping back on after the end was reached, the rest of the queue is refilled from the start
+    if (loop && finished)
+    {
+        finished = false;
+        Rewind(0);
+    }
+}
+
+void AudioStream::Seek(float seconds)
+{
+    std::lock_guard lock(mutex);
+    if (decoder == nullptr)
+        return;
+
+    uint64_t frame = TimeToFrame(seconds);
+
+    ALint state;
+    alGetSourcei(source, AL_SOURCE_STATE, &state);
+
+    alSourceStop(source);
+    ClearQueue();
+    Rewind(frame);
+    startFrame = frame;
+    playedFrames = 0;
+
+    for (int i = 0; i < BUFFER_COUNT; i++)
+    {
+        if (!FillBuffer(buffers[i]))
+            break;
+        Queue(buffers[i]);
+    }
+
+    // Keeps whatever state it was in, a paused stream stays paused at the new position
+    if (state == AL_PLAYING)
+        alSourcePlay(source);
+    else if (state == AL_PAUSED)
+    {
+        alSourcePlay(source);
+        alSourcePause(source);
+    }
+}
+
+float AudioStream::GetTime() const
+{
+    std::lock_guard lock(mutex);
+    if (decoder == nullptr || clip->GetSampleRate() <= 0)
+        return 0.0f;
+
+    ALint offset = 0;
+    alGetSourcei(source, AL_SAMPLE_OFFSET, &offset);
+
+    uint64_t totalFrames = clip->GetFrameCount();
+    uint64_t frame = startFrame + playedFrames + static_cast<uint64_t>(std::max(offset, 0));
+    if (totalFrames > 0)
+        frame = looping ? frame % totalFrames : std::min(frame, totalFrames);
+
+    return static_cast<float>(frame) / clip->GetSampleRate();
+}
+
+bool AudioStream::IsFinished() const
+{
+    std::lock_guard lock(mutex);
+    return !playing;
+}
+
+
+bool AudioStream::FillBuffer(ALuint buffer)
+{
+    const size_t capacity = readScratch.size() / blockAlign;
+    size_t frames = 0;
+    bool rewound = false;
+
+    while (frames < capacity)
+    {
+        size_t read = decoder->Read(readScratch.data() + frames * blockAlign, capacity - frames);
+        frames += read;
+        if (read > 0)
+        {
+            rewound = false;
+            continue;
+        }
+
+        // End of the data, loops wrap around (unless the file gave nothing even right after rewinding)
+        if (!looping || rewound)
+        {
+            finished = !looping;
+            break;
+        }
+        Rewind(0);
+        rewound = true;
+    }
+
+    if (frames == 0)
+        return false;
+
+    const char* data = readScratch.data();
+    size_t size = frames * blockAlign;
+
+    if (mono)
+    {
+        if (decoder->GetBitsPerSample() == 16)
+        {
+            monoScratch.resize(frames * 2);
+            const int16_t* stereo = reinterpret_cast<const int16_t*>(readScratch.data());
+            int16_t* out = reinterpret_cast<int16_t*>(monoScratch.data());
+            for (size_t i = 0; i < frames; i++)
+                out[i] = static_cast<int16_t>((static_cast<int32_t>(stereo[i * 2]) + static_cast<int32_t>(stereo[i * 2 + 1])) / 2);
+        }
+        else // 8-bit, unsigned
+        {
+            monoScratch.resize(frames);
+            const uint8_t* stereo = reinterpret_cast<const uint8_t*>(readScratch.data());
+            uint8_t* out = reinterpret_cast<uint8_t*>(monoScratch.data());
+            for (size_t i = 0; i < frames; i++)
+                out[i] = static_cast<uint8_t>((static_cast<uint16_t>(stereo[i * 2]) + static_cast<uint16_t>(stereo[i * 2 + 1])) / 2);
+        }
+        data = monoScratch.data();
+        size = monoScratch.size();
+    }
+
+    alBufferData(buffer, format, data, static_cast<ALsizei>(size), static_cast<ALsizei>(clip->GetSampleRate()));
+    return alGetError() == AL_NO_ERROR;
+}
+
+uint64_t AudioStream::TimeToFrame(float seconds) const
+{
+    uint64_t totalFrames = clip->GetFrameCount();
+    uint64_t frame = static_cast<uint64_t>(std::max(0.0f, seconds) * clip->GetSampleRate());
+    return totalFrames > 0 ? std::min(frame, totalFrames - 1) : frame;
+}
+
+void AudioStream::Rewind(uint64_t frame)
+{
+    finished = false;
+    decoder->Seek(frame);
+}
+
+void AudioStream::Queue(ALuint buffer)
+{
+    ALint size = 0;
+    ALint bits = 0;
+    ALint channels = 0;
+    alGetBufferi(buffer, AL_SIZE, &size);
+    alGetBufferi(buffer, AL_BITS, &bits);
+    alGetBufferi(buffer, AL_CHANNELS, &channels);
+
+    alSourceQueueBuffers(source, 1, &buffer);
+    int frameBytes = std::max(1, channels * (bits / 8));
+    queuedFrames.push_back(static_cast<uint32_t>(size / frameBytes));
+}
+
+void AudioStream::ClearQueue()
+{
+    // Detaching the buffer clears the whole queue (the source has to be stopped)
+    alSourcei(source, AL_BUFFER, 0);
+    queuedFrames.clear();
+}
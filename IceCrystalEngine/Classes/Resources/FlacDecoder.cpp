@@ -0,0 +1,587 @@
+#include <Ice/Resources/FlacDecoder.h>
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <iostream>
+
+static constexpr size_t READ_CHUNK_SIZE = 64 * 1024;
+// Seek bisects the file until the range holding the target is this small, then decodes forward (a few frames)
+static constexpr uint64_t SEEK_LINEAR_BYTES = 32 * 1024;
+
+static uint8_t UpdateCRC8(uint8_t crc, uint8_t byte)
+{
+    crc ^= byte;
+    for (int i = 0; i < 8; i++)
+        crc = static_cast<uint8_t>(crc & 0x80 ? (crc << 1) ^ 0x07 : crc << 1);
+    return crc;
+}
+
+
+void FlacDecoder::BitReader::Reset(std::istream* stream, uint64_t offset)
+{
+    this->stream = stream;
+    this->offset = offset;
+    buffer.resize(READ_CHUNK_SIZE);
+    bufferPos = 0;
+    bufferSize = 0;
+    cache = 0;
+    bitCount = 0;
+    eof = false;
+
+    stream->clear();
+    stream->seekg(static_cast<std::streamoff>(offset));
+}
+
+uint8_t FlacDecoder::BitReader::NextByte()
+{
+    if (bufferPos == bufferSize)
+    {
+        stream->read(reinterpret_cast<char*>(buffer.data()), buffer.size());
+        bufferSize = static_cast<size_t>(stream->gcount());
+        bufferPos = 0;
+        if (bufferSize == 0)
+        {
+            eof = true;
+            return 0;
+        }
+    }
+    offset++;
+    return buffer[bufferPos++];
+}
+
+uint32_t FlacDecoder::BitReader::ReadBits(int count)
+{
+    if (count == 0)
+        return 0;
+
+    while (bitCount < count)
+    {
+        cache = (cache << 8) | NextByte();
+        bitCount += 8;
+    }
+    bitCount -= count;
+    return static_cast<uint32_t>((cache >> bitCount) & ((1ull << count) - 1));
+}
+
+int32_t FlacDecoder::BitReader::ReadSigned(int count)
+{
+    if (count == 0)
+        return 0;
+
+    int shift = 32 - count;
+    return static_cast<int32_t>(ReadBits(count) << shift) >> shift;
+}
+
+uint32_t FlacDecoder::BitReader::ReadUnary()
+{
+    // Whole bytes of zeros at a time, this is the hot loop of the residual decode
+    uint32_t count = 0;
+    for (;;)
+    {
+        if (bitCount == 0)
+        {
+            cache = NextByte();
+            bitCount = 8;
+            if (eof)
+                return count;
+        }
+
+        uint64_t bits = cache & ((1ull << bitCount) - 1);
+        if (bits == 0)
+        {
+            count += bitCount;
+            bitCount = 0;
+            continue;
+        }
+
+        int highest = static_cast<int>(std::bit_width(bits)) - 1;
+        count += bitCount - 1 - highest;
+        bitCount = highest;
+        return count;
+    }
+}
+
+void FlacDecoder::BitReader::SkipBytes(uint64_t count)
+{
+    AlignToByte();
+    while (bitCount > 0 && count > 0)
+    {
+        bitCount -= 8;
+        count--;
+    }
+
+    if (count <= bufferSize - bufferPos)
+    {
+        bufferPos += static_cast<size_t>(count);
+        offset += count;
+        return;
+    }
+
+    // Past what is buffered (big pictures / padding blocks), seek over it instead of reading it
+    offset += count;
+    bufferPos = 0;
+    bufferSize = 0;
+    stream->clear();
+    stream->seekg(static_cast<std::streamoff>(offset));
+}
+
+
+bool FlacDecoder::ReadHeader()
+{
+    reader.Reset(stream.get(), 0);
+
+    uint32_t marker = reader.ReadBits(32);
+
+    // Some taggers put an ID3v2 tag in front of the fLaC marker
+    if ((marker >> 8) == 0x494433) // "ID3"
+    {
+        reader.ReadBits(16); // minor version, flags
+        uint32_t size = 0;
+        for (int i = 0; i < 4; i++)
+            size = (size << 7) | (reader.ReadBits(8) & 0x7F);
+        reader.SkipBytes(size);
+        marker = reader.ReadBits(32);
+    }
+
+    if (marker != 0x664C6143) // "fLaC"
+    {
+        std::cout << "File does not appear to be a valid FLAC file!" << std::endl;
+        return false;
+    }
+
+    // Metadata blocks, only STREAMINFO and SEEKTABLE matter
+    seekPoints.clear();
+    bool foundInfo = false;
+    bool last = false;
+    while (!last)
+    {
+        last = reader.ReadBits(1) != 0;
+        uint32_t type = reader.ReadBits(7);
+        uint32_t length = reader.ReadBits(24);
+        if (reader.IsEOF())
+            return false;
+
+        if (type == 0 && length >= 34)
+        {
+            int minBlockSize = static_cast<int>(reader.ReadBits(16));
+            int maxBlockSize = static_cast<int>(reader.ReadBits(16));
+            streamBlockSize = minBlockSize == maxBlockSize ? maxBlockSize : 0;
+            reader.ReadBits(24); // min frame size
+            reader.ReadBits(24); // max frame size
+            sampleRate = static_cast<int>(reader.ReadBits(20));
+            channels = static_cast<int>(reader.ReadBits(3)) + 1;
+            streamBitsPerSample = static_cast<int>(reader.ReadBits(5)) + 1;
+            frameCount = (static_cast<uint64_t>(reader.ReadBits(4)) << 32) | reader.ReadBits(32); // 0 if the encoder didnt know
+            reader.SkipBytes(16 + (length - 34)); // MD5
+            foundInfo = true;
+        }
+        else if (type == 3)
+        {
+            for (uint32_t i = 0; i + 18 <= length; i += 18)
+            {
+                uint64_t frame = (static_cast<uint64_t>(reader.ReadBits(32)) << 32) | reader.ReadBits(32);
+                uint64_t offset = (static_cast<uint64_t>(reader.ReadBits(32)) << 32) | reader.ReadBits(32);
+                reader.ReadBits(16); // frames in the target frame
+                // Placeholder points are all 1s, they sort last
+                if (frame != ~0ull)
+                    seekPoints.push_back({ frame, offset });
+            }
+            reader.SkipBytes(length % 18);
+        }
+        else
+        {
+            reader.SkipBytes(length);
+        }
+    }
+
+    if (!foundInfo || sampleRate == 0)
+        return false;
+
+    if (channels > 2 || streamBitsPerSample < 4 || streamBitsPerSample > 24)
+    {
+        std::cout << "Unsupported FLAC format, Channels: " << channels << " BitsPerSample: " << streamBitsPerSample << std::endl;
+        return false;
+    }
+
+    bitsPerSample = 16;
+    firstFrameOffset = reader.Tell();
+
+    stream->clear();
+    stream->seekg(0, std::ios::end);
+    streamSize = static_cast<uint64_t>(std::max<std::streamoff>(0, stream->tellg()));
+    reader.Reset(stream.get(), firstFrameOffset);
+    blockFrames = 0;
+    blockPosition = 0;
+    return true;
+}
+
+size_t FlacDecoder::Read(void* out, size_t count)
+{
+    int16_t* dest = static_cast<int16_t*>(out);
+    size_t done = 0;
+
+    while (done < count)
+    {
+        if (blockPosition >= blockFrames && !DecodeFrame())
+            break;
+
+        size_t frames = std::min(count - done, blockFrames - blockPosition);
+        std::memcpy(dest + done * channels, block.data() + blockPosition * channels, frames * channels * sizeof(int16_t));
+        done += frames;
+        blockPosition += frames;
+    }
+
+    return done;
+}
+
+bool FlacDecoder::Seek(uint64_t frame)
+{
+    blockFrames = 0;
+    blockPosition = 0;
+
+    // Voices seek every time they become real again, so this must not decode from the start of a long track.
+    // The seek table narrows it down to the range between two points, bisecting on the frame numbers in the
+    // frame headers does the rest, then only the last few frames are actually decoded.
+    uint64_t low = firstFrameOffset;
+    uint64_t high = streamSize;
+    for (const SeekPoint& point : seekPoints)
+    {
+        if (point.frame <= frame)
+            low = std::max(low, firstFrameOffset + point.offset);
+        else
+        {
+            high = std::min(high, firstFrameOffset + point.offset);
+            break;
+        }
+    }
+
+    FrameHeader header;
+    while (frame > 0 && high > low && high - low > SEEK_LINEAR_BYTES)
+    {
+        uint64_t middle = low + (high - low) / 2;
+        reader.Reset(stream.get(), middle);
+        if (ReadFrameHeader(header) && header.firstFrame <= frame && header.offset < high)
+            low = header.offset;
+        else
+            high = middle;
+    }
+
+    reader.Reset(stream.get(), low);
+    while (DecodeFrame())
+    {
+        if (blockFirstFrame + blockFrames > frame)
+        {
+            // Landed past it, the seek table or frame numbers dont match the stream
+            if (blockFirstFrame > frame)
+                return false;
+
+            blockPosition = static_cast<size_t>(frame - blockFirstFrame);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool FlacDecoder::ReadFrameHeader(FrameHeader& header)
+{
+    // Frames start with a 14 bit sync code on a byte boundary, scanning for it also steps over any junk between frames.
+    // The sync code can turn up inside frame data too (after a seek), so a header only counts if its CRC-8 matches.
+    reader.AlignToByte();
+    uint32_t previous = reader.ReadBits(8);
+    for (;;)
+    {
+        if (reader.IsEOF())
+            return false;
+
+        uint32_t current = reader.ReadBits(8);
+        if (previous != 0xFF || (current & 0xFE) != 0xF8)
+        {
+            previous = current;
+            continue;
+        }
+        previous = current;
+
+        header.offset = reader.Tell() - 2;
+        uint8_t crc = UpdateCRC8(UpdateCRC8(0, 0xFF), static_cast<uint8_t>(current));
+        auto readByte = [&]() {
+            uint32_t byte = reader.ReadBits(8);
+            crc = UpdateCRC8(crc, static_cast<uint8_t>(byte));
+            return byte;
+        };
+        bool variableBlockSize = (current & 1) != 0;
+
+        uint32_t byte = readByte();
+        int blockSizeCode = static_cast<int>(byte >> 4);
+        int sampleRateCode = static_cast<int>(byte & 0xF);
+        byte = readByte();
+        header.channelAssignment = static_cast<int>(byte >> 4);
+        int sampleSizeCode = static_cast<int>((byte >> 1) & 0x7);
+        if (blockSizeCode == 0 || sampleRateCode == 15 || (byte & 1) != 0)
+            continue;
+
+        // Frame number (fixed blocksize) or first sample (variable), UTF-8 style variable length
+        uint32_t first = readByte();
+        int extraBytes = first < 0x80 ? 0 : std::countl_one(static_cast<uint8_t>(first)) - 1;
+        if (extraBytes < 0 || extraBytes > 6 || (first & 0xC0) == 0x80)
+            continue;
+        uint64_t number = first & (0x7F >> (extraBytes == 0 ? 0 : extraBytes + 1));
+        bool valid = true;
+        for (int i = 0; i < extraBytes; i++)
+        {
+            uint32_t next = readByte();
+            valid = valid && (next & 0xC0) == 0x80;
+            number = (number << 6) | (next & 0x3F);
+        }
+        if (!valid)
+            continue;
+
+        if (blockSizeCode == 1)
+            header.blockSize = 192;
+        else if (blockSizeCode >= 2 && blockSizeCode <= 5)
+            header.blockSize = 576 << (blockSizeCode - 2);
+        else if (blockSizeCode == 6)
+            header.blockSize = static_cast<int>(readByte()) + 1;
+        else if (blockSizeCode == 7)
+        {
+            uint32_t high = readByte();
+            header.blockSize = static_cast<int>((high << 8) | readByte()) + 1;
+        }
+        else
+            header.blockSize = 256 << (blockSizeCode - 8);
+
+        // The stream's sample rate is used, this is only there for streams without a STREAMINFO
+        if (sampleRateCode == 12)
+            readByte();
+        else if (sampleRateCode == 13 || sampleRateCode == 14)
+        {
+            readByte();
+            readByte();
+        }
+
+        uint32_t expectedCRC = reader.ReadBits(8);
+        if (reader.IsEOF())
+            return false;
+        if (expectedCRC != crc)
+            continue;
+
+        static const int sampleSizes[8] = { 0, 8, 12, 0, 16, 20, 24, 0 };
+        header.bits = sampleSizeCode == 0 ? streamBitsPerSample : sampleSizes[sampleSizeCode];
+        // Every block of a fixed blocksize stream but the last is the same size, so this only falls back to the frame's own
+        // size if STREAMINFO didnt have it (and then only the last frame, which nothing seeks past, is off)
+        header.firstFrame = variableBlockSize ? number : number * static_cast<uint64_t>(streamBlockSize > 0 ? streamBlockSize : header.blockSize);
+        return true;
+    }
+}
+
+
+bool FlacDecoder::DecodeFrame()
+{
+    blockFrames = 0;
+    blockPosition = 0;
+
+    FrameHeader header;
+    if (!ReadFrameHeader(header))
+        return false;
+
+    int blockSize = header.blockSize;
+    int channelAssignment = header.channelAssignment;
+    int bits = header.bits;
+    blockFirstFrame = header.firstFrame;
+
+    int frameChannels = channelAssignment < 8 ? channelAssignment + 1 : 2;
+    if (channelAssignment > 10 || frameChannels != channels)
+        return false;
+
+    if (bits == 0)
+        return false;
+
+    for (int ch = 0; ch < channels; ch++)
+    {
+        // The side channel of a stereo pair needs one more bit
+        bool side = (ch == 1 && (channelAssignment == 8 || channelAssignment == 10)) || (ch == 0 && channelAssignment == 9);
+        channelSamples[ch].resize(blockSize);
+        if (!DecodeSubframe(channelSamples[ch].data(), blockSize, bits + (side ? 1 : 0)))
+            return false;
+    }
+
+    reader.AlignToByte();
+    reader.ReadBits(16); // CRC-16, not checked
+    if (reader.IsEOF())
+        return false;
+
+    int32_t* left = channelSamples[0].data();
+    int32_t* right = channelSamples[channels - 1].data();
+    switch (channelAssignment)
+    {
+    case 8: // left / side
+        for (int i = 0; i < blockSize; i++)
+            right[i] = left[i] - right[i];
+        break;
+    case 9: // side / right
+        for (int i = 0; i < blockSize; i++)
+            left[i] += right[i];
+        break;
+    case 10: // mid / side
+        for (int i = 0; i < blockSize; i++)
+        {
+            int32_t side = right[i];
+            int32_t mid = left[i] * 2 | (side & 1);
+            left[i] = (mid + side) >> 1;
+            right[i] = (mid - side) >> 1;
+        }
+        break;
+    }
+
+    // Down (or up) to 16 bit interleaved
+    int shift = bits - 16;
+    block.resize(static_cast<size_t>(blockSize) * channels);
+    for (int ch = 0; ch < channels; ch++)
+    {
+        const int32_t* samples = channelSamples[ch].data();
+        for (int i = 0; i < blockSize; i++)
+            block[i * channels + ch] = static_cast<int16_t>(shift >= 0 ? samples[i] >> shift : samples[i] << -shift);
+    }
+
+    blockFrames = blockSize;
+    return true;
+}
+
+bool FlacDecoder::DecodeSubframe(int32_t* out, int blockSize, int bits)
+{
+    if (reader.ReadBits(1) != 0)
+        return false;
+
+    uint32_t type = reader.ReadBits(6);
+
+    int wasted = 0;
+    if (reader.ReadBits(1) != 0)
+    {
+        wasted = static_cast<int>(reader.ReadUnary()) + 1;
+        bits -= wasted;
+        if (bits <= 0)
+            return false;
+    }
+
+    if (type == 0) // constant
+    {
+        std::fill(out, out + blockSize, reader.ReadSigned(bits));
+    }
+    else if (type == 1) // verbatim
+    {
+        for (int i = 0; i < blockSize; i++)
+            out[i] = reader.ReadSigned(bits);
+    }
+    else if (type >= 8 && type <= 12) // fixed predictor
+    {
+        int order = static_cast<int>(type) - 8;
+        if (order > blockSize)
+            return false;
+
+        for (int i = 0; i < order; i++)
+            out[i] = reader.ReadSigned(bits);
+        if (!DecodeResidual(out, blockSize, order))
+            return false;
+
+        switch (order)
+        {
+        case 1:
+            for (int i = 1; i < blockSize; i++)
+                out[i] += out[i - 1];
+            break;
+        case 2:
+            for (int i = 2; i < blockSize; i++)
+                out[i] += 2 * out[i - 1] - out[i - 2];
+            break;
+        case 3:
+            for (int i = 3; i < blockSize; i++)
+                out[i] += 3 * out[i - 1] - 3 * out[i - 2] + out[i - 3];
+            break;
+        case 4:
+            for (int i = 4; i < blockSize; i++)
+                out[i] += 4 * out[i - 1] - 6 * out[i - 2] + 4 * out[i - 3] - out[i - 4];
+            break;
+        }
+    }
+    else if (type >= 32) // LPC
+    {
+        int order = static_cast<int>(type & 31) + 1;
+        if (order > blockSize)
+            return false;
+
+        for (int i = 0; i < order; i++)
+            out[i] = reader.ReadSigned(bits);
+
+        int precision = static_cast<int>(reader.ReadBits(4)) + 1;
+        int shift = reader.ReadSigned(5);
+        if (precision == 16 || shift < 0)
+            return false;
+
+        int32_t coefficients[32];
+        for (int i = 0; i < order; i++)
+            coefficients[i] = reader.ReadSigned(precision);
+
+        if (!DecodeResidual(out, blockSize, order))
+            return false;
+
+        for (int i = order; i < blockSize; i++)
+        {
+            int64_t sum = 0;
+            for (int j = 0; j < order; j++)
+                sum += static_cast<int64_t>(coefficients[j]) * out[i - 1 - j];
+            out[i] += static_cast<int32_t>(sum >> shift);
+        }
+    }
+    else
+    {
+        return false;
+    }
+
+    if (wasted > 0)
+    {
+        for (int i = 0; i < blockSize; i++)
+            out[i] <<= wasted;
+    }
+    return true;
+}
+
+bool FlacDecoder::DecodeResidual(int32_t* out, int blockSize, int order)
+{
+    uint32_t method = reader.ReadBits(2);
+    if (method > 1)
+        return false;
+
+    // Rice coding, method 1 just has wider parameters
+    int parameterBits = method == 0 ? 4 : 5;
+    uint32_t escape = method == 0 ? 15 : 31;
+
+    int partitionOrder = static_cast<int>(reader.ReadBits(4));
+    int partitionSize = blockSize >> partitionOrder;
+    if ((partitionSize << partitionOrder) != blockSize || partitionSize < order)
+        return false;
+
+    int32_t* sample = out + order;
+    for (int partition = 0; partition < (1 << partitionOrder); partition++)
+    {
+        int count = partition == 0 ? partitionSize - order : partitionSize;
+        uint32_t parameter = reader.ReadBits(parameterBits);
+
+        if (parameter == escape)
+        {
+            // Unencoded partition, the samples are stored as is
+            int rawBits = static_cast<int>(reader.ReadBits(5));
+            for (int i = 0; i < count; i++)
+                *sample++ = reader.ReadSigned(rawBits);
+        }
+        else
+        {
+            for (int i = 0; i < count; i++)
+            {
+                uint32_t value = (reader.ReadUnary() << parameter) | reader.ReadBits(static_cast<int>(parameter));
+                *sample++ = static_cast<int32_t>(value >> 1) ^ -static_cast<int32_t>(value & 1);
+            }
+        }
+    }
+
+    return !reader.IsEOF();
+}
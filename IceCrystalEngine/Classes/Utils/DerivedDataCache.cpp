@@ -0,0 +1,278 @@
+#include <Ice/Utils/DerivedDataCache.h>
+#include <Ice/Utils/FileUtil.h>
+#include <Ice/Utils/HashUtil.h>
+#include <Ice/Utils/LZ4.h>
+
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <cstring>
+
+namespace fs = std::filesystem;
+
+// Written in front of every entry
+struct DerivedDataHeader
+{
+    char magic[4]; // "ICDD"
+    uint32_t version;
+    uint32_t compression; // 0 = none, 1 = LZ4
+    uint32_t padding;
+    uint64_t size; // uncompressed size
+    uint64_t storedSize;
+    uint64_t payloadHash; // hash of the uncompressed data, catches truncated / corrupt entries
+};
+
+static constexpr uint32_t DERIVED_DATA_VERSION = 1;
+static constexpr uint64_t SECOND_SEED = 0x9E3779B97F4A7C15ull;
+
+
+// DerivedDataKey
+DerivedDataKey::DerivedDataKey(const std::string& cooker, uint32_t cookerVersion)
+    : cooker(cooker), hashA(HashUtil::offsetBasis), hashB(HashUtil::offsetBasis ^ SECOND_SEED)
+{
+    Add(std::string_view(cooker));
+    Add(static_cast<uint64_t>(cookerVersion));
+}
+
+DerivedDataKey& DerivedDataKey::Add(const void* data, size_t size)
+{
+    // Mix the size in so consecutive Adds cant shift bytes between each other
+    uint64_t size64 = size;
+    hashA = HashUtil::Hash(data, size, HashUtil::Hash(&size64, sizeof(size64), hashA));
+    hashB = HashUtil::Hash(data, size, HashUtil::Hash(&size64, sizeof(size64), hashB * SECOND_SEED));
+    return *this;
+}
+
+DerivedDataKey& DerivedDataKey::Add(std::string_view str)
+{
+    return Add(str.data(), str.size());
+}
+
+DerivedDataKey& DerivedDataKey::Add(uint64_t value)
+{
+    return Add(&value, sizeof(value));
+}
+
+std::string DerivedDataKey::ToString() const
+{
+    return cooker + "/" + HashUtil::ToHex(hashA) + HashUtil::ToHex(hashB);
+}
+
+
+// DerivedDataCache
+std::string DerivedDataCache::GetEntryPath(const DerivedDataKey& key)
+{
+    return FileUtil::SubstituteVariables(cacheDir) + key.ToString() + ".ddc";
+}
+
+bool DerivedDataCache::Get(const DerivedDataKey& key, std::vector<uint8_t>& outData)
+{
+    if (!enabled)
+        return false;
+
+    std::string path = GetEntryPath(key);
+
+    auto miss = [this]()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        misses++;
+        return false;
+    };
+
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open())
+        return miss();
+
+    DerivedDataHeader header;
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) || std::memcmp(header.magic, "ICDD", 4) != 0 ||
+        header.version != DERIVED_DATA_VERSION)
+    {
+        return miss();
+    }
+
+    // The sizes come straight from the file, check them before allocating anything, a truncated or garbage entry is just a miss
+    std::error_code sizeError;
+    uint64_t fileSize = fs::file_size(path, sizeError);
+    if (sizeError || fileSize < sizeof(header) || header.storedSize != fileSize - sizeof(header))
+        return miss();
+    // LZ4 can't turn one byte into more than 255
+    bool sizeValid = header.compression == 1 ? header.size <= header.storedSize * 255 : header.compression == 0 && header.size == header.storedSize;
+    if (!sizeValid)
+        return miss();
+
+    std::vector<uint8_t> stored(static_cast<size_t>(header.storedSize));
+    if (!file.read(reinterpret_cast<char*>(stored.data()), static_cast<std::streamsize>(stored.size())))
+        return miss();
+    file.close();
+
+    if (header.compression == 1)
+    {
+        outData.resize(static_cast<size_t>(header.size));
+        if (!LZ4::Decompress(stored.data(), stored.size(), outData.data(), outData.size()))
+            return miss();
+    }
+    else
+    {
+        outData = std::move(stored);
+    }
+
+    if (outData.size() != header.size || HashUtil::Hash(outData.data(), outData.size()) != header.payloadHash)
+    {
+        std::cerr << "Corrupt derived data entry " << path << ", recooking" << std::endl;
+        outData.clear();
+        return miss();
+    }
+
+    // Mark as recently used for the LRU (this can fail on a read only cache, that is fine)
+    std::error_code ec;
+    fs::last_write_time(path, fs::file_time_type::clock::now(), ec);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    hits++;
+    return true;
+}
+
+bool DerivedDataCache::Put(const DerivedDataKey& key, const void* data, size_t size)
+{
+    if (!enabled)
+        return false;
+
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+
+    DerivedDataHeader header = {};
+    std::memcpy(header.magic, "ICDD", 4);
+    header.version = DERIVED_DATA_VERSION;
+    header.size = size;
+    header.payloadHash = HashUtil::Hash(bytes, size);
+
+    // Only keep the compressed version if it saves at least ~10%
+    std::vector<uint8_t> compressed = LZ4::Compress(bytes, size);
+    const uint8_t* stored = bytes;
+    header.storedSize = size;
+    if (compressed.size() < size - size / 10)
+    {
+        stored = compressed.data();
+        header.storedSize = compressed.size();
+        header.compression = 1;
+    }
+
+    std::string path = GetEntryPath(key);
+    std::error_code ec;
+    fs::create_directories(fs::path(path).parent_path(), ec);
+
+    // Write to a unique temp file and rename it into place, so nobody ever reads a half written entry
+    static std::atomic<uint32_t> tempCounter = 0;
+    std::string tempPath = path + "." + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + "." +
+                           std::to_string(tempCounter++) + ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open())
+            return false;
+
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(stored), static_cast<std::streamsize>(header.storedSize));
+        if (!file)
+        {
+            file.close();
+            fs::remove(tempPath, ec);
+            return false;
+        }
+    }
+
+    fs::rename(tempPath, path, ec);
+    if (ec)
+    {
+        // Someone else probably wrote the same entry at the same time, theirs is just as good
+        fs::remove(tempPath, ec);
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    currentSize += sizeof(header) + header.storedSize;
+    if (!sizeKnown || currentSize > maxSizeBytes)
+        CollectGarbageLocked();
+    return true;
+}
+
+void DerivedDataCache::CollectGarbage()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    CollectGarbageLocked();
+}
+
+void DerivedDataCache::CollectGarbageLocked()
+{
+    struct CacheEntry
+    {
+        fs::path path;
+        fs::file_time_type lastUsed;
+        uint64_t size;
+    };
+
+    std::string root = FileUtil::SubstituteVariables(cacheDir);
+    std::error_code ec;
+    if (!fs::is_directory(root, ec))
+    {
+        currentSize = 0;
+        sizeKnown = true;
+        return;
+    }
+
+    std::vector<CacheEntry> entries;
+    uint64_t totalSize = 0;
+    auto staleTempTime = fs::file_time_type::clock::now() - std::chrono::hours(1);
+
+    for (auto it = fs::recursive_directory_iterator(root, ec); !ec && it != fs::recursive_directory_iterator(); it.increment(ec))
+    {
+        if (!it->is_regular_file(ec))
+            continue;
+
+        fs::file_time_type lastUsed = it->last_write_time(ec);
+        uint64_t size = it->file_size(ec);
+        if (ec)
+        {
+            ec.clear();
+            continue;
+        }
+
+        // Leftovers from a crash mid write
+        if (it->path().extension() == ".tmp")
+        {
+            if (lastUsed < staleTempTime)
+                fs::remove(it->path(), ec);
+            continue;
+        }
+
+        entries.push_back({ it->path(), lastUsed, size });
+        totalSize += size;
+    }
+
+    if (totalSize > maxSizeBytes)
+    {
+        // Oldest first, trim down to 90% so this doesnt run again on the next Put
+        std::sort(entries.begin(), entries.end(), [](const CacheEntry& a, const CacheEntry& b) { return a.lastUsed < b.lastUsed; });
+
+        uint64_t target = maxSizeBytes - maxSizeBytes / 10;
+        size_t removed = 0;
+        for (const CacheEntry& entry : entries)
+        {
+            if (totalSize <= target)
+                break;
+
+            if (fs::remove(entry.path, ec))
+            {
+                totalSize -= entry.size;
+                removed++;
+            }
+        }
+
+        std::cout << "Derived data cache: removed " << removed << " old entries (" << totalSize / (1024 * 1024) << " MB left)" << std::endl;
+    }
+
+    currentSize = totalSize;
+    sizeKnown = true;
+}
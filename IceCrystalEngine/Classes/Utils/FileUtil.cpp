@@ -1,9 +1,17 @@
 #include <Ice/Utils/FileUtil.h>
+#include <Ice/Utils/VirtualFileSystem.h>
 #include <fstream>
 #include <iostream>
 #include <filesystem>
+#include <algorithm>
+#include <cctype>
 
+#ifdef _WIN32
 #include <Windows.h>
+#else
+#include <unistd.h>
+#include <climits>
+#endif
 
 // Initialize static members here.
 std::string FileUtil::ProjectRoot = "";
@@ -31,9 +39,15 @@ std::string FileUtil::GetProjectRoot()
     return projectRoot;
 }
 std::string FileUtil::GetExecutableDir() {
+#ifdef _WIN32
 	char path[MAX_PATH];
 	GetModuleFileNameA(NULL, path, MAX_PATH);
 	std::string exePath(path);
+#else
+	char path[PATH_MAX];
+	ssize_t length = readlink("/proc/self/exe", path, sizeof(path) - 1);
+	std::string exePath = length > 0 ? std::string(path, length) : std::filesystem::current_path().string() + "/";
+#endif
     
 	// Find last slash
 	size_t pos = exePath.find_last_of("\\/");
@@ -60,28 +74,20 @@ std::string FileUtil::GetEngineAssetDir() {
 std::string FileUtil::ReadFile(const std::string& filename) 
 {
 	std::string updatedFilename = SubstituteVariables(filename);
-	
-    std::ifstream file(updatedFilename);
-    if (!file.is_open()) {
-        std::cerr << "Failed to open " << updatedFilename << std::endl;
-        return ""; // Return an empty string to indicate failure
-    }
-
-    // Read the file contents into a string
-    std::string fileContents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
-
-    // Close the file
-    file.close();
 
-	fileContents = SubstituteVariables(fileContents);
+	// Goes through the VFS so this also works for files packed into a .pak
+	FileData data = VirtualFileSystem::GetInstance().Read(updatedFilename);
+	if (!data) {
+		std::cerr << "Failed to open " << updatedFilename << std::endl;
+		return ""; // Return an empty string to indicate failure
+	}
 
-    return fileContents;
+	return SubstituteVariables(std::string(data.View()));
 }
 
 bool FileUtil::FileExists(const std::string& filename)
 {
-	std::string updatedFilename = SubstituteVariables(filename);
-	return std::filesystem::exists(updatedFilename);
+	return VirtualFileSystem::GetInstance().Exists(filename);
 }
 
 
@@ -92,31 +98,48 @@ std::string FileUtil::SubstituteVariables(const std::string& str)
 		InitializeStaticMembers();
 	}
 
-	std::string updatedStr = str;
-
-	// PROJECT_ROOT
-	size_t found = updatedStr.find("{PROJECT_ROOT}");
-	while (found != std::string::npos)
-	{
-		updatedStr.replace(found, 14, ProjectRoot);
-		found = updatedStr.find("{PROJECT_ROOT}");
-	}
-
-	// ASSET_DIR
-	found = updatedStr.find("{ASSET_DIR}");
-	while (found != std::string::npos)
-	{
-		updatedStr.replace(found, 11, AssetDir);
-		found = updatedStr.find("{ASSET_DIR}");
-	}
-
-	// ENGINE_ASSET_DIR
-	found = updatedStr.find("{ENGINE_ASSET_DIR}");
+	// Nothing to substitute (the common case)
+	size_t found = str.find('{');
+	if (found == std::string::npos)
+		return str;
+
+	static const std::pair<std::string_view, const std::string*> variables[] = {
+		{ "{PROJECT_ROOT}", &ProjectRoot },
+		{ "{ASSET_DIR}", &AssetDir },
+		{ "{ENGINE_ASSET_DIR}", &EngineAssetDir },
+	};
+
+	// Single pass, copy everything up to each variable then the variable's value
+	std::string updatedStr;
+	updatedStr.reserve(str.size() + 64);
+	size_t last = 0;
 	while (found != std::string::npos)
 	{
-		updatedStr.replace(found, 18, EngineAssetDir);
-		found = updatedStr.find("{ENGINE_ASSET_DIR}");
+		bool replaced = false;
+		for (const auto& [name, value] : variables)
+		{
+			if (str.compare(found, name.size(), name) == 0)
+			{
+				updatedStr.append(str, last, found - last);
+				updatedStr += *value;
+				last = found + name.size();
+				replaced = true;
+				break;
+			}
+		}
+		found = str.find('{', replaced ? last : found + 1);
 	}
+	updatedStr.append(str, last, std::string::npos);
 
 	return updatedStr;
-}
\ No newline at end of file
+}
+
+std::string FileUtil::NormalizePath(const std::string& path)
+{
+	std::string normalized = std::filesystem::path(SubstituteVariables(path)).lexically_normal().generic_string();
+#ifdef _WIN32
+	// Windows paths are case insensitive
+	std::transform(normalized.begin(), normalized.end(), normalized.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+#endif
+	return normalized;
+}
@@ -0,0 +1,169 @@
+#include <Ice/Utils/LZ4.h>
+
+#include <cstring>
+
+// Block format rules
+static constexpr size_t MIN_MATCH = 4;
+static constexpr size_t LAST_LITERALS = 5; // the last 5 bytes are always literals
+static constexpr size_t MATCH_START_LIMIT = 12; // the last match has to start at least 12 bytes before the end
+static constexpr size_t MAX_OFFSET = 65535;
+
+static constexpr int HASH_BITS = 12;
+
+static uint32_t Read32(const uint8_t* ptr)
+{
+    uint32_t value;
+    std::memcpy(&value, ptr, sizeof(value));
+    return value;
+}
+
+static uint32_t HashSequence(uint32_t sequence)
+{
+    return (sequence * 2654435761u) >> (32 - HASH_BITS);
+}
+
+// Lengths of 15 or more spill into extra bytes
+static void WriteLength(std::vector<uint8_t>& out, size_t length)
+{
+    length -= 15;
+    while (length >= 255)
+    {
+        out.push_back(255);
+        length -= 255;
+    }
+    out.push_back(static_cast<uint8_t>(length));
+}
+
+static void WriteSequence(std::vector<uint8_t>& out, const uint8_t* literals, size_t literalLength, size_t offset, size_t matchLength)
+{
+    size_t tokenMatch = matchLength >= MIN_MATCH ? matchLength - MIN_MATCH : 0;
+
+    uint8_t token = static_cast<uint8_t>((literalLength >= 15 ? 15 : literalLength) << 4);
+    if (offset != 0)
+        token |= static_cast<uint8_t>(tokenMatch >= 15 ? 15 : tokenMatch);
+    out.push_back(token);
+
+    if (literalLength >= 15)
+        WriteLength(out, literalLength);
+    out.insert(out.end(), literals, literals + literalLength);
+
+    // The last sequence is literals only
+    if (offset == 0)
+        return;
+
+    out.push_back(static_cast<uint8_t>(offset & 0xFF));
+    out.push_back(static_cast<uint8_t>(offset >> 8));
+    if (tokenMatch >= 15)
+        WriteLength(out, tokenMatch);
+}
+
+
+std::vector<uint8_t> LZ4::Compress(const uint8_t* source, size_t sourceSize)
+{
+    std::vector<uint8_t> out;
+    out.reserve(sourceSize / 2 + 16);
+
+    size_t anchor = 0;
+
+    if (sourceSize >= MATCH_START_LIMIT + 1)
+    {
+        // position + 1 of the last time each hashed 4 byte sequence was seen (0 = never)
+        std::vector<uint32_t> table(size_t(1) << HASH_BITS, 0);
+
+        size_t matchLimit = sourceSize - LAST_LITERALS;
+        size_t startLimit = sourceSize - MATCH_START_LIMIT;
+        size_t position = 0;
+
+        while (position <= startLimit)
+        {
+            uint32_t sequence = Read32(source + position);
+            uint32_t hash = HashSequence(sequence);
+            size_t candidate = table[hash];
+            table[hash] = static_cast<uint32_t>(position + 1);
+
+            if (candidate == 0 || position - (candidate - 1) > MAX_OFFSET || Read32(source + candidate - 1) != sequence)
+            {
+                position++;
+                continue;
+            }
+            candidate--;
+
+            size_t matchLength = MIN_MATCH;
+            while (position + matchLength < matchLimit && source[candidate + matchLength] == source[position + matchLength])
+                matchLength++;
+
+            WriteSequence(out, source + anchor, position - anchor, position - candidate, matchLength);
+
+            position += matchLength;
+            anchor = position;
+        }
+    }
+
+    WriteSequence(out, source + anchor, sourceSize - anchor, 0, 0);
+    return out;
+}
+
+
+bool LZ4::Decompress(const uint8_t* source, size_t sourceSize, uint8_t* destination, size_t destinationSize)
+{
+    size_t in = 0;
+    size_t out = 0;
+
+    // Reads the extra bytes of a length that didnt fit in the token
+    auto readLength = [&](size_t& length) -> bool
+    {
+        uint8_t byte;
+        do
+        {
+            if (in >= sourceSize)
+                return false;
+            byte = source[in++];
+            length += byte;
+        } while (byte == 255);
+        return true;
+    };
+
+    while (in < sourceSize)
+    {
+        uint8_t token = source[in++];
+
+        // Literals
+        size_t literalLength = token >> 4;
+        if (literalLength == 15 && !readLength(literalLength))
+            return false;
+
+        if (literalLength > sourceSize - in || literalLength > destinationSize - out)
+            return false;
+        std::memcpy(destination + out, source + in, literalLength);
+        in += literalLength;
+        out += literalLength;
+
+        // The last sequence has no match
+        if (in >= sourceSize)
+            break;
+
+        // Match
+        if (sourceSize - in < 2)
+            return false;
+        size_t offset = source[in] | (size_t(source[in + 1]) << 8);
+        in += 2;
+        if (offset == 0 || offset > out)
+            return false;
+
+        size_t matchLength = token & 0x0F;
+        if (matchLength == 15 && !readLength(matchLength))
+            return false;
+        matchLength += MIN_MATCH;
+
+        if (matchLength > destinationSize - out)
+            return false;
+
+        // Matches can overlap the bytes they produce, so copy forwards one byte at a time
+        const uint8_t* match = destination + out - offset;
+        for (size_t i = 0; i < matchLength; i++)
+            destination[out + i] = match[i];
+        out += matchLength;
+    }
+
+    return out == destinationSize;
+}
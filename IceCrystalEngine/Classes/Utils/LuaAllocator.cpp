@@ -0,0 +1,126 @@
+#include <Ice/Utils/LuaAllocator.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+
+
+LuaAllocator::~LuaAllocator()
+{
+    for (void* page : pages)
+        std::free(page);
+}
+
+void* LuaAllocator::Alloc(void* ud, void* ptr, size_t osize, size_t nsize)
+{
+    LuaAllocator* allocator = static_cast<LuaAllocator*>(ud);
+
+    if (nsize == 0)
+    {
+        if (ptr != nullptr)
+        {
+            allocator->Free(ptr, osize);
+            allocator->Track(osize, 0);
+        }
+        return nullptr;
+    }
+
+    // New block, osize is just the type of object Lua is making
+    if (ptr == nullptr)
+    {
+        void* block = allocator->Allocate(nsize);
+        if (block != nullptr)
+            allocator->Track(0, nsize);
+        return block;
+    }
+
+    // Resizing, Lua always tells us the exact old size
+    void* block = nullptr;
+    if (IsPooled(osize) && IsPooled(nsize) && ClassOf(osize) == ClassOf(nsize))
+    {
+        // Still fits the same block
+        block = ptr;
+    }
+    else if (!IsPooled(osize) && !IsPooled(nsize))
+    {
+        block = std::realloc(ptr, nsize);
+        if (block != nullptr)
+            allocator->largeBytes = allocator->largeBytes - osize + nsize;
+    }
+    else
+    {
+        // Moving between the pools and malloc, on failure the old block has to stay valid
+        block = allocator->Allocate(nsize);
+        if (block != nullptr)
+        {
+            std::memcpy(block, ptr, std::min(osize, nsize));
+            allocator->Free(ptr, osize);
+        }
+    }
+
+    if (block != nullptr)
+        allocator->Track(osize, nsize);
+    return block;
+}
+
+void* LuaAllocator::Allocate(size_t size)
+{
+    if (!IsPooled(size))
+    {
+        void* block = std::malloc(size);
+        if (block != nullptr)
+            largeBytes += size;
+        return block;
+    }
+
+    size_t sizeClass = ClassOf(size);
+    FreeBlock* block = freeLists[sizeClass];
+    if (block != nullptr)
+    {
+        freeLists[sizeClass] = block->next;
+        return block;
+    }
+
+    return AllocateFromPage((sizeClass + 1) * granularity);
+}
+
+void LuaAllocator::Free(void* ptr, size_t size)
+{
+    if (!IsPooled(size))
+    {
+        std::free(ptr);
+        largeBytes -= size;
+        return;
+    }
+
+    size_t sizeClass = ClassOf(size);
+    FreeBlock* block = static_cast<FreeBlock*>(ptr);
+    block->next = freeLists[sizeClass];
+    freeLists[sizeClass] = block;
+}
+
+void* LuaAllocator::AllocateFromPage(size_t blockSize)
+{
+    if (pageCursor == nullptr || static_cast<size_t>(pageEnd - pageCursor) < blockSize)
+    {
+        // Whatever is left of the old page (less than one block) is just dropped
+        void* page = std::malloc(pageSize);
+        if (page == nullptr)
+            return nullptr;
+
+        pages.push_back(page);
+        pageCursor = static_cast<uint8_t*>(page);
+        pageEnd = pageCursor + pageSize;
+    }
+
+    // malloc alignment plus blocks that are multiples of 16 keeps every block 16 byte aligned
+    void* block = pageCursor;
+    pageCursor += blockSize;
+    return block;
+}
+
+void LuaAllocator::Track(size_t oldSize, size_t newSize)
+{
+    bytesInUse = bytesInUse - oldSize + newSize;
+    peakBytesInUse = std::max(peakBytesInUse, bytesInUse);
+}
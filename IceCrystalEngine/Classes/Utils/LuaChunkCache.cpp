@@ -0,0 +1,119 @@
+#include <Ice/Utils/LuaChunkCache.h>
+
+#include <vector>
+#include <cstring>
+
+// Bump when the wrapping below changes, old bytecode in the DerivedDataCache is then ignored
+static constexpr uint32_t bytecodeVersion = 1;
+
+// Kept on the first line so error line numbers still match the file
+static constexpr std::string_view chunkPrefix = "local _ENV = ...; return function(...) ";
+static constexpr std::string_view chunkSuffix = "\nend";
+
+
+sol::function LuaChunkCache::Instantiate(lua_State* L, const std::string& path, std::string_view source, const sol::environment& env, std::string& error)
+{
+    // Bytecode depends on the Lua version and the build (pointer size, number types), not just the source
+    DerivedDataKey key("LuaBytecode", bytecodeVersion);
+    key.Add(std::string_view(LUA_RELEASE)).Add(static_cast<uint64_t>(sizeof(void*))).Add(static_cast<uint64_t>(sizeof(lua_Number)));
+    key.Add(path).Add(source);
+    std::string keyString = key.ToString();
+
+    auto it = chunks.find(path);
+    if (it != chunks.end() && it->second.key == keyString)
+    {
+        memoryHits++;
+    }
+    else
+    {
+        // New script, or it changed on disk (hot reload)
+        std::string chunkName = "@" + path;
+        if (persistToDisk && LoadBytecode(L, key, chunkName))
+        {
+            diskHits++;
+        }
+        else
+        {
+            if (!Compile(L, source, chunkName, error))
+                return sol::function();
+
+            compiles++;
+            if (persistToDisk)
+                SaveBytecode(L, key);
+        }
+
+        Chunk chunk;
+        chunk.key = std::move(keyString);
+        chunk.factory = sol::main_reference(L, -1);
+        lua_pop(L, 1);
+        it = chunks.insert_or_assign(path, std::move(chunk)).first;
+    }
+
+    // factory(env) returns a new closure of the shared function, with env as its _ENV
+    it->second.factory.push(L);
+    env.push(L);
+    if (lua_pcall(L, 1, 1, 0) != LUA_OK)
+    {
+        error = lua_tostring(L, -1);
+        lua_pop(L, 1);
+        return sol::function();
+    }
+
+    sol::function instance(L, -1);
+    lua_pop(L, 1);
+    return instance;
+}
+
+
+bool LuaChunkCache::Compile(lua_State* L, std::string_view source, const std::string& chunkName, std::string& error)
+{
+    // The source ends up after the prefix, so a BOM or #! line would be a syntax error there
+    if (source.substr(0, 3) == "\xEF\xBB\xBF")
+        source.remove_prefix(3);
+
+    std::string wrapped;
+    wrapped.reserve(chunkPrefix.size() + source.size() + chunkSuffix.size() + 2);
+    wrapped += chunkPrefix;
+    if (!source.empty() && source[0] == '#')
+        wrapped += "--";
+    wrapped += source;
+    wrapped += chunkSuffix;
+
+    if (luaL_loadbufferx(L, wrapped.data(), wrapped.size(), chunkName.c_str(), "t") != LUA_OK)
+    {
+        error = lua_tostring(L, -1);
+        lua_pop(L, 1);
+        return false;
+    }
+    return true;
+}
+
+bool LuaChunkCache::LoadBytecode(lua_State* L, const DerivedDataKey& key, const std::string& chunkName)
+{
+    std::vector<uint8_t> data;
+    if (!DerivedDataCache::GetInstance().Get(key, data))
+        return false;
+
+    // Binary only, Lua checks the header (version, sizes) and rejects anything it cant load
+    if (luaL_loadbufferx(L, reinterpret_cast<const char*>(data.data()), data.size(), chunkName.c_str(), "b") != LUA_OK)
+    {
+        lua_pop(L, 1);
+        return false;
+    }
+    return true;
+}
+
+void LuaChunkCache::SaveBytecode(lua_State* L, const DerivedDataKey& key)
+{
+    std::vector<uint8_t> data;
+    auto writer = [](lua_State*, const void* chunk, size_t size, void* ud) -> int {
+        std::vector<uint8_t>* out = static_cast<std::vector<uint8_t>*>(ud);
+        const uint8_t* bytes = static_cast<const uint8_t*>(chunk);
+        out->insert(out->end(), bytes, bytes + size);
+        return 0;
+    };
+
+    // Debug info is kept (strip = 0), errors need the line numbers
+    if (lua_dump(L, writer, &data, 0) == 0 && !data.empty())
+        DerivedDataCache::GetInstance().Put(key, data);
+}
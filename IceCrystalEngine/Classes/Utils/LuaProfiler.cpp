@@ -0,0 +1,357 @@
+#include <Ice/Utils/LuaProfiler.h>
+#include <Ice/Utils/FileUtil.h>
+
+#include <JSON/json.h>
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <cstdio>
+
+using json = nlohmann::json;
+
+
+void LuaProfiler::Start(lua_State* L)
+{
+    if (running || L == nullptr)
+        return;
+
+    mainState = L;
+
+    // Wrap whatever allocator the state already has, every thread of this state shares it
+    previousAlloc = lua_getallocf(L, &previousAllocData);
+    lua_setallocf(L, &LuaProfiler::Alloc, this);
+
+    // Threads made from now on copy the hook, already running ones get it when their Scope starts
+    lua_sethook(L, &LuaProfiler::Hook, LUA_MASKCOUNT, sampleInterval);
+
+    if (scopes.empty() && timeline.empty())
+        startTime = Clock::now();
+
+    running = true;
+    BeginFrame();
+
+    std::cout << "Lua profiler started" << std::endl;
+}
+
+void LuaProfiler::Stop()
+{
+    if (!running)
+        return;
+
+    running = false;
+
+    // Blocks allocated through us came from previousAlloc anyway, so handing it back is safe
+    lua_sethook(mainState, nullptr, 0, 0);
+    lua_setallocf(mainState, previousAlloc, previousAllocData);
+    mainState = nullptr;
+
+    std::cout << "Lua profiler stopped" << std::endl;
+}
+
+void LuaProfiler::Reset()
+{
+    scopes.clear();
+    scopeLookup.clear();
+    scopeStack.clear();
+    timeline.clear();
+
+    allocatedBytes = 0;
+    allocationCount = 0;
+    sampleCount = 0;
+
+    startTime = Clock::now();
+    if (running)
+        BeginFrame();
+}
+
+void LuaProfiler::BeginFrame()
+{
+    frameNumber++;
+    if (!running)
+        return;
+
+    timeline.push_back({ frameNumber, MicrosecondsSinceStart(Clock::now()), {} });
+    while (timeline.size() > maxTimelineFrames)
+        timeline.pop_front();
+}
+
+
+bool LuaProfiler::PushScope(const std::string& script, const std::string& name, lua_State* thread)
+{
+    std::string key;
+    key.reserve(script.size() + name.size() + 1);
+    key += script;
+    key += '\n';
+    key += name;
+
+    auto [it, inserted] = scopeLookup.try_emplace(std::move(key), scopes.size());
+    if (inserted)
+    {
+        ScopeStats stats;
+        stats.script = script;
+        stats.name = name;
+        scopes.push_back(std::move(stats));
+    }
+
+    // Threads created before Start() dont have the hook yet
+    if (thread != nullptr)
+        lua_sethook(thread, &LuaProfiler::Hook, LUA_MASKCOUNT, sampleInterval);
+
+    scopeStack.push_back({ it->second, Clock::now(), allocatedBytes, allocationCount });
+    return true;
+}
+
+void LuaProfiler::PopScope()
+{
+    // Reset() from inside a script clears the stack under us
+    if (scopeStack.empty())
+        return;
+
+    ActiveScope active = scopeStack.back();
+    scopeStack.pop_back();
+
+    double ms = std::chrono::duration<double, std::milli>(Clock::now() - active.start).count();
+    uint64_t bytes = allocatedBytes - active.allocBytesAtStart;
+
+    ScopeStats& stats = scopes[active.stats];
+    stats.calls++;
+    stats.totalMs += ms;
+    stats.maxMs = std::max(stats.maxMs, ms);
+    stats.allocBytes += bytes;
+    stats.allocCount += allocationCount - active.allocCountAtStart;
+
+    if (!timeline.empty())
+        timeline.back().events.push_back({ active.stats, MicrosecondsSinceStart(active.start), ms * 1000.0, bytes });
+}
+
+double LuaProfiler::MicrosecondsSinceStart(Clock::time_point time) const
+{
+    return std::chrono::duration<double, std::micro>(time - startTime).count();
+}
+
+
+void* LuaProfiler::Alloc(void* ud, void* ptr, size_t osize, size_t nsize)
+{
+    LuaProfiler* profiler = static_cast<LuaProfiler*>(ud);
+
+    // When ptr is null osize is the type of object being made, not a size
+    size_t oldSize = ptr != nullptr ? osize : 0;
+    if (nsize > oldSize)
+    {
+        profiler->allocatedBytes += nsize - oldSize;
+        profiler->allocationCount++;
+    }
+
+    return profiler->previousAlloc(profiler->previousAllocData, ptr, osize, nsize);
+}
+
+void LuaProfiler::Hook(lua_State* L, lua_Debug* ar)
+{
+    LuaProfiler& profiler = GetInstance();
+    if (!profiler.running)
+    {
+        // Left over on a thread from an earlier run
+        lua_sethook(L, nullptr, 0, 0);
+        return;
+    }
+
+    if (ar->event != LUA_HOOKCOUNT || profiler.scopeStack.empty())
+        return;
+
+    if (!lua_getinfo(L, "Sn", ar))
+        return;
+
+    std::string function;
+    if (ar->name != nullptr)
+        function = ar->name;
+    else if (ar->what != nullptr && std::string(ar->what) == "main")
+        function = "main chunk";
+    else
+        function = "anonymous";
+    function += " (";
+    function += ar->short_src;
+    function += ":";
+    function += std::to_string(ar->linedefined);
+    function += ")";
+
+    ScopeStats& stats = profiler.scopes[profiler.scopeStack.back().stats];
+    stats.samples[function]++;
+    stats.sampleCount++;
+    profiler.sampleCount++;
+}
+
+
+std::string LuaProfiler::DescribeFunction(lua_State* L, int index, std::string* outSource)
+{
+    lua_Debug ar;
+    lua_pushvalue(L, index);
+    if (!lua_getinfo(L, ">S", &ar))
+        return "?";
+
+    // Scripts are loaded as "@path", strip the @ so it matches the executors file path
+    std::string source = ar.source != nullptr ? ar.source : "?";
+    if (!source.empty() && source[0] == '@')
+        source.erase(0, 1);
+
+    if (outSource != nullptr)
+        *outSource = source;
+
+    if (ar.what != nullptr && std::string(ar.what) == "C")
+        return "[C]";
+    return source + ":" + std::to_string(ar.linedefined);
+}
+
+
+// Sorted (function, samples) pairs, most samples first
+static std::vector<std::pair<std::string, uint64_t>> SortSamples(const std::unordered_map<std::string, uint64_t>& samples)
+{
+    std::vector<std::pair<std::string, uint64_t>> sorted(samples.begin(), samples.end());
+    std::sort(sorted.begin(), sorted.end(), [](const auto& a, const auto& b) { return a.second > b.second; });
+    return sorted;
+}
+
+std::string LuaProfiler::GetFlatReport(size_t maxRows) const
+{
+    std::vector<const ScopeStats*> sorted;
+    for (const ScopeStats& stats : scopes)
+        sorted.push_back(&stats);
+    std::sort(sorted.begin(), sorted.end(), [](const ScopeStats* a, const ScopeStats* b) { return a->totalMs > b->totalMs; });
+
+    std::ostringstream report;
+    char line[512];
+
+    std::snprintf(line, sizeof(line), "Lua profile: %zu frames, %llu samples, %.1f KB allocated in %llu allocations\n",
+                  timeline.size(), static_cast<unsigned long long>(sampleCount), allocatedBytes / 1024.0,
+                  static_cast<unsigned long long>(allocationCount));
+    report << line;
+    std::snprintf(line, sizeof(line), "%10s %8s %9s %9s %10s  %s\n", "Total ms", "Calls", "Avg ms", "Max ms", "Alloc KB", "Script / Scope");
+    report << line;
+
+    for (size_t i = 0; i < sorted.size() && i < maxRows; i++)
+    {
+        const ScopeStats& stats = *sorted[i];
+        double avg = stats.calls > 0 ? stats.totalMs / stats.calls : 0.0;
+        std::snprintf(line, sizeof(line), "%10.3f %8llu %9.4f %9.4f %10.1f  %s / %s\n", stats.totalMs,
+                      static_cast<unsigned long long>(stats.calls), avg, stats.maxMs, stats.allocBytes / 1024.0,
+                      stats.script.c_str(), stats.name.c_str());
+        report << line;
+
+        // The hottest few functions, enough to know where to look
+        auto samples = SortSamples(stats.samples);
+        for (size_t j = 0; j < samples.size() && j < 3; j++)
+        {
+            double percent = 100.0 * samples[j].second / std::max<uint64_t>(stats.sampleCount, 1);
+            std::snprintf(line, sizeof(line), "%52s%5.1f%%  %s\n", "", percent, samples[j].first.c_str());
+            report << line;
+        }
+    }
+
+    return report.str();
+}
+
+std::string LuaProfiler::GetTreeReport() const
+{
+    struct ScriptNode
+    {
+        double totalMs = 0.0;
+        uint64_t allocBytes = 0;
+        std::vector<const ScopeStats*> scopes;
+    };
+
+    std::unordered_map<std::string, ScriptNode> scripts;
+    for (const ScopeStats& stats : scopes)
+    {
+        ScriptNode& node = scripts[stats.script];
+        node.totalMs += stats.totalMs;
+        node.allocBytes += stats.allocBytes;
+        node.scopes.push_back(&stats);
+    }
+
+    std::vector<std::pair<std::string, ScriptNode*>> sorted;
+    for (auto& [script, node] : scripts)
+        sorted.push_back({ script, &node });
+    std::sort(sorted.begin(), sorted.end(), [](const auto& a, const auto& b) { return a.second->totalMs > b.second->totalMs; });
+
+    std::ostringstream report;
+    char line[512];
+
+    for (auto& [script, node] : sorted)
+    {
+        std::snprintf(line, sizeof(line), "%s  %.3f ms, %.1f KB\n", script.c_str(), node->totalMs, node->allocBytes / 1024.0);
+        report << line;
+
+        std::sort(node->scopes.begin(), node->scopes.end(), [](const ScopeStats* a, const ScopeStats* b) { return a->totalMs > b->totalMs; });
+        for (const ScopeStats* stats : node->scopes)
+        {
+            std::snprintf(line, sizeof(line), "  %s  %.3f ms over %llu calls, %.1f KB\n", stats->name.c_str(), stats->totalMs,
+                          static_cast<unsigned long long>(stats->calls), stats->allocBytes / 1024.0);
+            report << line;
+
+            for (const auto& [function, count] : SortSamples(stats->samples))
+            {
+                double percent = 100.0 * count / std::max<uint64_t>(stats->sampleCount, 1);
+                std::snprintf(line, sizeof(line), "    %5.1f%%  %s\n", percent, function.c_str());
+                report << line;
+            }
+        }
+    }
+
+    return report.str();
+}
+
+bool LuaProfiler::ExportTimeline(const std::string& path) const
+{
+    json events = json::array();
+
+    for (size_t i = 0; i < timeline.size(); i++)
+    {
+        const TimelineFrame& frame = timeline[i];
+
+        // A frame lasts until the next one starts, the last one until its last event ends
+        double endUs = frame.startUs;
+        if (i + 1 < timeline.size())
+            endUs = timeline[i + 1].startUs;
+        else
+        {
+            for (const TimelineEvent& event : frame.events)
+                endUs = std::max(endUs, event.startUs + event.durationUs);
+        }
+
+        events.push_back({
+            { "name", "Frame " + std::to_string(frame.number) },
+            { "ph", "X" }, { "pid", 1 }, { "tid", 0 },
+            { "ts", frame.startUs }, { "dur", endUs - frame.startUs }
+        });
+
+        for (const TimelineEvent& event : frame.events)
+        {
+            const ScopeStats& stats = scopes[event.stats];
+            events.push_back({
+                { "name", stats.name },
+                { "cat", stats.script },
+                { "ph", "X" }, { "pid", 1 }, { "tid", 1 },
+                { "ts", event.startUs }, { "dur", event.durationUs },
+                { "args", { { "script", stats.script }, { "allocBytes", event.allocBytes } } }
+            });
+        }
+    }
+
+    json trace = {
+        { "traceEvents", events },
+        { "displayTimeUnit", "ms" }
+    };
+
+    std::string fullPath = FileUtil::SubstituteVariables(path);
+    std::ofstream file(fullPath, std::ios::trunc);
+    if (!file.is_open())
+    {
+        std::cerr << "Failed to write Lua profile to " << fullPath << std::endl;
+        return false;
+    }
+    file << trace.dump();
+
+    std::cout << "Wrote Lua timeline (" << timeline.size() << " frames) to " << fullPath << std::endl;
+    return true;
+}
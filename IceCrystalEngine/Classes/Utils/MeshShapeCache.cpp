@@ -0,0 +1,198 @@
+#include <Ice/Utils/MeshShapeCache.h>
+
+#include <Jolt/Core/StreamWrapper.h>
+#include <Jolt/Physics/Collision/Shape/ScaledShape.h>
+
+#include <Ice/Utils/OBJLoader.h>
+#include <Ice/Utils/VirtualFileSystem.h>
+
+#include <iostream>
+#include <sstream>
+
+
+JPH::ShapeRefC MeshShapeCache::GetShape(const std::string& modelPath, int meshIndex)
+{
+    FileData source = VirtualFileSystem::GetInstance().Read(modelPath);
+    if (!source)
+    {
+        std::cout << "Failed to load collision mesh: " << modelPath << std::endl;
+        return nullptr;
+    }
+
+    // Keyed on the OBJ's contents like the render mesh, so the same model under another path is shared too
+    DerivedDataKey key = MakeKey();
+    key.Add(source.Span()).Add(static_cast<uint64_t>(meshIndex));
+
+    return GetOrCook(key, [&](JPH::TriangleList& triangles) {
+        objl::Loader loader;
+        if (!loader.LoadFile(modelPath) || meshIndex < 0 || meshIndex >= static_cast<int>(loader.LoadedMeshes.size()))
+        {
+            std::cout << "Failed to load collision mesh: " << modelPath << " (mesh " << meshIndex << ")" << std::endl;
+            return false;
+        }
+
+        const objl::Mesh& mesh = loader.LoadedMeshes[meshIndex];
+        triangles.reserve(mesh.Indices.size() / 3);
+        for (size_t i = 0; i + 2 < mesh.Indices.size(); i += 3)
+        {
+            JPH::Triangle triangle;
+            for (int corner = 0; corner < 3; corner++)
+            {
+                const objl::Vector3& p = mesh.Vertices[mesh.Indices[i + corner]].Position;
+                triangle.mV[corner] = JPH::Float3(p.X, p.Y, p.Z);
+            }
+            triangles.push_back(triangle);
+        }
+        return true;
+    });
+}
+
+JPH::ShapeRefC MeshShapeCache::GetShape(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices)
+{
+    // Only the positions matter for collision, uvs / normals changing shouldnt make a new shape
+    DerivedDataKey key = MakeKey();
+    key.Add(static_cast<uint64_t>(vertices.size()));
+    for (const Vertex& v : vertices)
+    {
+        const float position[3] = { v.x, v.y, v.z };
+        key.Add(position, sizeof(position));
+    }
+    key.Add(indices.data(), indices.size() * sizeof(uint32_t));
+
+    return GetOrCook(key, [&](JPH::TriangleList& triangles) {
+        AppendTriangles(vertices, indices, triangles);
+        return true;
+    });
+}
+
+JPH::ShapeRefC MeshShapeCache::Scale(const JPH::ShapeRefC& shape, const glm::vec3& scale)
+{
+    if (shape == nullptr)
+        return nullptr;
+
+    if (glm::all(glm::lessThan(glm::abs(scale - glm::vec3(1.0f)), glm::vec3(1e-6f))))
+        return shape;
+
+    return new JPH::ScaledShape(shape, JPH::Vec3(scale.x, scale.y, scale.z));
+}
+
+void MeshShapeCache::Clear()
+{
+    std::lock_guard lock(mutex);
+    shapes.clear();
+}
+
+int MeshShapeCache::GetShapeCount()
+{
+    std::lock_guard lock(mutex);
+    return static_cast<int>(shapes.size());
+}
+
+
+DerivedDataKey MeshShapeCache::MakeKey() const
+{
+    // The binary state is Jolt's own format, it can change between Jolt versions and double precision builds
+    DerivedDataKey key("MeshShape", MESH_SHAPE_COOKER_VERSION);
+    key.Add(static_cast<uint64_t>(JPH_VERSION_MAJOR)).Add(static_cast<uint64_t>(JPH_VERSION_MINOR)).Add(static_cast<uint64_t>(JPH_VERSION_PATCH));
+    key.Add(static_cast<uint64_t>(sizeof(JPH::Real)));
+    return key;
+}
+
+JPH::ShapeRefC MeshShapeCache::GetOrCook(const DerivedDataKey& key, const std::function<bool(JPH::TriangleList&)>& buildTriangles)
+{
+    std::string keyString = key.ToString();
+    {
+        std::lock_guard lock(mutex);
+        auto it = shapes.find(keyString);
+        if (it != shapes.end())
+        {
+            memoryHits++;
+            return it->second;
+        }
+    }
+
+    // Loading / cooking happens outside the lock, two threads asking for the same new mesh at once just both make it
+    JPH::ShapeRefC shape = persistToDisk ? LoadCooked(key) : nullptr;
+    if (shape != nullptr)
+    {
+        diskHits++;
+    }
+    else
+    {
+        JPH::TriangleList triangles;
+        if (!buildTriangles(triangles))
+            return nullptr;
+
+        shape = Cook(triangles);
+        if (shape == nullptr)
+            return nullptr;
+
+        cooks++;
+        if (persistToDisk)
+            SaveCooked(key, shape);
+    }
+
+    std::lock_guard lock(mutex);
+    return shapes.try_emplace(keyString, shape).first->second;
+}
+
+JPH::ShapeRefC MeshShapeCache::Cook(const JPH::TriangleList& triangles)
+{
+    JPH::MeshShapeSettings settings(triangles);
+    settings.SetEmbedded();
+    JPH::ShapeSettings::ShapeResult result = settings.Create();
+    if (result.HasError())
+    {
+        std::cerr << "Failed to cook collision mesh: " << result.GetError() << std::endl;
+        return nullptr;
+    }
+    return result.Get();
+}
+
+JPH::ShapeRefC MeshShapeCache::LoadCooked(const DerivedDataKey& key)
+{
+    std::vector<uint8_t> data;
+    if (!DerivedDataCache::GetInstance().Get(key, data))
+        return nullptr;
+
+    std::istringstream stream(std::string(reinterpret_cast<const char*>(data.data()), data.size()), std::ios::binary);
+    JPH::StreamInWrapper in(stream);
+    JPH::Shape::IDToShapeMap shapeMap;
+    JPH::Shape::IDToMaterialMap materialMap;
+    JPH::Shape::ShapeResult result = JPH::Shape::sRestoreWithChildren(in, shapeMap, materialMap);
+
+    // A truncated / corrupt entry just gets cooked again
+    if (result.HasError() || in.IsFailed())
+        return nullptr;
+    return result.Get();
+}
+
+void MeshShapeCache::SaveCooked(const DerivedDataKey& key, const JPH::Shape* shape)
+{
+    std::ostringstream stream(std::ios::binary);
+    JPH::StreamOutWrapper out(stream);
+    JPH::Shape::ShapeToIDMap shapeMap;
+    JPH::Shape::MaterialToIDMap materialMap;
+    shape->SaveWithChildren(out, shapeMap, materialMap);
+    if (out.IsFailed())
+        return;
+
+    std::string data = stream.str();
+    DerivedDataCache::GetInstance().Put(key, data.data(), data.size());
+}
+
+
+void MeshShapeCache::AppendTriangles(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, JPH::TriangleList& outTriangles)
+{
+    outTriangles.reserve(outTriangles.size() + indices.size() / 3);
+    for (size_t i = 0; i + 2 < indices.size(); i += 3)
+    {
+        JPH::Triangle triangle;
+        for (int corner = 0; corner < 3; corner++)
+        {
+            const Vertex& v = vertices[indices[i + corner]];
+            triangle.mV[corner] = JPH::Float3(v.x, v.y, v.z);
+        }
+        outTriangles.push_back(triangle);
+    }
+}
@@ -0,0 +1,341 @@
+#include <Ice/Utils/PakArchive.h>
+#include <Ice/Utils/FileUtil.h>
+#include <Ice/Utils/LZ4.h>
+
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <algorithm>
+#include <cstring>
+#include <cctype>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+
+// MappedFile
+std::shared_ptr<MappedFile> MappedFile::Open(const std::string& path)
+{
+    std::string fullPath = FileUtil::SubstituteVariables(path);
+    std::shared_ptr<MappedFile> file(new MappedFile());
+
+#ifdef _WIN32
+    HANDLE fileHandle = CreateFileA(fullPath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (fileHandle == INVALID_HANDLE_VALUE)
+        return nullptr;
+    file->fileHandle = fileHandle;
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(fileHandle, &fileSize) || fileSize.QuadPart == 0)
+        return nullptr;
+
+    HANDLE mappingHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mappingHandle == nullptr)
+        return nullptr;
+    file->mappingHandle = mappingHandle;
+
+    void* view = MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+    if (view == nullptr)
+        return nullptr;
+
+    file->data = static_cast<const std::byte*>(view);
+    file->size = static_cast<size_t>(fileSize.QuadPart);
+#else
+    int fd = open(fullPath.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return nullptr;
+    file->fd = fd;
+
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) != 0 || fileStat.st_size == 0)
+        return nullptr;
+
+    void* view = mmap(nullptr, static_cast<size_t>(fileStat.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    if (view == MAP_FAILED)
+        return nullptr;
+
+    file->data = static_cast<const std::byte*>(view);
+    file->size = static_cast<size_t>(fileStat.st_size);
+#endif
+
+    return file;
+}
+
+MappedFile::~MappedFile()
+{
+#ifdef _WIN32
+    if (data)
+        UnmapViewOfFile(data);
+    if (mappingHandle)
+        CloseHandle(mappingHandle);
+    if (fileHandle)
+        CloseHandle(fileHandle);
+#else
+    if (data)
+        munmap(const_cast<std::byte*>(data), size);
+    if (fd >= 0)
+        close(fd);
+#endif
+}
+
+
+// PakArchive
+std::string PakArchive::ToKey(const std::string& relativePath)
+{
+    std::string key = relativePath;
+    std::replace(key.begin(), key.end(), '\\', '/');
+    std::transform(key.begin(), key.end(), key.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return key;
+}
+
+bool PakArchive::Open(const std::string& path)
+{
+    mapping = MappedFile::Open(path);
+    if (!mapping)
+    {
+        std::cerr << "Failed to map archive " << path << std::endl;
+        return false;
+    }
+
+    const std::byte* base = mapping->Data();
+    size_t size = mapping->Size();
+
+    Header header;
+    if (size < sizeof(Header))
+    {
+        std::cerr << "Archive " << path << " is too small" << std::endl;
+        return false;
+    }
+    std::memcpy(&header, base, sizeof(Header));
+
+    if (std::memcmp(header.magic, magic, 4) != 0 || header.version != version)
+    {
+        std::cerr << "Archive " << path << " is not a supported .pak" << std::endl;
+        return false;
+    }
+    if (header.tocOffset > size || header.tocSize > size - header.tocOffset)
+    {
+        std::cerr << "Archive " << path << " has a corrupt table of contents" << std::endl;
+        return false;
+    }
+
+    // Table of contents: [pathLength][path][offset][size][storedSize][compression] per entry
+    const std::byte* toc = base + header.tocOffset;
+    size_t tocSize = static_cast<size_t>(header.tocSize);
+    size_t cursor = 0;
+
+    auto read = [&](void* out, size_t bytes) -> bool
+    {
+        if (bytes > tocSize - cursor)
+            return false;
+        std::memcpy(out, toc + cursor, bytes);
+        cursor += bytes;
+        return true;
+    };
+
+    // Every entry takes at least this much of the table (an empty path), so a count that doesnt fit is corrupt
+    constexpr size_t minEntrySize = sizeof(uint32_t) + sizeof(Entry::offset) + sizeof(Entry::size) + sizeof(Entry::storedSize) + sizeof(uint32_t);
+    if (header.entryCount > tocSize / minEntrySize)
+    {
+        std::cerr << "Archive " << path << " has a corrupt table of contents" << std::endl;
+        return false;
+    }
+
+    entries.clear();
+    entries.reserve(header.entryCount);
+    for (uint32_t i = 0; i < header.entryCount; i++)
+    {
+        uint32_t pathLength = 0;
+        std::string entryPath;
+        Entry entry;
+        uint32_t compression = 0;
+
+        bool ok = read(&pathLength, sizeof(pathLength));
+        if (ok)
+        {
+            entryPath.resize(pathLength);
+            ok = read(entryPath.data(), pathLength);
+        }
+        ok = ok && read(&entry.offset, sizeof(entry.offset)) && read(&entry.size, sizeof(entry.size)) &&
+             read(&entry.storedSize, sizeof(entry.storedSize)) && read(&compression, sizeof(compression));
+
+        // Uncompressed entries are handed out straight from the mapping, and LZ4 cant turn one byte into more than 255,
+        // so both sizes have to be checked here, not just the stored range
+        entry.compression = static_cast<Compression>(compression);
+        bool sizeValid = (entry.compression == Compression::None && entry.size == entry.storedSize) ||
+                         (entry.compression == Compression::LZ4 && entry.size <= entry.storedSize * 255);
+
+        if (!ok || entry.offset > size || entry.storedSize > size - entry.offset || !sizeValid)
+        {
+            std::cerr << "Archive " << path << " has a corrupt table of contents" << std::endl;
+            entries.clear();
+            return false;
+        }
+
+        entries[ToKey(entryPath)] = entry;
+    }
+
+    return true;
+}
+
+bool PakArchive::Exists(const std::string& relativePath) const
+{
+    return entries.find(ToKey(relativePath)) != entries.end();
+}
+
+FileData PakArchive::Read(const std::string& relativePath) const
+{
+    auto it = entries.find(ToKey(relativePath));
+    if (it == entries.end())
+        return FileData();
+
+    const Entry& entry = it->second;
+    const std::byte* stored = mapping->Data() + entry.offset;
+
+    switch (entry.compression)
+    {
+    case Compression::None:
+        // Straight out of the mapping, no copy
+        return FileData(stored, static_cast<size_t>(entry.size), mapping);
+
+    case Compression::LZ4:
+    {
+        std::vector<std::byte> buffer(static_cast<size_t>(entry.size));
+        if (!LZ4::Decompress(reinterpret_cast<const uint8_t*>(stored), static_cast<size_t>(entry.storedSize),
+                             reinterpret_cast<uint8_t*>(buffer.data()), buffer.size()))
+        {
+            std::cerr << "Failed to decompress " << relativePath << " from archive" << std::endl;
+            return FileData();
+        }
+        return FileData(std::move(buffer));
+    }
+
+    default:
+        std::cerr << "Unsupported compression for " << relativePath << std::endl;
+        return FileData();
+    }
+}
+
+
+bool PakArchive::Build(const std::string& sourceDirectory, const std::string& outputPath, bool compress, uint32_t alignment)
+{
+    std::string sourceRoot = FileUtil::SubstituteVariables(sourceDirectory);
+    std::error_code ec;
+    if (!fs::is_directory(sourceRoot, ec))
+    {
+        std::cerr << "Cannot pack " << sourceRoot << ", it is not a directory" << std::endl;
+        return false;
+    }
+    if (alignment == 0)
+        alignment = 1;
+
+    // Sort so the same folder always produces the same archive
+    std::vector<fs::path> files;
+    for (auto it = fs::recursive_directory_iterator(sourceRoot, ec); !ec && it != fs::recursive_directory_iterator(); it.increment(ec))
+    {
+        if (it->is_regular_file(ec))
+            files.push_back(it->path());
+    }
+    std::sort(files.begin(), files.end());
+
+    std::string outputFile = FileUtil::SubstituteVariables(outputPath);
+    std::ofstream out(outputFile, std::ios::binary | std::ios::trunc);
+    if (!out.is_open())
+    {
+        std::cerr << "Failed to open " << outputFile << " for writing" << std::endl;
+        return false;
+    }
+
+    // Header gets filled in at the end
+    Header header = {};
+    std::memcpy(header.magic, magic, 4);
+    header.version = version;
+    header.alignment = alignment;
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    std::vector<char> toc;
+    auto writeToc = [&toc](const void* data, size_t bytes)
+    {
+        const char* chars = static_cast<const char*>(data);
+        toc.insert(toc.end(), chars, chars + bytes);
+    };
+
+    uint64_t offset = sizeof(header);
+    uint64_t totalSize = 0;
+    uint64_t totalStored = 0;
+
+    for (const fs::path& file : files)
+    {
+        std::string relativePath = fs::relative(file, sourceRoot, ec).generic_string();
+        if (ec || relativePath.empty())
+            continue;
+
+        std::ifstream in(file, std::ios::binary);
+        std::vector<uint8_t> contents((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+        Entry entry;
+        entry.size = contents.size();
+
+        const std::vector<uint8_t>* stored = &contents;
+        std::vector<uint8_t> compressed;
+        if (compress && !contents.empty())
+        {
+            compressed = LZ4::Compress(contents.data(), contents.size());
+            // Not worth the decompression time unless it saves at least ~10%
+            if (compressed.size() < contents.size() - contents.size() / 10)
+            {
+                stored = &compressed;
+                entry.compression = Compression::LZ4;
+            }
+        }
+        entry.storedSize = stored->size();
+
+        // Pad up to the alignment
+        uint64_t padding = (alignment - offset % alignment) % alignment;
+        for (uint64_t i = 0; i < padding; i++)
+            out.put('\0');
+        offset += padding;
+
+        entry.offset = offset;
+        out.write(reinterpret_cast<const char*>(stored->data()), static_cast<std::streamsize>(stored->size()));
+        offset += stored->size();
+
+        uint32_t pathLength = static_cast<uint32_t>(relativePath.size());
+        uint32_t compression = static_cast<uint32_t>(entry.compression);
+        writeToc(&pathLength, sizeof(pathLength));
+        writeToc(relativePath.data(), relativePath.size());
+        writeToc(&entry.offset, sizeof(entry.offset));
+        writeToc(&entry.size, sizeof(entry.size));
+        writeToc(&entry.storedSize, sizeof(entry.storedSize));
+        writeToc(&compression, sizeof(compression));
+
+        header.entryCount++;
+        totalSize += entry.size;
+        totalStored += entry.storedSize;
+    }
+
+    header.tocOffset = offset;
+    header.tocSize = toc.size();
+    out.write(toc.data(), static_cast<std::streamsize>(toc.size()));
+
+    out.seekp(0);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    if (!out)
+    {
+        std::cerr << "Failed to write " << outputFile << std::endl;
+        return false;
+    }
+
+    std::cout << "Packed " << header.entryCount << " files from " << sourceRoot << " into " << outputFile
+              << " (" << totalSize << " -> " << totalStored << " bytes)" << std::endl;
+    return true;
+}
@@ -0,0 +1,154 @@
+#include <Ice/Utils/SnapshotRingBuffer.h>
+
+#include <Ice/Utils/LZ4.h>
+
+#include <algorithm>
+
+SnapshotRingBuffer::SnapshotRingBuffer(int capacity, int keyframeInterval)
+{
+    Configure(capacity, keyframeInterval);
+}
+
+void SnapshotRingBuffer::Configure(int capacity, int keyframeInterval)
+{
+    this->capacity = std::max(0, capacity);
+    this->keyframeInterval = std::max(1, keyframeInterval);
+    Clear();
+}
+
+
+void SnapshotRingBuffer::Push(uint64_t tick, const std::vector<uint8_t>& state)
+{
+    if (capacity <= 0)
+        return;
+
+    // A tick that was already recorded (pushed again while resimulating) replaces it and everything after it
+    if (!entries.empty() && tick <= entries.back().tick)
+    {
+        if (tick == 0)
+            Clear();
+        else
+            DiscardAfter(tick - 1);
+    }
+
+    Entry entry;
+    entry.tick = tick;
+    entry.rawSize = static_cast<uint32_t>(state.size());
+
+    // Bodies being added / removed changes the size, the delta wouldnt line up so that starts a new keyframe too
+    entry.keyframe = sinceKeyframe + 1 >= keyframeInterval || state.size() != keyframeState.size() || entries.empty();
+    if (entry.keyframe)
+    {
+        entry.data = LZ4::Compress(state.data(), state.size());
+        keyframeState = state;
+        sinceKeyframe = 0;
+    }
+    else
+    {
+        std::vector<uint8_t> delta(state.size());
+        for (size_t i = 0; i < state.size(); i++)
+            delta[i] = state[i] ^ keyframeState[i];
+        entry.data = LZ4::Compress(delta.data(), delta.size());
+        sinceKeyframe++;
+    }
+    entries.push_back(std::move(entry));
+
+    // Deltas need their keyframe, so whole keyframe groups are dropped once the rest still covers the capacity
+    while (static_cast<int>(entries.size()) > capacity)
+    {
+        auto nextKeyframe = std::find_if(entries.begin() + 1, entries.end(), [](const Entry& e) { return e.keyframe; });
+        if (nextKeyframe == entries.end() || static_cast<int>(entries.end() - nextKeyframe) < capacity)
+            break;
+        entries.erase(entries.begin(), nextKeyframe);
+    }
+}
+
+bool SnapshotRingBuffer::Get(uint64_t tick, std::vector<uint8_t>& outState) const
+{
+    auto entry = Find(tick);
+    if (entry == entries.end())
+        return false;
+
+    if (entry->keyframe)
+        return Decompress(*entry, outState);
+
+    // The keyframe is the closest one before it, always still in the buffer
+    auto it = entry;
+    const Entry* keyframe = nullptr;
+    while (it != entries.begin())
+    {
+        --it;
+        if (it->keyframe)
+        {
+            keyframe = &*it;
+            break;
+        }
+    }
+
+    std::vector<uint8_t> delta;
+    if (keyframe == nullptr || !Decompress(*keyframe, outState) || !Decompress(*entry, delta) || delta.size() != outState.size())
+        return false;
+
+    for (size_t i = 0; i < delta.size(); i++)
+        outState[i] ^= delta[i];
+    return true;
+}
+
+void SnapshotRingBuffer::DiscardAfter(uint64_t tick)
+{
+    bool droppedKeyframe = false;
+    while (!entries.empty() && entries.back().tick > tick)
+    {
+        droppedKeyframe |= entries.back().keyframe;
+        entries.pop_back();
+    }
+
+    if (!droppedKeyframe)
+    {
+        sinceKeyframe = 0;
+        for (auto it = entries.rbegin(); it != entries.rend() && !it->keyframe; ++it)
+            sinceKeyframe++;
+        return;
+    }
+
+    // The newest keyframe went away, the one before it becomes the base for new deltas again
+    keyframeState.clear();
+    sinceKeyframe = 0;
+    for (auto it = entries.rbegin(); it != entries.rend(); ++it)
+    {
+        if (it->keyframe)
+        {
+            Decompress(*it, keyframeState);
+            break;
+        }
+        sinceKeyframe++;
+    }
+}
+
+void SnapshotRingBuffer::Clear()
+{
+    entries.clear();
+    keyframeState.clear();
+    sinceKeyframe = 0;
+}
+
+size_t SnapshotRingBuffer::GetMemoryUsage() const
+{
+    size_t total = keyframeState.capacity();
+    for (const Entry& entry : entries)
+        total += sizeof(Entry) + entry.data.capacity();
+    return total;
+}
+
+
+std::deque<SnapshotRingBuffer::Entry>::const_iterator SnapshotRingBuffer::Find(uint64_t tick) const
+{
+    auto it = std::lower_bound(entries.begin(), entries.end(), tick, [](const Entry& entry, uint64_t t) { return entry.tick < t; });
+    return it != entries.end() && it->tick == tick ? it : entries.end();
+}
+
+bool SnapshotRingBuffer::Decompress(const Entry& entry, std::vector<uint8_t>& outState)
+{
+    outState.resize(entry.rawSize);
+    return LZ4::Decompress(entry.data.data(), entry.data.size(), outState.data(), outState.size());
+}
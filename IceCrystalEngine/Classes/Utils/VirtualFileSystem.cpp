@@ -0,0 +1,270 @@
+#include <Ice/Utils/VirtualFileSystem.h>
+#include <Ice/Utils/PakArchive.h>
+#include <Ice/Utils/FileUtil.h>
+
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+
+namespace fs = std::filesystem;
+
+// Reads a whole file from disk, invalid FileData if it doesnt exist
+static FileData ReadDiskFile(const std::string& path)
+{
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file.is_open())
+        return FileData();
+
+    std::streamsize size = file.tellg();
+    if (size < 0)
+        return FileData();
+    file.seekg(0, std::ios::beg);
+
+    std::vector<std::byte> buffer(static_cast<size_t>(size));
+    if (size > 0 && !file.read(reinterpret_cast<char*>(buffer.data()), size))
+        return FileData();
+
+    return FileData(std::move(buffer));
+}
+
+static std::unique_ptr<std::istream> OpenDiskStream(const std::string& path)
+{
+    std::unique_ptr<std::ifstream> file = std::make_unique<std::ifstream>(path, std::ios::binary);
+    if (!file->is_open())
+        return nullptr;
+    return file;
+}
+
+// A MemoryStream that keeps the FileData it reads from alive (the data has to exist before the stream is made)
+struct FileDataHolder
+{
+    FileData data;
+};
+
+class FileDataStream : private FileDataHolder, public MemoryStream
+{
+public:
+    FileDataStream(FileData&& fileData) : FileDataHolder{ std::move(fileData) }, MemoryStream(FileDataHolder::data.View()) {}
+};
+
+
+// FileData
+FileData::FileData(std::vector<std::byte>&& buffer) : valid(true), owned(std::move(buffer))
+{
+    data = owned.data();
+    size = owned.size();
+}
+
+FileData::FileData(const std::byte* data, size_t size, std::shared_ptr<void> keepAlive)
+    : data(data), size(size), valid(true), keepAlive(std::move(keepAlive))
+{
+}
+
+FileData::FileData(FileData&& other) noexcept
+{
+    *this = std::move(other);
+}
+
+FileData& FileData::operator=(FileData&& other) noexcept
+{
+    if (this == &other)
+        return *this;
+
+    // Moving the vector keeps its heap buffer, so data stays valid
+    bool ownsData = !other.owned.empty() && other.data == other.owned.data();
+    owned = std::move(other.owned);
+    keepAlive = std::move(other.keepAlive);
+    data = ownsData ? owned.data() : other.data;
+    size = other.size;
+    valid = other.valid;
+
+    other.data = nullptr;
+    other.size = 0;
+    other.valid = false;
+    return *this;
+}
+
+
+// MemoryStream
+MemoryStream::Buffer::Buffer(std::string_view data)
+{
+    char* begin = const_cast<char*>(data.data()); // never written to, std::streambuf just wants non const pointers
+    setg(begin, begin, begin + data.size());
+}
+
+MemoryStream::Buffer::pos_type MemoryStream::Buffer::seekoff(off_type offset, std::ios_base::seekdir dir, std::ios_base::openmode which)
+{
+    char* target = nullptr;
+    if (dir == std::ios_base::beg)
+        target = eback() + offset;
+    else if (dir == std::ios_base::cur)
+        target = gptr() + offset;
+    else
+        target = egptr() + offset;
+
+    if (!(which & std::ios_base::in) || target < eback() || target > egptr())
+        return pos_type(off_type(-1));
+
+    setg(eback(), target, egptr());
+    return pos_type(target - eback());
+}
+
+MemoryStream::Buffer::pos_type MemoryStream::Buffer::seekpos(pos_type position, std::ios_base::openmode which)
+{
+    return seekoff(off_type(position), std::ios_base::beg, which);
+}
+
+MemoryStream::MemoryStream(std::string_view data) : std::istream(nullptr), buffer(data)
+{
+    rdbuf(&buffer);
+}
+
+
+// IFileSource
+std::unique_ptr<std::istream> IFileSource::OpenStream(const std::string& relativePath) const
+{
+    FileData data = Read(relativePath);
+    if (!data)
+        return nullptr;
+    return std::make_unique<FileDataStream>(std::move(data));
+}
+
+
+// DirectorySource
+DirectorySource::DirectorySource(const std::string& directory) : directory(FileUtil::NormalizePath(directory))
+{
+    if (!this->directory.empty() && this->directory.back() != '/')
+        this->directory += '/';
+}
+
+bool DirectorySource::Exists(const std::string& relativePath) const
+{
+    std::error_code ec;
+    return fs::exists(directory + relativePath, ec);
+}
+
+FileData DirectorySource::Read(const std::string& relativePath) const
+{
+    return ReadDiskFile(directory + relativePath);
+}
+
+std::unique_ptr<std::istream> DirectorySource::OpenStream(const std::string& relativePath) const
+{
+    return OpenDiskStream(directory + relativePath);
+}
+
+
+// VirtualFileSystem
+void VirtualFileSystem::Mount(const std::string& mountPoint, std::unique_ptr<IFileSource> source)
+{
+    std::string prefix = FileUtil::NormalizePath(mountPoint);
+    if (!prefix.empty() && prefix.back() != '/')
+        prefix += '/';
+
+    mounts.push_back({ prefix, std::move(source) });
+}
+
+bool VirtualFileSystem::MountArchive(const std::string& mountPoint, const std::string& archivePath)
+{
+    std::unique_ptr<PakArchive> archive = std::make_unique<PakArchive>();
+    if (!archive->Open(archivePath))
+        return false;
+
+    std::cout << "Mounted " << FileUtil::SubstituteVariables(archivePath) << " (" << archive->GetEntryCount() << " files)" << std::endl;
+    Mount(mountPoint, std::move(archive));
+    return true;
+}
+
+void VirtualFileSystem::UnmountAll()
+{
+    mounts.clear();
+}
+
+void VirtualFileSystem::MountDefaultArchives()
+{
+    std::error_code ec;
+
+    std::string assetPak = FileUtil::ProjectRoot + "Assets.pak";
+    if (fs::exists(assetPak, ec))
+        MountArchive(FileUtil::AssetDir, assetPak);
+
+    std::string engineAssetPak = FileUtil::GetExecutableDir() + "EngineAssets.pak";
+    if (fs::exists(engineAssetPak, ec))
+        MountArchive(FileUtil::EngineAssetDir, engineAssetPak);
+}
+
+
+bool VirtualFileSystem::Exists(const std::string& path)
+{
+    std::string normalized = FileUtil::NormalizePath(path);
+    std::error_code ec;
+
+    if (preferLooseFiles && fs::exists(normalized, ec))
+        return true;
+
+    // Newest mount first
+    for (auto it = mounts.rbegin(); it != mounts.rend(); ++it)
+    {
+        if (normalized.compare(0, it->prefix.size(), it->prefix) != 0)
+            continue;
+
+        if (it->source->Exists(normalized.substr(it->prefix.size())))
+            return true;
+    }
+
+    return !preferLooseFiles && fs::exists(normalized, ec);
+}
+
+FileData VirtualFileSystem::Read(const std::string& path)
+{
+    std::string normalized = FileUtil::NormalizePath(path);
+
+    if (preferLooseFiles)
+    {
+        FileData data = ReadDiskFile(normalized);
+        if (data)
+            return data;
+    }
+
+    // Newest mount first
+    for (auto it = mounts.rbegin(); it != mounts.rend(); ++it)
+    {
+        if (normalized.compare(0, it->prefix.size(), it->prefix) != 0)
+            continue;
+
+        FileData data = it->source->Read(normalized.substr(it->prefix.size()));
+        if (data)
+            return data;
+    }
+
+    if (!preferLooseFiles)
+        return ReadDiskFile(normalized);
+
+    return FileData();
+}
+
+std::unique_ptr<std::istream> VirtualFileSystem::OpenStream(const std::string& path)
+{
+    std::string normalized = FileUtil::NormalizePath(path);
+
+    if (preferLooseFiles)
+    {
+        if (std::unique_ptr<std::istream> stream = OpenDiskStream(normalized))
+            return stream;
+    }
+
+    // Newest mount first
+    for (auto it = mounts.rbegin(); it != mounts.rend(); ++it)
+    {
+        if (normalized.compare(0, it->prefix.size(), it->prefix) != 0)
+            continue;
+
+        if (std::unique_ptr<std::istream> stream = it->source->OpenStream(normalized.substr(it->prefix.size())))
+            return stream;
+    }
+
+    if (!preferLooseFiles)
+        return OpenDiskStream(normalized);
+
+    return nullptr;
+}
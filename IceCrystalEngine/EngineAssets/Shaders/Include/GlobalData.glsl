@@ -0,0 +1,12 @@
+// Per-frame camera data, bound by the RendererManager at binding 0
+layout(std140, binding = 0) uniform GlobalData
+{
+    mat4 view;
+    mat4 projection;
+    vec3 viewPos;
+    float time;
+    float nearPlane;
+    float farPlane;
+    float gd_padding0;
+    float gd_padding1;
+};
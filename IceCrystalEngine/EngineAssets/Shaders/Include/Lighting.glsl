@@ -0,0 +1,149 @@
+// Light data shared by every lit shader, filled in by the RendererManager
+// (and the Renderer for spot lights)
+#include "GlobalData.glsl"
+
+#define MAX_POINT_LIGHTS 64
+#define MAX_SPOT_LIGHTS 16
+#define MAX_CASCADES 4
+
+layout(std140, binding = 1) uniform LightingData
+{
+    int directionalLightExists;
+    int pointLightCount;
+    int spotLightCount;
+
+    float ambientLightStrength;
+    vec3 ambientLightColor;
+
+    int ld_padding0;
+};
+
+layout(std140, binding = 2) uniform DirectionalLightData
+{
+    vec3 direction;
+    int enabled;
+
+    vec3 color;
+    float dld_padding1;
+
+    float strength;
+    int castShadows;
+    int cascadeCount;
+    int dld_padding2;
+
+    float cascadeSplits[MAX_CASCADES];
+} directionalLight;
+uniform sampler2DArray directionalShadowMap;
+layout(std140, binding = 3) uniform DirectionalCascadeData {
+    mat4 cascadeMatrices[MAX_CASCADES];
+} uboCascade;
+
+struct PointLight
+{
+    vec3 position;
+    int enabled;
+
+    vec3 color;
+    float strength;
+
+    vec3 pl_padding1;
+    float radius;
+};
+layout(std140, binding = 4) uniform PointLightData
+{
+    PointLight pointLights[MAX_POINT_LIGHTS];
+};
+
+uniform struct SpotLight {
+    vec3 position;
+    vec3 direction;
+    vec3 color;
+    float strength;
+    float distance;
+    float angle;
+    float outerAngle;
+    mat4 lightSpaceMatrix;
+    bool castShadows;
+} spotLights[MAX_SPOT_LIGHTS];
+uniform sampler2D spotShadowMap[MAX_SPOT_LIGHTS];
+
+
+// Returns how much of the directional light is blocked (0 = fully lit, 1 = fully shadowed)
+float DirectionalShadow(vec3 fragPos)
+{
+    if (directionalLightExists != 1 || directionalLight.castShadows != 1 || directionalLight.enabled != 1)
+        return 0.0;
+
+    // Choose cascade based on view-space depth
+    vec4 fragPosViewSpace = view * vec4(fragPos, 1.0);
+    float depthValue = abs(fragPosViewSpace.z);
+
+    int cascade = -1;
+    for (int c = 0; c < directionalLight.cascadeCount; c++)
+    {
+        if (depthValue < directionalLight.cascadeSplits[c])
+        {
+            cascade = c;
+            break;
+        }
+    }
+    if (cascade == -1)
+    {
+        cascade = directionalLight.cascadeCount;
+    }
+
+    // Transform fragment into light space
+    vec4 fragPosLightSpace = uboCascade.cascadeMatrices[cascade] * vec4(fragPos, 1.0);
+    vec3 proj = fragPosLightSpace.xyz / fragPosLightSpace.w;
+    proj = proj * 0.5 + 0.5;
+
+    // Outside of the shadow map
+    if (proj.z >= 1.0)
+        return 0.0;
+
+    // PCF Sampling
+    ivec3 size = textureSize(directionalShadowMap, 0);
+    vec2 texelSize = 1.0 / vec2(size.xy);
+
+    float shadowSum = 0.0;
+    for (int x = -2; x <= 2; x++)
+    {
+        for (int y = -2; y <= 2; y++)
+        {
+            float sampleDepth = texture(directionalShadowMap, vec3(proj.xy + vec2(x, y) * texelSize, cascade)).r;
+            shadowSum += proj.z > sampleDepth ? 1.0 : 0.0;
+        }
+    }
+    return shadowSum / 25.0;
+}
+
+// Returns how much of spot light i is blocked (0 = fully lit, 1 = fully shadowed)
+float SpotShadow(int i, vec3 fragPos)
+{
+    if (!spotLights[i].castShadows)
+        return 0.0;
+
+    vec4 fragPosLightSpace = spotLights[i].lightSpaceMatrix * vec4(fragPos, 1.0);
+
+    vec3 projCoords = fragPosLightSpace.xyz / fragPosLightSpace.w;
+    projCoords = projCoords * 0.5 + 0.5;
+
+    if (projCoords.z > 1.0)
+        return 0.0;
+
+    float currentDepth = projCoords.z;
+    float bias = 0.0003;
+
+    vec2 texelSize = 1.0 / textureSize(spotShadowMap[i], 0);
+
+    float shadowSum = 0.0;
+    for (int x = -2; x <= 2; ++x)
+    {
+        for (int y = -2; y <= 2; ++y)
+        {
+            float pcfDepth = texture(spotShadowMap[i], projCoords.xy + vec2(x, y) * texelSize).r;
+            shadowSum += currentDepth - bias > pcfDepth ? 1.0 : 0.0;
+        }
+    }
+    return shadowSum / 25.0;
+}
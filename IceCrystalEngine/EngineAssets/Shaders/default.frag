@@ -1,5 +1,8 @@
 #version 430 core
 
+// Permutations, enable them from a material with "Keywords": [ ... ] to skip work the material doesnt need
+#pragma keywords NO_SHADOWS NO_POINT_LIGHTS NO_SPOT_LIGHTS
+
 layout (location = 0) out vec4 FragColor;
 layout (location = 1) out vec4 BrightColor;
 layout (location = 2) out vec4 PickColor;
@@ -8,69 +11,7 @@ in vec2 fragUV;
 in vec3 fragNormal;
 in vec3 fragPos;
 
-layout(std140, binding = 0) uniform GlobalData
-{
-    mat4 view;
-    mat4 projection;
-    vec3 viewPos;
-    float time;
-    float nearPlane;
-    float farPlane;
-    float gd_padding0;
-    float gd_padding1;
-};
-
-#define MAX_POINT_LIGHTS 64
-#define MAX_SPOT_LIGHTS 16
-#define MAX_CASCADES 4
-
-layout(std140, binding = 1) uniform LightingData
-{
-    int directionalLightExists;
-    int pointLightCount;
-    int spotLightCount;
-
-    float ambientLightStrength;
-    vec3 ambientLightColor;
-
-    int ld_padding0;
-};
-
-layout(std140, binding = 2) uniform DirectionalLightData
-{
-    vec3 direction;
-    int enabled;
-
-    vec3 color;
-    float dld_padding1;
-
-    float strength;
-    int castShadows;
-    int cascadeCount;
-    int dld_padding2;
-
-    float cascadeSplits[MAX_CASCADES];
-} directionalLight;
-uniform sampler2DArray directionalShadowMap;
-layout(std140, binding = 3) uniform DirectionalCascadeData {
-    mat4 cascadeMatrices[MAX_CASCADES];
-} uboCascade;
-
-struct PointLight
-{
-    vec3 position;
-    int enabled;
-
-    vec3 color;
-    float strength;
-
-    vec3 pl_padding1;
-    float radius;
-};
-layout(std140, binding = 4) uniform PointLightData
-{
-    PointLight pointLights[MAX_POINT_LIGHTS];
-};
+#include "Include/Lighting.glsl"
 
 // poor mans raycasting
 uniform vec3 uniqueColor;
@@ -80,19 +21,6 @@ uniform vec3 fragColor;
 
 uniform float smoothness;
 
-uniform struct SpotLight {
-    vec3 position;
-    vec3 direction;
-    vec3 color;
-    float strength;
-    float distance;
-    float angle;
-    float outerAngle;
-    mat4 lightSpaceMatrix;
-    bool castShadows;
-} spotLights[MAX_SPOT_LIGHTS];;
-uniform sampler2D spotShadowMap[MAX_SPOT_LIGHTS];
-
 
 void main()
 {
@@ -107,9 +35,6 @@ void main()
     vec3 viewDir = normalize(viewPos - fragPos);
 
     // Directional Light
-    // -------------------------------------------------
-    // 1. Base lighting (diffuse + specular)
-    // -------------------------------------------------
     vec3 lightDir = normalize(-directionalLight.direction);
     vec3 color = directionalLight.color;
     float strength = directionalLight.strength;
@@ -124,114 +49,16 @@ void main()
     vec3 diffuse = diff * color;
     vec3 specular = spec * color;
 
-    // =================================================
-    // SHADOW CALCULATION
-    // =================================================
+#ifndef NO_SHADOWS
+    float shadow = DirectionalShadow(fragPos);
+#else
     float shadow = 0.0;
+#endif
 
-    if (directionalLightExists == 1 && directionalLight.castShadows == 1 && directionalLight.enabled == 1)
-    {
-        // ---------------------------------------------
-        // 2. Choose cascade based on view-space depth
-        // ---------------------------------------------
-        vec4 fragPosViewSpace = view * vec4(fragPos, 1.0);
-        float depthValue = abs(fragPosViewSpace.z);
-
-        int cascade = -1;
-        for (int c = 0; c < directionalLight.cascadeCount; c++)
-        {
-            if (depthValue < directionalLight.cascadeSplits[c])
-            {
-                cascade = c;
-                break;
-            }
-        }
-        if (cascade == -1)
-        {
-            cascade = directionalLight.cascadeCount;
-        }
-
-        // ---------------------------------------------
-        // SET COLOR AND RETURN BASED ON CASCADE INDEX
-        // ---------------------------------------------
-        //        if (cascade == 0)
-        //        {
-        //            FragColor = vec4(1, 0, 0, 1);   // red
-        //            return;
-        //        }
-        //        else if (cascade == 1)
-        //        {
-        //            FragColor = vec4(0, 1, 0, 1);   // green
-        //            return;
-        //        }
-        //        else if (cascade == 2)
-        //        {
-        //            FragColor = vec4(0, 0, 1, 1);   // blue
-        //            return;
-        //        }
-        //        else if (cascade == 3)
-        //        {
-        //            FragColor = vec4(1, 1, 0, 1);   // yellow
-        //            return;
-        //        }
-        //
-        //        // fallback in case extra cascades exist
-        //        FragColor = vec4(1, 0, 1, 1);       // magenta
-        //        return;
-
-        // ---------------------------------------------
-        // 3. Transform fragment into light space
-        // ---------------------------------------------
-        vec4 fragPosLightSpace = uboCascade.cascadeMatrices[cascade] * vec4(fragPos, 1.0);
-        vec3 proj = fragPosLightSpace.xyz / fragPosLightSpace.w;
-        proj = proj * 0.5 + 0.5;
-
-        // -----------------------------------------
-        // 4. Check if inside shadow map bounds
-        // -----------------------------------------
-        if (proj.z < 1.0)
-        {
-            // -------------------------------------
-            // 5. Bias (reduces shadow acne)
-            // -------------------------------------
-            //            vec3 normal = normalize(fragNormal);
-            //            float bias = max(0.05 * (1.0 - dot(normal, lightDir)), 0.005);
-            //            const float biasModifier = 0.5f;
-            //            if (cascade == directionalLight.cascadeCount)
-            //            {
-            //                bias *= 1 / (farPlane * biasModifier);
-            //            }
-            //            else
-            //            {
-            //                bias *= 1 / (directionalLight.cascadeSplits[cascade] * biasModifier);
-            //            }
-
-
-            // -------------------------------------
-            // 6. PCF Sampling
-            // -------------------------------------
-            ivec3 size = textureSize(directionalShadowMap, 0);
-            vec2 texelSize = 1.0 / vec2(size.xy);
-
-            float shadowSum = 0.0;
-            for (int x = -2; x <= 2; x++)
-            {
-                for (int y = -2; y <= 2; y++)
-                {
-                    float sampleDepth = texture(directionalShadowMap, vec3(proj.xy + vec2(x, y) * texelSize, cascade)).r;
-                    //                    shadowSum += (proj.z - bias) > sampleDepth ? 1.0 : 0.0;
-                    shadowSum += proj.z > sampleDepth ? 1.0 : 0.0;
-                }
-            }
-            shadow = shadowSum / 25.0;
-        }
-    }
-    // =================================================
-    // Final contribution from the directional light
-    // =================================================
     lighting += (diffuse + specular) * strength * (1.0 - shadow);
 
 
+#ifndef NO_POINT_LIGHTS
     // Point Lights
     for (int i = 0; i < pointLightCount; i++)
     {
@@ -260,7 +87,9 @@ void main()
 
         lighting += (diffuse + specular) * strength * attenuation;
     }
+#endif
 
+#ifndef NO_SPOT_LIGHTS
     // Spot Lights
     for (int i = 0; i < spotLightCount; i++)
     {
@@ -289,39 +118,15 @@ void main()
         vec3 diffuse = diff * color;
         vec3 specular = spec * color;
 
-        // Shadow
+#ifndef NO_SHADOWS
+        float shadow = SpotShadow(i, fragPos);
+#else
         float shadow = 0.0;
-
-        if (light.castShadows)
-        {
-            vec4 fragPosLightSpace = light.lightSpaceMatrix * vec4(fragPos, 1.0);
-
-            vec3 projCoords = fragPosLightSpace.xyz / fragPosLightSpace.w;
-            projCoords = projCoords * 0.5 + 0.5;
-
-            float currentDepth = projCoords.z;
-            float bias = 0.0003;
-
-            vec2 texelSize = 1.0 / textureSize(spotShadowMap[i], 0);
-
-            float shadowSum = 0.0;
-            for (int x = -2; x <= 2; ++x)
-            {
-                for (int y = -2; y <= 2; ++y)
-                {
-                    float pcfDepth = texture(spotShadowMap[i], projCoords.xy + vec2(x, y) * texelSize).r;
-                    shadowSum += currentDepth - bias > pcfDepth ? 1.0 : 0.0;
-                }
-            }
-            shadow = shadowSum / 25.0;
-
-            if (projCoords.z > 1.0)
-            shadow = 0.0;
-        }
-
+#endif
 
         lighting += (diffuse + specular) * strength * intensity * attenuation * (1.0 - shadow);
     }
+#endif
 
     // this is a hack to make sure the light will always be visible (even if it should realistically be absorbed by the object)
     vec3 endColor = fragColor;
@@ -351,4 +156,4 @@ void main()
     // poor mans raycasting
     // put uniqueColor into a range of 0-1
     PickColor = vec4(uniqueColor, 1.0);
-}
\ No newline at end of file
+}
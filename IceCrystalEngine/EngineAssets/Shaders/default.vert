@@ -7,17 +7,7 @@ out vec2 fragUV;
 out vec3 fragNormal;
 out vec3 fragPos;
 
-layout(std140, binding = 0) uniform GlobalData
-{
-	mat4 view;
-	mat4 projection;
-	vec3 viewPos;
-	float time;
-	float nearPlane;
-	float farPlane;
-	float gd_padding0;
-	float gd_padding1;
-};
+#include "Include/GlobalData.glsl"
 
 uniform mat4 model;
 uniform mat3 normalModel;
@@ -4,17 +4,7 @@ layout (location = 1) in vec3 aColor;
 
 out vec3 fragColor;
 
-layout(std140, binding = 0) uniform GlobalData
-{
-    mat4 view;
-    mat4 projection;
-    vec3 viewPos;
-    float time;
-    float nearPlane;
-    float farPlane;
-    float gd_padding0;
-    float gd_padding1;
-};
+#include "Include/GlobalData.glsl"
 
 void main()
 {
@@ -5,9 +5,12 @@
 
 #include <Ice/Core/Component.h>
 #include <AL/al.h>
+#include <glm/glm.hpp>
 #include <string>
+#include <memory>
 
 class AudioClip;
+class AudioStream;
 
 class AudioSource : public Component
 {
@@ -59,20 +62,53 @@ public:
     void SetPlaybackTime(float seconds);
     float GetPlaybackTime() const;
 
+    // When there are more playing sources than voices the higher priority ones get them first, then the louder ones
+    void SetPriority(int priority) { this->priority = glm::clamp(priority, 0, 255); }
+    int GetPriority() const { return priority; }
+
+    // Virtual: playing, but without an OpenAL voice right now (too quiet / too far / outranked). The playback time
+    // keeps advancing and it picks up from there when AudioManager gives it a voice back.
+    bool IsVirtual() const { return state == State::Playing && source == 0; }
+
+    // Voice management, called by AudioManager
+    void AssignVoice(ALuint voice);
+    ALuint TakeVoice();
+    void AdvanceVirtualTime(float deltaTime);
+    bool HasVoiceFinished() const;
+    float GetAudibility(const glm::vec3& listener) const;
+    ALuint GetVoice() const { return source; }
+    int activeIndex = -1; // index in AudioManager's playing list
+
 private:
-    ALuint source;
+    enum class State : uint8_t
+    {
+        Stopped,
+        Playing,
+        Paused
+    };
+
+    ALuint source; // the voice from AudioManager's pool, 0 while virtual / not playing
     AudioClip* clip;
+    std::unique_ptr<AudioStream> stream; // only while playing a streaming clip
 
     float volume;
     float pitch;
     bool looping;
     bool playOnReady;
+    bool playWhenLoaded; // Play was called while the clip was still decoding (AudioManager::LoadClipAsync)
+
+    State state;
+    float virtualTime; // playback position while there is no voice
+    int priority;
 
     bool spatial;
     float minDistance;
     float maxDistance;
 
     void UpdatePosition();
+    void ReleaseStream();
+    void ApplyProperties();
+    void ReleaseVoice();
 };
 
 #endif
\ No newline at end of file
@@ -16,11 +16,20 @@ public:
     virtual ~LuaExecutor();
 
     bool runOnReady = true;
+    // Runs in one of the ParallelLuaManager worker states instead of the main one (Scene / Commands API only)
+    bool parallel = false;
     std::string filePath;
 
     void Execute();
+    // Stops the running script and runs the file again (called automatically when the file changes)
+    void Reload();
 
     void Ready() override;
+
+private:
+    int reloadWatchId = 0;
+    std::string watchedPath;
+    void WatchFile();
 };
 
 #endif
\ No newline at end of file
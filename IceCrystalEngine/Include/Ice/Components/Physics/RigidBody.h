@@ -22,10 +22,16 @@ public:
     virtual ~RigidBody();
 
     void Ready() override;    // Called when actor/component is initialized
-    void Update() override;   // Called every frame
+    void Update() override;   // Only ticked while the engine is paused, PhysicsManager handles everything else
 
     float mass;
     bool isTrigger = false;
+
+    // How the transform follows the body between physics steps
+    // None: snaps to the latest step, Interpolate: blends the last two steps (one step behind, always smooth),
+    // Extrapolate: predicts from the latest step with the velocity (no lag, can overshoot on impacts)
+    enum class Interpolation { None, Interpolate, Extrapolate };
+    Interpolation interpolation = Interpolation::Interpolate;
     
     Collider* collider;
 
@@ -42,6 +48,10 @@ public:
     std::function<void(RigidBody*)> OnTriggerStay;
     std::function<void(RigidBody*)> OnTriggerExited;
 
+    // OnContacting / OnTriggerStay fire after the physics steps the body was awake in, at most once per this many seconds
+    // (0 = every step). A sleeping body doesnt get them at all.
+    float stayCallbackInterval = 0.0f;
+
     //----------------------------------
     // Forces
     //----------------------------------
@@ -69,6 +79,13 @@ public:
     bool IsKinematic() const;
     bool IsStatic() const {return isStatic;};
 
+    //----------------------------------
+    // Layers
+    //----------------------------------
+    // PhysicsLayer::Auto picks Static / Dynamic / Trigger from the body settings
+    void SetLayer(JPH::ObjectLayer newLayer);
+    JPH::ObjectLayer GetLayer() const { return ResolveLayer(); }
+
     //----------------------------------
     // Body Access
     //----------------------------------
@@ -83,12 +100,50 @@ public:
     void FireTriggerEntered(RigidBody* other);
     void FireTriggerStay(RigidBody* other);
     void FireTriggerExited(RigidBody* other);
+    // The other body is being destroyed, drop it without firing anything
+    void ForgetContact(RigidBody* other);
+
+    // Called after every physics step the body was active in
+    void CapturePose(uint64_t step);
+    uint64_t GetCapturedStep() const { return capturedStep; }
+    // Makes both poses the body's current one, for teleports so it doesnt blend across the jump
+    void ResetPose();
+    // Everything CapturePose keeps, so a throwaway resimulation (the rollback benchmark) can be undone
+    struct PoseState
+    {
+        glm::vec3 previousPosition;
+        glm::quat previousRotation;
+        glm::vec3 currentPosition;
+        glm::quat currentRotation;
+        glm::vec3 currentLinearVelocity;
+        glm::vec3 currentAngularVelocity;
+        uint64_t capturedStep;
+    };
+    PoseState SavePose() const;
+    void RestorePose(const PoseState& pose);
+    // Writes the pose for this frame into the transform
+    void SyncTransform(float alpha, float stepDeltaTime);
+    // Fires OnContacting / OnTriggerStay, called by PhysicsManager after a step the body was awake in
+    void DispatchStayCallbacks(float deltaTime);
 
 private:
     JPH::Body* body = nullptr;
     bool isStatic = false;
+    JPH::ObjectLayer layer = PhysicsLayer::Auto;
+    JPH::ObjectLayer ResolveLayer() const;
+
+    // Pose after the previous and the latest physics step
+    glm::vec3 previousPosition = glm::vec3(0.0f);
+    glm::quat previousRotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+    glm::vec3 currentPosition = glm::vec3(0.0f);
+    glm::quat currentRotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+    glm::vec3 currentLinearVelocity = glm::vec3(0.0f);
+    glm::vec3 currentAngularVelocity = glm::vec3(0.0f);
+    uint64_t capturedStep = 0;
 
     // Track active contacts for OnContacting
     std::set<RigidBody*> activeContacts;
     std::set<RigidBody*> activeTriggers;
+    float stayTimer = 0.0f;
+    std::vector<RigidBody*> stayScratch; // copy of the set being dispatched, callbacks can change it
 };
@@ -11,6 +11,8 @@
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include <future>
+
 #include <Ice/Core/Component.h>
 
 class Renderer : public Component
@@ -32,14 +34,21 @@ class Renderer : public Component
 	std::string ModelPath;
 
 
-	static constexpr uint32_t CACHE_VERSION = 2;
+	// Bump when the cooked mesh layout (or the OBJ import) changes
+	static constexpr uint32_t MESH_COOKER_VERSION = 3;
 
-	std::string GetCachePath();
-	bool IsCacheValid();
-	bool LoadFromCache();
-	void SaveToCache();
-	bool LoadFromOBJ();
+	// Loads cooked meshes from the DerivedDataCache, cooking them from the OBJ on a miss (safe to call off the main thread)
+	bool LoadMeshes(std::vector<MeshHolder>& outMeshes);
+	bool LoadFromOBJ(std::vector<MeshHolder>& outMeshes);
 	void CreateGLBuffers();
+	void DeleteGLBuffers();
+
+	// Hot reload
+	int reloadWatchId = 0;
+	std::future<bool> pendingReload;
+	std::vector<MeshHolder> reloadedMeshes; // only touched by the reload thread until pendingReload is ready
+	bool reloadQueued = false;
+	void FinishReload();
 
 public:
 	
@@ -57,6 +66,9 @@ public:
 	
 	void Update() override;
 	void UpdateShadows();
+
+	// Re-cooks the model in the background (called automatically when the OBJ changes)
+	void Reload();
 };
 
 #endif
\ No newline at end of file
@@ -6,6 +6,7 @@
 
 #include <vector>
 #include <string>
+#include <typeindex>
 
 #include <Ice/Managers/WindowManager.h>
 #include <Ice/Managers/LightingManager.h>
@@ -33,20 +34,17 @@ public:
 	Actor(std::string name, std::string tag);
 	~Actor();
 
+	// Use these instead of writing name / tag directly so the SceneManager lookups stay correct
+	void SetName(const std::string& newName);
+	void SetTag(const std::string& newTag);
+
 	// You have to do template stuff in the header file or else it wont compile
 
 	// Has Component
 	template <typename T>
 	bool HasComponent()
 	{
-		for (int i = 0; i < components->size(); i++)
-		{
-			if (dynamic_cast<T*>(components->at(i)) != nullptr)
-			{
-				return true;
-			}
-		}
-		return false;
+		return GetComponent<T>() != nullptr;
 	}
 	
 
@@ -60,6 +58,7 @@ public:
 		newComponent->transform = transform;
 		newComponent->Ready();
 		components->push_back(newComponent);
+		componentCache.clear();
 		return newComponent;
 	}
 	
@@ -67,14 +66,23 @@ public:
 	template <typename T>
 	T* GetComponent()
 	{
+		// Scripts ask for the same few types every frame, remember the answer (misses too) until the components change
+		std::type_index type(typeid(T));
+		for (const auto& [cachedType, cached] : componentCache)
+		{
+			if (cachedType == type)
+				return static_cast<T*>(cached);
+		}
+
+		T* found = nullptr;
 		for (Component* component : *components)
 		{
-			if (dynamic_cast<T*>(component) != nullptr)
-			{
-				return dynamic_cast<T*>(component);
-			}
+			found = dynamic_cast<T*>(component);
+			if (found != nullptr)
+				break;
 		}
-		return nullptr;
+		componentCache.push_back({ type, found });
+		return found;
 	}
 
 	
@@ -87,6 +95,10 @@ public:
 	// Add Component by Pointer
 	void AddComponent(Component* component);
 
+private:
+	// type -> first component of that type (or nullptr), filled in by GetComponent
+	std::vector<std::pair<std::type_index, Component*>> componentCache;
+
 };
 
 #endif
\ No newline at end of file
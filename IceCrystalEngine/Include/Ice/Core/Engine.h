@@ -31,7 +31,8 @@ private:
     IGame* game = nullptr;
     float lastFrameTime = 0.0f;
     float physicsAccumulator = 0.0f;
-    const float fixedDeltaTime = 1.0f / 60.0f; // 60 hz physics
+    // Physics rate, rigid bodies are interpolated between steps so this can go down to 30 hz on big scenes without judder
+    float fixedDeltaTime = 1.0f / 60.0f; // 60 hz physics
     // Will be false if hooked onto from a game
     bool isEditor = true;
 };
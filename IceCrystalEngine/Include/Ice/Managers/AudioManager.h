@@ -9,16 +9,30 @@
 #include <string>
 #include <unordered_map>
 #include <memory>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <future>
+#include <deque>
+#include <condition_variable>
 
 #include "Ice/Resources/AudioClip.h"
 
 #pragma comment(lib, "OpenAL32.lib")
 
+class AudioStream;
+class AudioSource;
+
 class AudioManager
 {
 public:
     static AudioManager& GetInstance();
 
+    // Real OpenAL voices shared by every AudioSource and one shot (clamped to what the device can mix). Set before Initialize.
+    // Anything playing past this many is virtual: it keeps its playback position but isnt mixed until it ranks high enough again.
+    int maxVoices = 32;
+
     bool Initialize();
     void Shutdown();
 
@@ -34,13 +48,41 @@ public:
     float GetMasterVolume() const { return masterVolume; }
 
     // Clip management
-    AudioClip* LoadClip(const std::string& name, const std::string& path);
+    AudioClip* LoadClip(const std::string& name, const std::string& path, bool streaming = false);
+    // Decodes on the decode threads (a small pool, so a batch of sound effects decodes in parallel without a thread per clip).
+    // The clip is returned right away, Update uploads it once it is decoded, it stays !IsLoaded() if that fails.
+    AudioClip* LoadClipAsync(const std::string& name, const std::string& path);
+    // Blocks until every LoadClipAsync clip is decoded and uploaded
+    void FinishLoading();
+    bool IsLoading() const { return !pendingClips.empty(); }
     AudioClip* GetClip(const std::string& name);
     void UnloadClip(const std::string& name);
     void UnloadAllClips();
 
-    // One shot sounds without needing an audiosource
-    void PlayOneShot(const std::string& name, const glm::vec3& position, float volume = 1.0f, float pitch = 1.0f);
+    // One shot sounds without needing an audiosource, they compete for voices like AudioSources do
+    void PlayOneShot(const std::string& name, const glm::vec3& position, float volume = 1.0f, float pitch = 1.0f, int priority = 128);
+
+    // Voice management, AudioSource calls these as it starts / stops playing
+    void OnSourcePlay(AudioSource* source);
+    void OnSourceStop(AudioSource* source);
+    void ReturnVoice(ALuint voice);
+    const glm::vec3& GetListenerPosition() const { return listenerPosition; }
+
+    // Gain the linear clamped distance model gives at position, 0 past maxDistance
+    static float GetAudibility(const glm::vec3& position, const glm::vec3& listener, float volume, float minDistance, float maxDistance);
+
+    // Stats
+    int GetVoiceCount() const { return static_cast<int>(voices.size()); }
+    int GetRealVoiceCount() const { return static_cast<int>(voices.size() - freeVoices.size()); }
+    int GetVirtualVoiceCount() const { return static_cast<int>(playingSources.size() + oneShots.size()) - GetRealVoiceCount(); }
+    float GetLastVoiceUpdateMs() const { return lastVoiceUpdateMs; }
+
+    // Streams are refilled on the streaming thread while registered here, RemoveStream waits for it to be done with the stream
+    void AddStream(AudioStream* stream);
+    void RemoveStream(AudioStream* stream);
+
+    // Decodes path iterations times and logs how much faster than realtime it was
+    void BenchmarkDecoder(const std::string& path, int iterations = 5);
 
     bool IsInitialized() const { return initialized; }
 private:
@@ -56,12 +98,76 @@ private:
 
     std::unordered_map<std::string, std::unique_ptr<AudioClip>> clips;
 
-    // One-shot source pool
-    static const int MAX_ONESHOT_SOURCES = 32;
-    ALuint oneShotSources[MAX_ONESHOT_SOURCES];
-    int nextOneShotSource;
-
-    ALuint GetAvailableOneShotSource();
+    struct PendingClip
+    {
+        std::string name;
+        AudioClip* clip;
+        std::future<bool> decoded;
+    };
+    std::vector<PendingClip> pendingClips;
+
+    void UploadPendingClips(bool wait);
+
+    // Decode threads, started by the first LoadClipAsync. Not the physics job system, a long decode there would hold up a step.
+    static constexpr int MAX_DECODE_THREADS = 2;
+    std::vector<std::thread> decodeThreads;
+    std::deque<std::packaged_task<bool()>> decodeQueue;
+    std::mutex decodeMutex;
+    std::condition_variable decodeReady;
+    bool decodeThreadsRunning = false;
+
+    void DecodeLoop();
+    // Finishes whatever is queued, then joins the threads
+    void StopDecodeThreads();
+
+    // Voices
+    static constexpr float MIN_AUDIBILITY = 0.001f; // quieter than this is never worth a voice
+    static constexpr float VOICE_HYSTERESIS = 1.25f; // a voice that is already real gets this much louder in the ranking so two similar sounds dont keep swapping
+    static constexpr float ONESHOT_MIN_DISTANCE = 1.0f;
+    static constexpr float ONESHOT_MAX_DISTANCE = 100.0f;
+
+    struct OneShot
+    {
+        AudioClip* clip;
+        glm::vec3 position;
+        float volume;
+        float pitch;
+        int priority;
+        float time;   // playback position while virtual
+        ALuint voice; // 0 while virtual
+    };
+
+    struct VoiceCandidate
+    {
+        int index; // into playingSources or oneShots
+        bool oneShot;
+        bool audible;
+        int priority;
+        float score;
+    };
+
+    std::vector<ALuint> voices; // the whole pool
+    std::vector<ALuint> freeVoices;
+    std::vector<AudioSource*> playingSources; // AudioSources that are playing, real or virtual
+    std::vector<OneShot> oneShots;
+    std::vector<VoiceCandidate> candidates; // reused every update
+    glm::vec3 listenerPosition;
+    float lastVoiceUpdateMs;
+
+    // Ranks everything playing and moves the voices to the top maxVoices, once per frame
+    void UpdateVoices(float deltaTime);
+    void RealizeOneShot(OneShot& shot, ALuint voice);
+    void VirtualizeOneShot(OneShot& shot);
+    // Stops the one shots playing clip (nullptr for all of them)
+    void StopOneShots(AudioClip* clip);
+
+    // Streaming thread
+    std::vector<AudioStream*> streams;
+    std::mutex streamMutex;
+    std::thread streamThread;
+    std::atomic<bool> streamThreadRunning{false};
+
+    void StreamLoop();
 };
 
 #endif
\ No newline at end of file
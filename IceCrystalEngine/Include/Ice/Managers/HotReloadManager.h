@@ -0,0 +1,94 @@
+#pragma once
+
+#ifndef HOT_RELOAD_MANAGER_H
+#define HOT_RELOAD_MANAGER_H
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+
+// Watches the asset directories for changes and tells whoever loaded a file that it changed.
+// Detection runs on a background thread (inotify on Linux, polling file times everywhere else),
+// callbacks are always fired from Update() on the main thread, so they are free to touch GL / Lua.
+class HotReloadManager
+{
+public:
+    static HotReloadManager& GetInstance()
+    {
+        static HotReloadManager instance; // Static local variable ensures a single instance
+        return instance;
+    }
+
+    // Set before Start() to turn hot reloading off entirely
+    bool enabled = true;
+    // How often the polling backend rescans the directories (seconds)
+    float pollInterval = 0.5f;
+    // A file has to stop changing for this long before it is reloaded, editors tend to write a file in several steps (seconds)
+    float settleTime = 0.15f;
+
+    // Starts watching {ASSET_DIR}, {ENGINE_ASSET_DIR} and anything added with AddRoot
+    void Start();
+    void Stop();
+    bool IsRunning() const { return running; }
+
+    // Watch another directory (recursively), must be called before Start()
+    void AddRoot(const std::string& directory);
+
+    // Calls onChanged (on the main thread) whenever the file at path changes, returns an id for Unwatch
+    int Watch(const std::string& path, std::function<void()> onChanged);
+    void Unwatch(int id);
+
+    // False once the instance has been destroyed at exit, assets that outlive it check this before Unwatch
+    static bool IsAlive() { return alive; }
+
+    // Fires callbacks for files that changed since the last call, call once per frame from the main thread
+    void Update();
+
+    // Stats
+    int GetReloadCount() const { return reloadCount; }
+
+private:
+    struct Listener
+    {
+        std::string path;
+        std::function<void()> callback;
+    };
+
+    // Main thread only
+    std::unordered_map<int, Listener> listeners;
+    int nextListenerId = 1;
+    std::unordered_map<std::string, std::chrono::steady_clock::time_point> pendingChanges; // path -> last time it changed
+    int reloadCount = 0;
+
+    std::vector<std::string> roots;
+
+    // Shared with the watcher thread
+    std::thread watcherThread;
+    std::atomic<bool> running = false;
+    std::mutex changedMutex;
+    std::vector<std::string> changedPaths;
+
+    void ReportChange(const std::string& path);
+
+    void WatchLoop();
+    void PollLoop();
+#ifdef __linux__
+    void InotifyLoop();
+#endif
+
+    // Constant initialized, so it is still readable after the instance is gone
+    static inline bool alive = false;
+
+    HotReloadManager() { alive = true; }
+    ~HotReloadManager() { Stop(); alive = false; }
+
+    HotReloadManager(HotReloadManager const&) = delete; // Delete copy constructor
+    void operator=(HotReloadManager const&) = delete; // Delete assignment operator
+};
+
+#endif
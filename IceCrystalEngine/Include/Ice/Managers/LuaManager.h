@@ -6,8 +6,13 @@
 #include <sol/sol.hpp>
 #include <lua/lua.hpp>
 #include <thread>
+#include <queue>
 
 #include "Ice/Components/LuaExecutor.h"
+#include <Ice/Utils/VirtualFileSystem.h>
+#include <Ice/Utils/LuaProfiler.h>
+#include <Ice/Utils/LuaAllocator.h>
+#include <Ice/Utils/LuaChunkCache.h>
 
 #pragma comment(lib, "lua54.lib")
 
@@ -21,15 +26,32 @@ static std::unordered_map<std::string, ComponentRegistryEntry> componentRegistry
 
 class LuaManager
 {
+	// Declared before lua so it is made before the state and destroyed after it
+	LuaAllocator allocator;
+
 public:
 	sol::state lua;
+	// Every LuaExecutor running the same file shares one compiled function (declared after lua so it goes first)
+	LuaChunkCache chunkCache;
+
+	// Incremental: the collector only runs from StepGarbageCollector, gcBudgetMs per frame
+	// Generational: Lua runs its own (short) minor collections whenever it wants
+	enum class GCMode { Incremental, Generational };
+
+	float gcBudgetMs = 0.5f; // time the incremental collector gets each frame
+	int gcStepKB = 8; // work done per step, the budget is checked between steps
 
+	// A running script. Tasks live in slots that get reused, a slot's generation goes up every time it is freed
+	// so stale handles (in the timer heap, event lists...) can be spotted and skipped without searching for them
 	struct LuaTask
 	{
 		sol::thread thread;
 		sol::environment env;
 		sol::coroutine co;
-		double wakeTime;
+		LuaExecutor* executor = nullptr; // the executor that started this task
+		uint32_t generation = 0;
+		bool alive = false;
+		std::vector<sol::object> resumeArgs; // handed back to the script when it resumes (fire_event arguments)
 	};
 	std::vector<LuaTask> tasks;
 
@@ -39,34 +61,33 @@ public:
 		return instance;
 	}
 
+	// Resumes every task whose wait is over, the cost only depends on how many tasks wake up (sleeping ones are never looked at)
 	void Update(double now);
 
 	// Run a LuaExecutor
-	void RunExecutor(LuaExecutor* executor)
-	{
-		auto& manager = LuaManager::GetInstance();
-		auto& lua = manager.lua;
-
-		sol::thread thread = sol::thread::create(lua);
-		sol::state_view thread_lua = thread.state();
-		
-		sol::function f = thread_lua.load_file(executor->filePath);
-
-		sol::environment env(thread_lua, sol::create, lua.globals());
-		env["actor"] = executor->owner;
-		env["transform"] = executor->transform;
-		
-		sol::set_environment(env, f);
-		
-		sol::coroutine co(thread_lua, f);
-
-		LuaTask task;
-		task.thread = thread;
-		task.env = std::move(env);
-		task.co = std::move(co);
-		task.wakeTime = 0.0;
-		tasks.push_back(std::move(task));
-	}
+	void RunExecutor(LuaExecutor* executor);
+
+	// Kill any tasks started by a LuaExecutor (used when its script gets hot reloaded)
+	void StopExecutor(LuaExecutor* executor);
+
+	// Wakes every task sitting in wait_event(name), they get args back from wait_event on the next Update
+	void FireEvent(const std::string& name, const std::vector<sol::object>& args = {});
+
+	// Call once per frame after all Lua for the frame has run
+	void StepGarbageCollector();
+	void SetGCMode(GCMode mode);
+	GCMode GetGCMode() const { return gcMode; }
+
+	// The script whose code is running right now (nullptr outside of scripts)
+	LuaExecutor* GetCurrentExecutor() const { return currentExecutor; }
+	void SetCurrentExecutor(LuaExecutor* executor) { currentExecutor = executor; }
+
+	// Stats
+	int GetTaskCount() const { return liveTaskCount; }
+	const LuaAllocator& GetAllocator() const { return allocator; }
+	float GetLastGCStepMs() const { return lastGCStepMs; }
+	int GetGCCycles() const { return gcCycles; }
+	int GetResumedLastFrame() const { return resumedLastFrame; }
 
 	template<typename T>
 	void RegisterComponent(const std::string& name, sol::state_view lua) {
@@ -89,22 +110,69 @@ public:
 		};
 	}
 
-	void Cleanup()
-	{
-		tasks.clear();
-		tasks.shrink_to_fit();
-
-		componentRegistry.clear();
-
-		lua.collect_garbage();
-		lua.collect_garbage();
-	}
+	void Cleanup();
 
 private:
 	void RegisterBindings(); // Bind C++ classes and functions to Lua
 	void RegisterInputBindings();
 
+	// What the running task asked to wait for, set by wait() / wait_frames() / wait_event() right before they yield
+	enum class WaitType { NextFrame, Time, Frames, Event };
+	struct PendingWait
+	{
+		WaitType type = WaitType::NextFrame;
+		double seconds = 0.0;
+		uint64_t frames = 0;
+		std::string event;
+	};
+	PendingWait pendingWait;
+
+	struct TaskHandle
+	{
+		uint32_t slot;
+		uint32_t generation;
+	};
+	struct TimerEntry
+	{
+		double wakeTime;
+		TaskHandle handle;
+		bool operator>(const TimerEntry& other) const { return wakeTime > other.wakeTime; }
+	};
+	struct FrameEntry
+	{
+		uint64_t frame;
+		TaskHandle handle;
+		bool operator>(const FrameEntry& other) const { return frame > other.frame; }
+	};
+
+	// Min heaps, the soonest wake up is always on top
+	std::priority_queue<TimerEntry, std::vector<TimerEntry>, std::greater<TimerEntry>> timerHeap;
+	std::priority_queue<FrameEntry, std::vector<FrameEntry>, std::greater<FrameEntry>> frameHeap;
+	std::unordered_map<std::string, std::vector<TaskHandle>> eventWaiters;
+	std::vector<TaskHandle> readyQueue; // resumed on the next Update
+	std::vector<TaskHandle> resumeQueue; // the ones being resumed this Update, kept around to reuse its memory
+	std::vector<uint32_t> freeTaskSlots;
+
+	uint64_t frameCount = 0;
+	LuaExecutor* currentExecutor = nullptr;
+
+	GCMode gcMode = GCMode::Incremental;
+	int liveHeapKB = 0; // what survived the last full cycle
+	int gcCycles = 0;
+	float lastGCStepMs = 0.0f;
+	int liveTaskCount = 0;
+	int resumedLastFrame = 0;
+
+	TaskHandle AllocateTask();
+	void FreeTask(uint32_t slot);
+	bool IsTaskValid(TaskHandle handle) const;
+	void ResumeTask(TaskHandle handle, double now);
+	void ScheduleTask(TaskHandle handle, double now);
+	void ClearTasks();
+
 	static int LuaWait(lua_State* L);
+	static int LuaWaitFrames(lua_State* L);
+	static int LuaWaitEvent(lua_State* L);
 	static int LuaPrint(lua_State* L);
 
 	LuaManager();
@@ -113,6 +181,10 @@ private:
 	void operator=(LuaManager const&) = delete; // Delete assignment operator
 };
 
+// Calls Lua callbacks connected to the engine's frame events.
+// All callbacks for an event run in one batch through the main state with a shared error handler, grouped by the
+// script that connected them. A callback that errors only affects itself (and gets disconnected if it keeps failing),
+// one that keeps going over callbackBudgetMs gets throttled so a single script cant blow up the frame time.
 class RunService
 {
 public:
@@ -122,19 +194,75 @@ public:
 		return instance;
 	}
 
+	enum class Event { Update, FixedUpdate, LateUpdate, Count };
+
+	// Returned by the Connect functions, Lua gets it from RunService.Update(fn) etc.
+	struct Connection
+	{
+		Event event = Event::Update;
+		uint32_t id = 0;
+
+		void Disconnect();
+		bool IsConnected() const;
+	};
+
+	float callbackBudgetMs = 4.0f; // a callback taking longer than this counts as an overrun
+	int overrunsBeforeThrottle = 3; // overruns in a row before the callback gets throttled
+	int throttleFrames = 4; // a throttled callback skips this many events between runs
+	int maxConsecutiveErrors = 5; // errors in a row before the callback is disconnected
+
 	void FireUpdate(float deltaTime);
 	void FireFixedUpdate(float fixedDeltaTime);
 	void FireLateUpdate(float deltaTime);
 
-	void ConnectUpdate(sol::function callback);
-	void ConnectFixedUpdate(sol::function callback);
-	void ConnectLateUpdate(sol::function callback);
+	Connection ConnectUpdate(sol::function callback);
+	Connection ConnectFixedUpdate(sol::function callback);
+	Connection ConnectLateUpdate(sol::function callback);
+	Connection Connect(Event event, sol::function callback);
+
+	void Disconnect(const Connection& connection);
+	bool IsConnected(const Connection& connection) const;
+	// Drops every callback connected by a script (its actor died or it got reloaded)
+	void DisconnectExecutor(LuaExecutor* executor);
+	void Clear();
+
+	int GetCallbackCount() const;
+
 private:
 	RunService() = default;
 
-	std::vector<sol::function> updateCallbacks;
-	std::vector<sol::function> fixedUpdateCallbacks;
-	std::vector<sol::function> lateUpdateCallbacks;
+	struct Callback
+	{
+		int ref = LUA_NOREF; // the function, in the registry
+		uint32_t id = 0;
+		LuaExecutor* executor = nullptr; // the script that connected it
+		// Where the callback was defined, for the profiler and error messages
+		std::string script;
+		std::string name;
+
+		bool connected = true;
+		int skipCount = 0; // events left to skip while throttled
+		int overrunStreak = 0;
+		int errorStreak = 0;
+		uint64_t overruns = 0;
+	};
+
+	static constexpr size_t eventCount = static_cast<size_t>(Event::Count);
+
+	std::vector<Callback> callbacks[eventCount];
+	// Connected since the last Fire, merged in before the next one so firing never has to deal with the list growing
+	std::vector<Callback> pendingCallbacks[eventCount];
+	bool needsCompact[eventCount] = {};
+	int firingDepth = 0;
+	uint32_t nextId = 1;
+
+	void Fire(Event event, float deltaTime);
+	void MergePending(Event event);
+	void Compact(Event event);
+	void TrackBudget(Callback& callback, double ms);
+
+	static const char* EventName(Event event);
+	static int ErrorHandler(lua_State* L);
 };
 
 #endif
@@ -0,0 +1,226 @@
+#pragma once
+
+#ifndef PARALLEL_LUA_MANAGER_H
+#define PARALLEL_LUA_MANAGER_H
+
+#include <sol/sol.hpp>
+#include <lua/lua.hpp>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <memory>
+#include <algorithm>
+#include <unordered_set>
+
+#include <Ice/Utils/LuaAllocator.h>
+#include <Ice/Utils/LuaChunkCache.h>
+
+class Actor;
+class LuaExecutor;
+
+// Read only copy of the scene taken once per frame on the main thread, worker scripts query this instead of the live actors
+struct ActorSnapshot
+{
+    Actor* actor;
+    std::string name;
+    std::string tag;
+    glm::vec3 position;
+    glm::quat rotation;
+    glm::vec3 eulerAngles;
+    glm::vec3 scale;
+    glm::vec3 forward;
+    glm::vec3 right;
+    glm::vec3 up;
+    bool hasRigidBody;
+    glm::vec3 linearVelocity;
+    glm::vec3 angularVelocity;
+};
+
+struct SceneSnapshot
+{
+    std::vector<ActorSnapshot> actors;
+    std::unordered_map<Actor*, size_t> lookup; // actor -> index into actors
+    std::unordered_map<std::string, std::vector<Actor*>> byTag;
+    double time = 0.0;
+
+    const ActorSnapshot* Find(Actor* actor) const
+    {
+        auto it = lookup.find(actor);
+        return it != lookup.end() ? &actors[it->second] : nullptr;
+    }
+};
+
+// A deferred write from a worker script, applied on the main thread at the sync point
+struct LuaCommand
+{
+    enum class Type : uint8_t
+    {
+        SetPosition,
+        Translate,
+        SetRotation,
+        Rotate,
+        SetScale,
+        LookAt,
+        AddForce,
+        AddTorque,
+        AddImpulse,
+        SetLinearVelocity,
+        SetAngularVelocity
+    };
+
+    Type type;
+    Actor* actor;
+    glm::vec3 value;
+};
+
+// One independent Lua state, owned by one worker thread while it ticks. Scripts in here dont see the engine
+// bindings, only the snapshot (reads) and the command buffer (writes).
+class LuaWorkerVM
+{
+public:
+    LuaWorkerVM(int index, const SceneSnapshot& snapshot);
+
+    // Main thread only, while the VM isnt ticking
+    void LoadScript(LuaExecutor* executor, Actor* actor, const std::string& path, const std::string& source);
+    void RemoveScript(LuaExecutor* executor);
+    int GetScriptCount() const { return static_cast<int>(scripts.size()); }
+
+    // Runs every script's Parallel.Update callbacks, called on the worker thread
+    void Tick(float deltaTime);
+
+    // Filled in by Tick, drained by the main thread at the sync point
+    std::vector<LuaCommand> commands;
+    std::vector<std::string> log;
+    std::vector<std::string> events;
+
+    float lastTickMs = 0.0f;
+    float gcBudgetMs = 0.25f;
+
+private:
+    struct Script
+    {
+        LuaExecutor* executor;
+        Actor* actor;
+        std::string path;
+        sol::environment env;
+        std::vector<sol::protected_function> updateCallbacks;
+    };
+
+    int index;
+    const SceneSnapshot& snapshot;
+
+    // Declared before lua so it is made before the state and destroyed after it
+    LuaAllocator allocator;
+    sol::state lua;
+    LuaChunkCache chunkCache;
+
+    std::vector<Script> scripts;
+    Script* loadingScript = nullptr; // the script whose chunk is running, Parallel.Update attaches to it
+
+    int liveHeapKB = 0;
+
+    void RegisterBindings();
+    void StepGarbageCollector();
+
+    // Raw lua_CFunctions, the VM is found through the state's extra space so no closures / userdata are needed
+    static LuaWorkerVM& GetVM(lua_State* L);
+    static const ActorSnapshot* CheckActor(lua_State* L, int arg);
+    template <glm::vec3 ActorSnapshot::*Field>
+    static int LuaGetVec3(lua_State* L);
+    template <LuaCommand::Type Type>
+    static int LuaPushCommand(lua_State* L);
+    static int LuaGetRotation(lua_State* L);
+    static int LuaGetName(lua_State* L);
+    static int LuaGetTag(lua_State* L);
+    static int LuaExists(lua_State* L);
+    static int LuaFindByTag(lua_State* L);
+    static int LuaFindAllByTag(lua_State* L);
+    static int LuaFindNearestByTag(lua_State* L);
+    static int LuaGetTime(lua_State* L);
+    static int LuaUpdate(lua_State* L);
+    static int LuaFireEvent(lua_State* L);
+    static int LuaPrint(lua_State* L);
+};
+
+// Opt in parallel scripting. A LuaExecutor with parallel = true isnt run in the main LuaManager state,
+// it is assigned to one of workerCount independent Lua states that tick on worker threads.
+// Each frame:
+//   BeginFrame: (main thread) apply script adds / removes, take the scene snapshot, wake the workers
+//   ... workers run while the main thread does its own work ...
+//   EndFrame: (main thread, the sync point) wait for the workers, apply their command buffers in VM order
+class ParallelLuaManager
+{
+public:
+    static ParallelLuaManager& GetInstance()
+    {
+        static ParallelLuaManager instance; // Static local variable ensures a single instance
+        return instance;
+    }
+
+    // Number of worker states/threads, 0 runs the single worker state inline on the main thread. Set before the first parallel script.
+    int workerCount = std::max(1, std::min(4, static_cast<int>(std::thread::hardware_concurrency()) - 1));
+
+    // Queued, they take effect at the next BeginFrame (the workers might be running right now)
+    void AddScript(LuaExecutor* executor);
+    void RemoveScript(LuaExecutor* executor);
+
+    void BeginFrame(float deltaTime);
+    void EndFrame();
+
+    // Stops the worker threads and drops every state
+    void Shutdown();
+
+    // Stats
+    int GetScriptCount() const;
+    float GetLastWorkerMs(int worker) const;
+    int GetLastCommandCount() const { return lastCommandCount; }
+
+private:
+    struct PendingAdd
+    {
+        LuaExecutor* executor;
+        Actor* actor;
+        std::string path;
+        std::string source;
+    };
+
+    SceneSnapshot snapshot;
+    std::vector<std::unique_ptr<LuaWorkerVM>> vms;
+    std::unordered_map<LuaExecutor*, LuaWorkerVM*> assignments;
+    std::vector<PendingAdd> pendingAdds;
+    std::vector<LuaExecutor*> pendingRemoves;
+
+    // Worker threads
+    std::vector<std::thread> threads;
+    std::mutex mutex;
+    std::condition_variable wakeWorkers;
+    std::condition_variable workersDone;
+    uint64_t frameIndex = 0;
+    int workersRunning = 0;
+    float frameDeltaTime = 0.0f;
+    bool stopping = false;
+    bool frameInFlight = false;
+
+    int lastCommandCount = 0;
+
+    void EnsureStarted();
+    void ApplyPending();
+    void TakeSnapshot();
+    void ApplyCommands(LuaWorkerVM& vm, const std::unordered_set<Actor*>& alive);
+    void WorkerLoop(int worker);
+
+    ParallelLuaManager() = default;
+    ~ParallelLuaManager() { Shutdown(); }
+
+    ParallelLuaManager(ParallelLuaManager const&) = delete; // Delete copy constructor
+    void operator=(ParallelLuaManager const&) = delete; // Delete assignment operator
+};
+
+#endif
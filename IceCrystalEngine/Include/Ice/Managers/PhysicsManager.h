@@ -12,32 +12,118 @@
 #include <glm/gtc/quaternion.hpp>
 
 #include <map>
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+
+#include <Ice/Utils/SnapshotRingBuffer.h>
+
 class RigidBody;
+class Actor;
+
+
+
+// Object layers, every body is on exactly one. Static / Dynamic / Trigger are picked automatically from the RigidBody
+// settings, Debris and the user layers are set by hand (RigidBody::SetLayer)
+namespace PhysicsLayer
+{
+    enum : JPH::ObjectLayer
+    {
+        Static = 0,
+        Dynamic = 1,
+        Trigger = 2,
+        Debris = 3, // small junk, only hits static geometry
+        User0 = 4, // User0 ... User11 collide like Dynamic until configured otherwise
+        Count = 16
+    };
+
+    // RigidBody::layer default, resolved to Static / Dynamic / Trigger when the body is made
+    constexpr JPH::ObjectLayer Auto = 0xFFFF;
 
+    // For PhysicsQueryFilter::layerMask, combine with |. Layers that dont exist (Auto included) have no bit
+    constexpr JPH::uint32 Mask(JPH::ObjectLayer layer) { return layer < Count ? 1u << layer : 0u; }
+}
 
+// What a physics query is allowed to hit
+struct PhysicsQueryFilter
+{
+    JPH::uint32 layerMask = 0xFFFFFFFF; // bit per PhysicsLayer, see PhysicsLayer::Mask
+    bool includeTriggers = true;
+    const RigidBody* ignore = nullptr; // usually the body doing the query
+};
 
-// Simple stub layers (just to get things running)
-class SimpleBroadPhaseLayer : public JPH::BroadPhaseLayerInterface
+// Separate broadphase trees, so static geometry (which never needs to be tested against itself) doesnt sit in
+// the same tree as the bodies that move every step
+namespace PhysicsBroadPhaseLayer
+{
+    constexpr JPH::BroadPhaseLayer Static(0);
+    constexpr JPH::BroadPhaseLayer Moving(1);
+    constexpr JPH::BroadPhaseLayer Trigger(2);
+    constexpr JPH::BroadPhaseLayer Debris(3);
+    constexpr JPH::uint Count = 4;
+}
+
+// The collision matrix between object layers and which broadphase tree each layer goes in.
+// The Jolt filters below read it directly, so only change it between steps.
+class PhysicsLayerConfig
 {
 public:
-    JPH::uint32 GetNumBroadPhaseLayers() const override { return 2; }
-    JPH::BroadPhaseLayer GetBroadPhaseLayer(JPH::ObjectLayer layer) const override
+    PhysicsLayerConfig();
+
+    void SetCollision(JPH::ObjectLayer layer1, JPH::ObjectLayer layer2, bool collide);
+    bool ShouldCollide(JPH::ObjectLayer layer1, JPH::ObjectLayer layer2) const
+    {
+        return layer1 < PhysicsLayer::Count && layer2 < PhysicsLayer::Count && (collisionMasks[layer1] & (1u << layer2)) != 0;
+    }
+
+    JPH::BroadPhaseLayer GetBroadPhaseLayer(JPH::ObjectLayer layer) const { return broadPhaseLayers[layer]; }
+    bool ShouldCollide(JPH::ObjectLayer layer, JPH::BroadPhaseLayer broadPhaseLayer) const
     {
-        // Explicitly construct a BroadPhaseLayer
-        return JPH::BroadPhaseLayer(static_cast<JPH::BroadPhaseLayer::Type>(layer));
+        return (broadPhaseMasks[layer] & (1u << static_cast<JPH::BroadPhaseLayer::Type>(broadPhaseLayer))) != 0;
     }
+
+private:
+    JPH::uint32 collisionMasks[PhysicsLayer::Count]; // bit per object layer it collides with
+    JPH::BroadPhaseLayer broadPhaseLayers[PhysicsLayer::Count];
+    JPH::uint32 broadPhaseMasks[PhysicsLayer::Count]; // bit per broadphase layer holding something it collides with
+
+    void RebuildBroadPhaseMasks();
 };
 
-class SimpleObjectVsBroadPhaseLayerFilter : public JPH::ObjectVsBroadPhaseLayerFilter
+class EngineBroadPhaseLayer : public JPH::BroadPhaseLayerInterface
 {
 public:
-    bool ShouldCollide(JPH::ObjectLayer, JPH::BroadPhaseLayer) const override { return true; }
+    explicit EngineBroadPhaseLayer(const PhysicsLayerConfig& config) : config(config) {}
+
+    JPH::uint GetNumBroadPhaseLayers() const override { return PhysicsBroadPhaseLayer::Count; }
+    JPH::BroadPhaseLayer GetBroadPhaseLayer(JPH::ObjectLayer layer) const override { return config.GetBroadPhaseLayer(layer); }
+
+private:
+    const PhysicsLayerConfig& config;
 };
 
-class SimpleObjectLayerPairFilter : public JPH::ObjectLayerPairFilter
+class EngineObjectVsBroadPhaseLayerFilter : public JPH::ObjectVsBroadPhaseLayerFilter
 {
 public:
-    bool ShouldCollide(JPH::ObjectLayer, JPH::ObjectLayer) const override { return true; }
+    explicit EngineObjectVsBroadPhaseLayerFilter(const PhysicsLayerConfig& config) : config(config) {}
+
+    bool ShouldCollide(JPH::ObjectLayer layer, JPH::BroadPhaseLayer broadPhaseLayer) const override { return config.ShouldCollide(layer, broadPhaseLayer); }
+
+private:
+    const PhysicsLayerConfig& config;
+};
+
+class EngineObjectLayerPairFilter : public JPH::ObjectLayerPairFilter
+{
+public:
+    explicit EngineObjectLayerPairFilter(const PhysicsLayerConfig& config) : config(config) {}
+
+    bool ShouldCollide(JPH::ObjectLayer layer1, JPH::ObjectLayer layer2) const override { return config.ShouldCollide(layer1, layer2); }
+
+private:
+    const PhysicsLayerConfig& config;
 };
 
 
@@ -71,34 +157,30 @@ inline glm::quat ToGLM(const JPH::Quat& q)
     return glm::quat(q.GetW(), q.GetX(), q.GetY(), q.GetZ());
 }
 
+// Both body IDs packed in one integer, smaller ID first so (a, b) and (b, a) are the same pair
 struct BodyPairKey
 {
-    JPH::BodyID body1;
-    JPH::BodyID body2;
+    uint64_t value;
     
     BodyPairKey(JPH::BodyID b1, JPH::BodyID b2)
     {
-        // Always store smaller ID first for consistent lookups
-        if (b1.GetIndexAndSequenceNumber() < b2.GetIndexAndSequenceNumber())
-        {
-            body1 = b1;
-            body2 = b2;
-        }
-        else
-        {
-            body1 = b2;
-            body2 = b1;
-        }
+        uint64_t id1 = b1.GetIndexAndSequenceNumber();
+        uint64_t id2 = b2.GetIndexAndSequenceNumber();
+        value = id1 < id2 ? (id1 << 32) | id2 : (id2 << 32) | id1;
     }
     
-    bool operator<(const BodyPairKey& other) const
-    {
-        if (body1.GetIndexAndSequenceNumber() != other.body1.GetIndexAndSequenceNumber())
-            return body1.GetIndexAndSequenceNumber() < other.body1.GetIndexAndSequenceNumber();
-        return body2.GetIndexAndSequenceNumber() < other.body2.GetIndexAndSequenceNumber();
-    }
+    bool operator<(const BodyPairKey& other) const { return value < other.value; }
+    bool operator==(const BodyPairKey& other) const { return value == other.value; }
+};
+
+struct BodyPairKeyHash
+{
+    size_t operator()(const BodyPairKey& key) const { return std::hash<uint64_t>{}(key.value); }
 };
 
+// Jolt calls the contact callbacks from its job threads in whatever order the jobs run, so they only record what happened
+// into a buffer per thread (no locks, no shared state). After the step DispatchEvents sorts everything by body pair and
+// fires the RigidBody callbacks on the main thread, always in the same order for the same simulation.
 class PhysicsContactListener : public JPH::ContactListener
 {
 public:
@@ -125,23 +207,167 @@ public:
 
     virtual void OnContactRemoved(const JPH::SubShapeIDPair& inSubShapePair) override;
 
+    // Main thread, after PhysicsSystem::Update
+    void DispatchEvents();
+
+    // Drops every pair the rigid body is part of (it is being destroyed), without firing the end callbacks
+    void ForgetRigidBody(RigidBody* rigidBody);
+    // Throws away the events of the last step without firing them (the step is being rolled back)
+    void DiscardEvents();
+
+    int GetActivePairCount() const { return static_cast<int>(activePairs.size()); }
+
 private:
-    std::map<BodyPairKey, std::pair<RigidBody*, RigidBody*>> activeContacts;
+    struct ContactEvent
+    {
+        BodyPairKey key;
+        bool added = false; // otherwise removed
+        uint64_t subShapes = 0; // only to make the sort order fully deterministic
+        // Added only, removed events look the pair up instead (the bodies might already be gone)
+        RigidBody* rigidBody1 = nullptr; // the one with the smaller body ID
+        RigidBody* rigidBody2 = nullptr;
+        bool isSensor1 = false;
+        bool isSensor2 = false;
+    };
+
+    struct EventBuffer
+    {
+        std::vector<ContactEvent> events;
+    };
+
+    // One per thread that ever reported a contact, only touched by that thread during the step
+    std::vector<std::unique_ptr<EventBuffer>> buffers;
+    std::mutex buffersMutex; // only for adding a new thread's buffer
+    EventBuffer& GetThreadBuffer();
+
+    struct ContactPair
+    {
+        RigidBody* rigidBody1;
+        RigidBody* rigidBody2;
+        bool isSensor1;
+        bool isSensor2;
+        int subShapeContacts = 0; // compound shapes touch with several sub shapes, the pair ends when all of them do
+    };
+    std::unordered_map<BodyPairKey, ContactPair, BodyPairKeyHash> activePairs;
+
+    std::vector<ContactEvent> dispatching; // reused every step
+
+    static void FireStarted(const ContactPair& pair);
+    static void FireEnded(const ContactPair& pair);
+};
+
+
+// World sizing, read once when the PhysicsManager is made. Starts from PhysicsManager::startupSettings (set those in code
+// before the engine starts) and then anything in {PROJECT_ROOT}PhysicsSettings.json overrides them, e.g.
+//     { "maxBodies": 16384, "maxBodyPairs": 65536, "maxContactConstraints": 32768, "threadCount": 6, "collisionSteps": 2, "tempAllocatorMB": 128 }
+struct PhysicsSettings
+{
+    JPH::uint maxBodies = 1024;
+    JPH::uint numBodyMutexes = 0; // 0 lets Jolt pick
+    JPH::uint maxBodyPairs = 1024;
+    JPH::uint maxContactConstraints = 1024;
+    int threadCount = -1; // -1 = hardware threads - 1
+    int collisionSteps = 1; // per Step, raise for fast moving bodies at low physics rates
+    JPH::uint tempAllocatorMB = 64;
+
+    // Same bodies added in the same order with the same inputs give bit identical steps (on the same build), needed for
+    // replays and rollback. Costs a little speed.
+    bool deterministic = true;
+    int snapshotHistory = 0; // steps of physics state kept for Rollback, 0 = off
+    int snapshotKeyframeInterval = 16; // full snapshot every this many steps, the rest are deltas against it
+
+    // Missing keys keep their current value, returns false if the file is missing or broken
+    bool Load(const std::string& path);
+};
+
+// High water marks, to size PhysicsSettings from real levels
+struct PhysicsStats
+{
+    JPH::uint bodies = 0;
+    JPH::uint peakBodies = 0;
+    JPH::uint peakActiveBodies = 0;
+    size_t peakTempAllocatorBytes = 0;
+    int tempAllocatorOverflows = 0; // allocations that didnt fit and went to the heap
+    // Steps where Jolt ran out of room and dropped contacts
+    int bodyPairCacheFullSteps = 0;
+    int manifoldCacheFullSteps = 0;
+    int contactConstraintsFullSteps = 0;
+    float lastStepMs = 0.0f;
+    float peakStepMs = 0.0f;
+    // Snapshots
+    size_t lastSnapshotBytes = 0;
+    float lastSaveMs = 0.0f;
+    float lastRestoreMs = 0.0f;
 };
 
+// Jolt's temp allocator, plus a peak usage counter and a heap fallback instead of crashing when it is too small
+class TrackingTempAllocator : public JPH::TempAllocator
+{
+public:
+    explicit TrackingTempAllocator(JPH::uint size) : inner(size), capacity(size) {}
+
+    void* Allocate(JPH::uint size) override;
+    void Free(void* address, JPH::uint size) override;
+
+    size_t GetPeakUsage() const { return peakUsage; }
+    int GetOverflowCount() const { return overflowCount; }
+
+private:
+    JPH::TempAllocatorImpl inner;
+    size_t capacity;
+    size_t usage = 0;
+    size_t peakUsage = 0;
+    int overflowCount = 0;
+    std::vector<void*> overflowBlocks;
+};
 
 class PhysicsManager
 {
 public:
     static PhysicsManager& GetInstance();
 
-    JPH::uint maxBodies = 1024;
-    JPH::uint numBodyMutexes = 0;
-    JPH::uint maxBodyPairs = 1024;
-    JPH::uint maxContactConstraints = 1024;
+    // Copied (then overridden by the settings file) when the PhysicsManager is made
+    static inline PhysicsSettings startupSettings;
+    static inline std::string settingsPath = "{PROJECT_ROOT}PhysicsSettings.json";
+    const PhysicsSettings& GetSettings() const { return settings; }
 
     void Step(float fixedDeltaTime);
 
+    // Drops a rigid body that is going away from the moving lists
+    void RemoveRigidBody(RigidBody* rigidBody);
+
+    // Fraction of a step the frame is past the last physics step (0-1), set by the engine after stepping
+    void SetInterpolationAlpha(float alpha) { interpolationAlpha = alpha; }
+    float GetInterpolationAlpha() const { return interpolationAlpha; }
+    float GetLastStepDeltaTime() const { return lastStepDeltaTime; }
+
+    // Writes the (interpolated) pose of every body that moved into its transform, in one pass.
+    // Sleeping bodies arent in the list at all, so they cost nothing per frame.
+    void SyncTransforms();
+
+    // Stats
+    int GetMovingBodyCount() const { return static_cast<int>(movingBodies.size()); }
+    const PhysicsStats& GetStats() const { return stats; }
+    void PrintStats() const;
+
+    // Snapshots of the whole simulation (bodies, velocities, sleep state, contact cache), only valid while the same bodies exist.
+    // Contact callbacks and anything outside the physics world arent part of it.
+    void SaveState(std::vector<uint8_t>& outState) const;
+    bool RestoreState(const std::vector<uint8_t>& state);
+    // Steps taken so far, the history is keyed on this
+    uint64_t GetTick() const { return stepIndex; }
+    // Every step is recorded here when PhysicsSettings::snapshotHistory is on
+    SnapshotRingBuffer& GetHistory() { return history; }
+    // Puts the world back to right after tick (it has to be in the history). The ticks after it are dropped and get
+    // recorded again as the game steps forward.
+    bool Rollback(uint64_t tick);
+    // Rolls back ticks steps and resimulates them, prints how long that took and whether it ended up bit identical.
+    // The live world (bodies, history, poses) is put back afterwards, so it is safe to call mid game
+    void BenchmarkRollback(int ticks);
+
+    // The physics worker threads, other engine systems can queue jobs here instead of starting their own pool
+    JPH::JobSystem& GetJobSystem() { return *jobSystem; }
+
     // Minimal getter for the PhysicsSystem
     JPH::PhysicsSystem& GetSystem() { return physicsSystem; }
 
@@ -149,22 +375,91 @@ public:
 
     void SetGravity(glm::vec3 gravity);
 
+    // Layers, change the matrix between steps (or before any bodies exist)
+    void SetLayerCollision(JPH::ObjectLayer layer1, JPH::ObjectLayer layer2, bool collide) { layerConfig.SetCollision(layer1, layer2, collide); }
+    bool GetLayerCollision(JPH::ObjectLayer layer1, JPH::ObjectLayer layer2) const { return layerConfig.ShouldCollide(layer1, layer2); }
+    // Called when static bodies are added, the broadphase gets rebuilt once before the next step
+    void MarkBroadPhaseDirty() { broadPhaseDirty = true; }
+
+    // Queries, only call these between steps (from any thread)
+    // Ray and shape casts both fill this in, rigidBody is nullptr on a miss
+    struct RaycastHit
+    {
+        RigidBody* rigidBody = nullptr;
+        Actor* actor = nullptr;
+        glm::vec3 point = glm::vec3(0.0f);
+        glm::vec3 normal = glm::vec3(0.0f);
+        float distance = 0.0f;
+    };
+    struct RaycastRequest
+    {
+        glm::vec3 origin;
+        glm::vec3 direction;
+        float maxDistance;
+    };
+
+    // Closest body hit by the ray, the broadphase tree culls everything the ray doesnt pass near
+    bool Raycast(glm::vec3 origin, glm::vec3 direction, float maxDistance, RaycastHit& hit, const PhysicsQueryFilter& filter = {});
+    // Every body along the ray (first hit per body), nearest first. Returns the number of hits.
+    int RaycastAll(glm::vec3 origin, glm::vec3 direction, float maxDistance, std::vector<RaycastHit>& hits, const PhysicsQueryFilter& filter = {});
+    // Casts a sphere / box along direction and returns the first body it touches
+    bool SphereCast(glm::vec3 origin, float radius, glm::vec3 direction, float maxDistance, RaycastHit& hit, const PhysicsQueryFilter& filter = {});
+    bool BoxCast(glm::vec3 center, glm::vec3 halfExtents, glm::quat rotation, glm::vec3 direction, float maxDistance, RaycastHit& hit, const PhysicsQueryFilter& filter = {});
+    // Bodies whose actual shapes overlap the sphere / box, each body once
+    void OverlapSphere(glm::vec3 center, float radius, std::vector<RigidBody*>& results, const PhysicsQueryFilter& filter = {});
+    void OverlapBox(glm::vec3 center, glm::vec3 halfExtents, glm::quat rotation, std::vector<RigidBody*>& results, const PhysicsQueryFilter& filter = {});
+    // Bodies whose bounding boxes touch the sphere, broadphase only so it doesnt test the actual shapes
+    void OverlapSphereBounds(glm::vec3 center, float radius, std::vector<RigidBody*>& results);
+    // Runs all the rays spread over the physics job system and waits for them, hits[i] is the result of rays[i]
+    void RaycastBatch(const std::vector<RaycastRequest>& rays, std::vector<RaycastHit>& hits, const PhysicsQueryFilter& filter = {});
+
 private:
     bool initialized = false;
+
+    // Bodies Jolt had active in the last step, and ones that fell asleep since the last SyncTransforms (they need one last write)
+    std::vector<RigidBody*> movingBodies;
+    std::vector<RigidBody*> settledBodies;
+    JPH::BodyIDVector activeBodyIds;
+    uint64_t stepIndex = 0;
+    void CaptureActivePoses();
+
+    std::vector<RigidBody*> stayBodies;
+    void DispatchStayCallbacks(float fixedDeltaTime);
+
+    bool CastShape(const JPH::Shape& shape, glm::vec3 center, glm::quat rotation, glm::vec3 direction, float maxDistance, RaycastHit& hit, const PhysicsQueryFilter& filter);
+    void CollideShape(const JPH::Shape& shape, glm::vec3 center, glm::quat rotation, std::vector<RigidBody*>& results, const PhysicsQueryFilter& filter);
+    // Fills in the body side of a hit, false if the body is gone or isnt a RigidBody
+    bool ResolveHit(const JPH::BodyID& bodyId, RaycastHit& hit);
+
+    float interpolationAlpha = 1.0f;
+    float lastStepDeltaTime = 1.0f / 60.0f;
+
+    SnapshotRingBuffer history;
+    std::vector<uint8_t> snapshotScratch;
+    void RecordSnapshot();
+    // Restored bodies are somewhere else now, the RigidBody caches and the moving list have to follow
+    void RefreshAfterRestore();
     
     PhysicsManager();
     PhysicsManager(PhysicsManager const&) = delete;
     void operator=(PhysicsManager const&) = delete;
     ~PhysicsManager();
 
-    // Jolt essentials
-    JPH::TempAllocatorImpl tempAllocator{ 64 * 1024 * 1024 }; // 64 MB
-    JPH::JobSystemThreadPool jobSystem{ JPH::cMaxPhysicsJobs, JPH::cMaxPhysicsBarriers };
+    PhysicsSettings settings;
+    PhysicsStats stats;
+    void UpdateStats(JPH::EPhysicsUpdateError errors, float stepMs);
+
+    // Jolt essentials, sized from the settings in the constructor
+    std::unique_ptr<TrackingTempAllocator> tempAllocator;
+    std::unique_ptr<JPH::JobSystemThreadPool> jobSystem;
     JPH::PhysicsSystem physicsSystem;
 
-    SimpleBroadPhaseLayer broadPhase;
-    SimpleObjectVsBroadPhaseLayerFilter layerFilter;
-    SimpleObjectLayerPairFilter pairFilter;
+    // layerConfig has to be declared before the filters that point at it
+    PhysicsLayerConfig layerConfig;
+    EngineBroadPhaseLayer broadPhase{ layerConfig };
+    EngineObjectVsBroadPhaseLayerFilter layerFilter{ layerConfig };
+    EngineObjectLayerPairFilter pairFilter{ layerConfig };
+    bool broadPhaseDirty = false;
 
     PhysicsContactListener contactListener;
 };
@@ -6,12 +6,22 @@
 
 #include <vector>
 #include <string>
+#include <string_view>
+#include <unordered_map>
 
 #include <glm/glm.hpp>
 
 class Actor;
 class Camera;
 
+// Lets the name / tag indices be searched with a string_view (straight from Lua) without building a std::string
+struct StringViewHash
+{
+	using is_transparent = void;
+	size_t operator()(std::string_view value) const { return std::hash<std::string_view>{}(value); }
+};
+using ActorIndex = std::unordered_map<std::string, std::vector<Actor*>, StringViewHash, std::equal_to<>>;
+
 
 // This is how to make a singleton class
 
@@ -37,13 +47,34 @@ public:
 	void AddActor(Actor* actor);
 	void RemoveActor(Actor* actor);
 
+	// Deletes every actor, the engine calls this at exit while the other managers are still alive
+	void DestroyAllActors();
+
 	Actor* GetHoveredActor() {return hoveredActor;}
 
 	// Returns the first actor with the given tag
-	Actor* GetActorByTag(std::string tag);
+	Actor* GetActorByTag(std::string_view tag);
 		
 	// Returns all actors with the given tag
-	std::vector<Actor*> GetActorsByTag(std::string tag);
+	const std::vector<Actor*>& GetActorsByTag(std::string_view tag);
+
+	// Returns the first actor with the given name
+	Actor* GetActorByName(std::string_view name);
+
+	// Returns all actors with the given name
+	const std::vector<Actor*>& GetActorsByName(std::string_view name);
+
+	// Called by Actor::SetName / Actor::SetTag to keep the indices up to date
+	void OnActorRenamed(Actor* actor, const std::string& oldName);
+	void OnActorRetagged(Actor* actor, const std::string& oldTag);
+
+	// Spatial queries, these go through the physics broadphase so only actors with a RigidBody are found
+	// Actors whose collider bounds touch the sphere, optionally only ones with the given tag
+	void OverlapSphere(glm::vec3 center, float radius, std::vector<Actor*>& results, std::string_view tag = {});
+	// Closest actor hit by the ray, returns nullptr if nothing was hit
+	Actor* Raycast(glm::vec3 origin, glm::vec3 direction, float maxDistance, glm::vec3* point = nullptr, glm::vec3* normal = nullptr, float* distance = nullptr);
+	// Closest actor with the given tag (only looks at actors with that tag, any actor not just physics ones)
+	Actor* NearestWithTag(glm::vec3 position, std::string_view tag, float maxDistance = -1.0f, float* distance = nullptr);
 
 	// Returns the first component of the given type
 	template <typename T>
@@ -60,6 +91,13 @@ private:
 	std::vector<Actor*>* actors;
 	std::vector<glm::vec3> usedActorColors;
 
+	// name / tag -> actors, in the order they were added so GetActorByTag still returns the oldest one
+	ActorIndex nameIndex;
+	ActorIndex tagIndex;
+	static void IndexAdd(ActorIndex& index, const std::string& key, Actor* actor);
+	static void IndexRemove(ActorIndex& index, const std::string& key, Actor* actor);
+	static const std::vector<Actor*>& IndexFind(const ActorIndex& index, std::string_view key);
+
 	Actor* hoveredActor;
 	
 	SceneManager(); // Private constructor to ensure a single instance
@@ -17,6 +17,8 @@ class Material // this is the class definition
 	
 	void InitializeMaterial();
 
+	int reloadWatchId = 0;
+
 public:
 	
 	std::string materialPath = "{ENGINE_ASSET_DIR}Materials/default.mat";
@@ -24,6 +26,7 @@ public:
 
 	std::shared_ptr<Texture> texture; // the texture of the material
 	std::shared_ptr<Shader> shader; // the shader the material uses
+	std::vector<std::string> keywords; // shader permutation keywords ("Keywords" in the .mat file)
 
 	glm::vec3 color;
 	float smoothness;
@@ -37,6 +40,9 @@ public:
 
 	void ApplyProperties();
 
+	// Re-reads the .mat file (called automatically when it changes on disk)
+	void Reload();
+
 	Material(); // constructs a default material
 	Material(std::string path); // constructs a material using a .mat file
 
@@ -4,29 +4,46 @@
 #define SHADER_H // definition
 
 #include <string>
+#include <vector>
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
 class Shader {
 
 	void InitializeShader();
+	std::string PreprocessStage(const std::string& path);
+	GLuint BuildProgram();
+
+	// Hot reload
+	std::vector<int> reloadWatchIds;
+	void WatchFiles();
+	void UnwatchFiles();
 	
 public:
 	
 	std::string VertexShaderPath = "{ASSET_DIR}Shaders/default.vert"; // i dont really need these, but they might come in handy eventually
 	std::string FragmentShaderPath = "{ASSET_DIR}Shaders/default.frag";
 	std::string GeometryShaderPath = "";
+	// Permutation keywords this variant was built with (see #pragma keywords in ShaderPreprocessor)
+	std::vector<std::string> Keywords;
+	// Every file the program was built from (including #includes)
+	std::vector<std::string> Files;
 
 	std::int32_t Handle;
 
 	Shader();
 	Shader(std::string shaderName); // Loads {shaderName}.vert/.frag/.geom
+	Shader(std::string shaderName, const std::vector<std::string>& keywords);
 	Shader(std::string vertexShaderPath, std::string fragmentShaderPath);
 	Shader(std::string vertexShaderPath, std::string fragmentShaderPath, std::string geometryShaderPath);
 
     ~Shader();
 
 	void Use();
+	// Rebuilds the program from disk, keeps the current program if the new one fails to compile
+	bool Reload();
+
+	bool HasKeyword(const std::string& keyword) const;
 
 
     // utility uniform functions
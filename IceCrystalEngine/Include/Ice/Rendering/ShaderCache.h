@@ -0,0 +1,81 @@
+#pragma once
+
+#ifndef SHADER_CACHE_H
+#define SHADER_CACHE_H
+
+#include <glad/glad.h>
+#include <Ice/Utils/DerivedDataCache.h>
+#include <cstdint>
+#include <string>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+class Shader;
+
+// Keeps one linked GL program per unique set of shader sources.
+// Programs are keyed by a hash of their sources, so materials that use the same shader share the same program,
+// and linked programs are stored in the DerivedDataCache with glGetProgramBinary so the next run can skip compiling entirely.
+class ShaderCache
+{
+public:
+    static ShaderCache& GetInstance()
+    {
+        static ShaderCache instance; // Static local variable ensures a single instance
+        return instance;
+    }
+
+    // Set to false to never read/write program binaries (always compile from source), binaries are stored in the DerivedDataCache
+    bool persistToDisk = true;
+
+    // Returns a linked program for the given sources (geometrySource can be empty), reusing an existing one if possible.
+    // Every Acquire must be matched by a Release.
+    GLuint Acquire(const std::string& vertexSource, const std::string& fragmentSource, const std::string& geometrySource, const std::string& debugName);
+    void Release(GLuint program);
+
+    // Returns a shared Shader for {shaderName}.vert/.frag/.geom, so identical materials share one Shader object
+    std::shared_ptr<Shader> GetShader(const std::string& shaderName);
+    // Same as above, but for a permutation of the shader, each unique set of keywords is its own Shader and program
+    std::shared_ptr<Shader> GetShader(const std::string& shaderName, const std::vector<std::string>& keywords);
+
+    // Stats
+    int GetProgramCount() const { return static_cast<int>(programs.size()); }
+    int GetMemoryHits() const { return memoryHits; }
+    int GetDiskHits() const { return diskHits; }
+    int GetCompiles() const { return compiles; }
+
+private:
+    struct ProgramEntry
+    {
+        GLuint handle = 0;
+        int refCount = 0;
+    };
+
+    std::unordered_map<uint64_t, ProgramEntry> programs; // source hash -> program
+    std::unordered_map<GLuint, uint64_t> programHashes; // program -> source hash
+    std::unordered_map<std::string, std::weak_ptr<Shader>> shaders; // shader name (+ keywords) -> shared shader
+
+    uint64_t driverHash = 0;
+    bool binariesSupported = false;
+    bool driverQueried = false;
+
+    int memoryHits = 0;
+    int diskHits = 0;
+    int compiles = 0;
+
+    void QueryDriver();
+    DerivedDataKey GetBinaryKey(const std::string& vertexSource, const std::string& fragmentSource, const std::string& geometrySource);
+
+    GLuint LoadBinary(const DerivedDataKey& key);
+    void SaveBinary(const DerivedDataKey& key, GLuint program);
+    GLuint CompileProgram(const std::string& vertexSource, const std::string& fragmentSource, const std::string& geometrySource, const std::string& debugName);
+
+    ShaderCache() = default;
+    // Programs are not deleted here, they go away with the GL context
+    ~ShaderCache() = default;
+
+    ShaderCache(ShaderCache const&) = delete; // Delete copy constructor
+    void operator=(ShaderCache const&) = delete; // Delete assignment operator
+};
+
+#endif
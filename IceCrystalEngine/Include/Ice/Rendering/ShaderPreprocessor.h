@@ -0,0 +1,51 @@
+#pragma once
+
+#ifndef SHADER_PREPROCESSOR_H
+#define SHADER_PREPROCESSOR_H
+
+#include <string>
+#include <vector>
+#include <functional>
+
+// Expands a GLSL source before it is handed to the driver.
+// Supports:
+//  #include "file"          - relative to the including file (or a {ENGINE_ASSET_DIR} style path), each file is only included once
+//  #pragma keywords A B C   - declares permutation keywords, enabled keywords are injected as "#define A"
+// Injected defines and keywords are placed right after the #version line.
+// This does not touch OpenGL, so it can be run anywhere.
+class ShaderPreprocessor
+{
+public:
+    // Reads a file into outContents, returns false if it could not be read
+    using FileReader = std::function<bool(const std::string& path, std::string& outContents)>;
+
+    struct Result
+    {
+        bool success = true;
+        std::string error;
+
+        std::string source;
+        // Every file that ended up in the source, index matches the #line source string number (0 is the root file)
+        std::vector<std::string> files;
+        // Keywords declared with #pragma keywords
+        std::vector<std::string> keywords;
+    };
+
+    // defines are always injected ("NAME" or "NAME VALUE"), keywords are only injected if the source declares them
+    static Result Process(const std::string& source, const std::string& path,
+                          const std::vector<std::string>& defines = {},
+                          const std::vector<std::string>& keywords = {},
+                          const FileReader& reader = ReadFromDisk);
+
+    // Default reader, goes through FileUtil so {ASSET_DIR} style paths work
+    static bool ReadFromDisk(const std::string& path, std::string& outContents);
+
+    static std::string GetDirectory(const std::string& path);
+
+    static constexpr int maxIncludeDepth = 32;
+
+private:
+    static bool ProcessFile(const std::string& source, int fileIndex, int depth, const FileReader& reader, Result& result);
+};
+
+#endif
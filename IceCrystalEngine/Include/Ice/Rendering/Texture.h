@@ -5,12 +5,22 @@
 #define TEXTURE_H
 
 #include <string>
+#include <vector>
+#include <cstdint>
 #include <glad/glad.h>
 
 class Texture
 {
 
 	void InitializeTexture();
+	void UploadImage();
+	// Decoded pixels (with a small header) from the DerivedDataCache, decoding the image on a miss
+	bool LoadPixels(std::vector<uint8_t>& outCooked);
+
+	// Bump when the decoding settings change
+	static constexpr uint32_t TEXTURE_COOKER_VERSION = 1;
+
+	int reloadWatchId = 0;
 	
 public:
 
@@ -19,6 +29,10 @@ public:
 
 	Texture();
 	Texture(std::string texturePath);
+	~Texture();
+
+	// Re-uploads the image from disk (called automatically when it changes)
+	void Reload();
 
 };
 
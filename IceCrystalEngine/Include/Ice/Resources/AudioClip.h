@@ -6,6 +6,7 @@
 #include <string>
 #include <AL/al.h>
 #include <vector>
+#include <cstdint>
 
 class AudioClip
 {
@@ -13,16 +14,29 @@ public:
     AudioClip();
     ~AudioClip();
 
-    bool LoadFromFile(const std::string& filepath);
+    // .wav or .flac. streaming only reads the header, every AudioSource playing it then decodes its own small window
+    // of the file (see AudioStream). Use it for music / ambience, short sound effects should stay fully loaded.
+    bool LoadFromFile(const std::string& filepath, bool streaming = false);
     void Unload();
 
+    // LoadFromFile is Decode then Upload. Decode doesnt touch OpenAL, AudioManager::LoadClipAsync runs it on a worker thread.
+    bool Decode(const std::string& filepath);
+    bool Upload();
+
     ALuint GetBuffer() const {return buffer;}
     ALuint GetMonoBuffer();
-    bool IsLoaded() const {return buffer != 0;}
+    bool IsLoaded() const {return buffer != 0 || streaming;}
+    bool IsStreaming() const {return streaming;}
 
     float GetDuration() const {return duration;}
     float GetSampleRate() const {return sampleRate;}
     float GetChannelCount() const {return channels;}
+    int GetBitsPerSample() const {return bitsPerSample;}
+
+    uint64_t GetFrameCount() const {return frameCount;}
+
+    // For AudioStream to open its own decoder
+    const std::string& GetPath() const {return path;}
 private:
     ALuint buffer;
     ALuint monoBuffer;
@@ -32,9 +46,12 @@ private:
     int bitsPerSample;
     std::vector<char> rawData;
 
-    void CreateMonoBuffer();
+    uint64_t frameCount;
+
+    bool streaming;
+    std::string path;
 
-    bool LoadWAV(const std::string& filepath);
+    void CreateMonoBuffer();
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,63 @@
+#pragma once
+
+#ifndef AUDIO_DECODER_H
+#define AUDIO_DECODER_H
+
+#include <cstdint>
+#include <cstddef>
+#include <istream>
+#include <memory>
+#include <string>
+
+// Turns an audio file into interleaved PCM a few frames at a time. AudioClip decodes a whole file through one up front,
+// AudioStream keeps one open and pulls from it as its buffers drain. Decoders dont touch OpenAL so they are fine to run
+// on any thread.
+class AudioDecoder
+{
+public:
+    virtual ~AudioDecoder() = default;
+
+    // Picks the decoder from the extension (.wav, .flac), opens path through the VFS and reads the header.
+    // nullptr if the format isnt supported or the file is bad.
+    static std::unique_ptr<AudioDecoder> Open(const std::string& path);
+    static bool IsSupported(const std::string& path);
+
+    // Decodes up to count frames into out (count * GetFrameSize() bytes), returns how many it did, 0 at the end
+    virtual size_t Read(void* out, size_t count) = 0;
+    // Moves to frame, the next Read starts there
+    virtual bool Seek(uint64_t frame) = 0;
+
+    // Output format, always 8 or 16 bit, mono or stereo (what OpenAL takes without extensions)
+    int GetSampleRate() const { return sampleRate; }
+    int GetChannels() const { return channels; }
+    int GetBitsPerSample() const { return bitsPerSample; }
+    int GetFrameSize() const { return channels * (bitsPerSample / 8); }
+    uint64_t GetFrameCount() const { return frameCount; }
+
+protected:
+    std::unique_ptr<std::istream> stream;
+    int sampleRate = 0;
+    int channels = 0;
+    int bitsPerSample = 0;
+    uint64_t frameCount = 0;
+
+    // Reads the header from stream, leaving it at the first frame
+    virtual bool ReadHeader() = 0;
+};
+
+// Plain PCM .wav, the samples are copied straight out of the data chunk
+class WavDecoder : public AudioDecoder
+{
+public:
+    size_t Read(void* out, size_t count) override;
+    bool Seek(uint64_t frame) override;
+
+protected:
+    bool ReadHeader() override;
+
+private:
+    uint64_t dataOffset = 0;
+    uint64_t position = 0; // frames
+};
+
+#endif
@@ -0,0 +1,75 @@
+#pragma once
+
+#ifndef AUDIO_STREAM_H
+#define AUDIO_STREAM_H
+
+#include <AL/al.h>
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+class AudioClip;
+class AudioDecoder;
+
+// Plays a streaming AudioClip through one source. Instead of the whole file in one buffer, BUFFER_COUNT small buffers
+// are queued on the source and refilled from the decoder as the source finishes them (AudioManager's streaming thread
+// calls Service), so a long track only ever has a fraction of a second decoded in memory.
+class AudioStream
+{
+public:
+    AudioStream(AudioClip* clip, ALuint source, bool mono);
+    ~AudioStream();
+
+    // Fills and queues every buffer from startTime and starts the source
+    bool Start(bool loop, float startTime = 0.0f);
+    void Stop();
+
+    // Unqueues finished buffers, refills and requeues them. Called from the streaming thread.
+    void Service();
+
+    // Looping is handled here (wraps back to the start of the data), AL_LOOPING must stay off on a queued source
+    void SetLooping(bool loop);
+    void Seek(float seconds);
+    float GetTime() const;
+
+    // True once the source played out the end of the data, or after Stop
+    bool IsFinished() const;
+
+    ALuint GetSource() const { return source; }
+
+private:
+    static constexpr int BUFFER_COUNT = 4;
+    static constexpr size_t BUFFER_SIZE = 32 * 1024;
+
+    AudioClip* clip;
+    ALuint source;
+    ALuint buffers[BUFFER_COUNT] = {};
+    bool mono; // spatial sources get a mono downmix, OpenAL only positions mono buffers
+
+    std::unique_ptr<AudioDecoder> decoder;
+    mutable std::mutex mutex;
+
+    ALenum format = 0;
+    uint32_t blockAlign = 0;   // bytes per decoded frame
+    uint64_t startFrame = 0;   // where the last Start / Seek began
+    uint64_t playedFrames = 0; // frames of buffers the source already finished since then, for GetTime
+    std::deque<uint32_t> queuedFrames; // frames in each buffer still queued, oldest first
+    bool looping = false;
+    bool finished = false;
+    bool playing = false;
+
+    std::vector<char> readScratch;
+    std::vector<char> monoScratch;
+
+    // Reads the next chunk into buffer, false when there was nothing left to read
+    bool FillBuffer(ALuint buffer);
+    uint64_t TimeToFrame(float seconds) const;
+    void Rewind(uint64_t frame);
+    void Queue(ALuint buffer);
+    void ClearQueue();
+};
+
+#endif
@@ -0,0 +1,88 @@
+#pragma once
+
+#ifndef FLAC_DECODER_H
+#define FLAC_DECODER_H
+
+#include <Ice/Resources/AudioDecoder.h>
+
+#include <vector>
+
+// Native .flac (not Ogg FLAC), mono or stereo, up to 24 bits per sample. Output is always 16 bit.
+// Lossless and usually around half the size of the .wav, decoding is cheap enough to stream several at once.
+class FlacDecoder : public AudioDecoder
+{
+public:
+    size_t Read(void* out, size_t count) override;
+    bool Seek(uint64_t frame) override;
+
+protected:
+    bool ReadHeader() override;
+
+private:
+    // Big endian bit reader over the stream, reads it in 64KB chunks
+    class BitReader
+    {
+    public:
+        void Reset(std::istream* stream, uint64_t offset);
+
+        uint32_t ReadBits(int count);
+        int32_t ReadSigned(int count);
+        // Number of 0 bits before the next 1 (the 1 is consumed too)
+        uint32_t ReadUnary();
+        void AlignToByte() { bitCount -= bitCount % 8; }
+        void SkipBytes(uint64_t count);
+
+        uint64_t Tell() const { return offset - bitCount / 8; }
+        bool IsEOF() const { return eof; }
+
+    private:
+        std::istream* stream = nullptr;
+        std::vector<uint8_t> buffer;
+        size_t bufferPos = 0;
+        size_t bufferSize = 0;
+        uint64_t offset = 0; // stream position of buffer[bufferPos]
+        uint64_t cache = 0;  // the low bitCount bits are unread
+        int bitCount = 0;
+        bool eof = false;
+
+        uint8_t NextByte();
+    };
+
+    BitReader reader;
+    int streamBitsPerSample = 0;
+    int streamBlockSize = 0; // fixed blocksize streams number their frames, not their samples
+    uint64_t firstFrameOffset = 0;
+    uint64_t streamSize = 0;
+
+    // SEEKTABLE block, offsets are from the first frame. Often missing, Seek bisects the file then.
+    struct SeekPoint
+    {
+        uint64_t frame;
+        uint64_t offset;
+    };
+    std::vector<SeekPoint> seekPoints;
+
+    struct FrameHeader
+    {
+        uint64_t offset; // of the sync code
+        uint64_t firstFrame;
+        int blockSize;
+        int channelAssignment;
+        int bits;
+    };
+
+    // The last decoded FLAC frame, as 16 bit interleaved
+    std::vector<int16_t> block;
+    size_t blockFrames = 0;
+    size_t blockPosition = 0;
+    uint64_t blockFirstFrame = 0;
+    std::vector<int32_t> channelSamples[2];
+
+    // Scans forward to the next frame header whose CRC-8 matches, false at the end of the stream
+    bool ReadFrameHeader(FrameHeader& header);
+    bool DecodeFrame();
+    bool DecodeSubframe(int32_t* out, int blockSize, int bits);
+    bool DecodeResidual(int32_t* out, int blockSize, int order);
+};
+
+#endif
@@ -0,0 +1,85 @@
+#pragma once
+
+#ifndef DERIVED_DATA_CACHE_H
+#define DERIVED_DATA_CACHE_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <mutex>
+#include <span>
+
+// Identifies one cooked output: which cooker made it (and which version of it), plus everything that went into it
+// (source bytes, settings). Two loads with the same inputs always produce the same key, on any machine.
+class DerivedDataKey
+{
+public:
+    DerivedDataKey(const std::string& cooker, uint32_t cookerVersion);
+
+    DerivedDataKey& Add(const void* data, size_t size);
+    DerivedDataKey& Add(std::span<const std::byte> data) { return Add(data.data(), data.size()); }
+    DerivedDataKey& Add(std::string_view str);
+    DerivedDataKey& Add(uint64_t value);
+
+    const std::string& GetCooker() const { return cooker; }
+    // "{cooker}/{128 bit hash}"
+    std::string ToString() const;
+
+private:
+    std::string cooker;
+    // Two differently seeded 64 bit hashes, 64 bits alone isnt enough for a cache shared between machines
+    uint64_t hashA;
+    uint64_t hashB;
+};
+
+// Central, content addressed cache for everything the engine cooks from source assets (meshes, decoded textures, shader binaries).
+// Entries live under cacheDir (never next to the assets, so read only asset folders are fine) and are written atomically,
+// so several instances (or machines, on a shared folder) can use the same cache. When the cache grows past maxSizeBytes
+// the least recently used entries are deleted.
+class DerivedDataCache
+{
+public:
+    static DerivedDataCache& GetInstance()
+    {
+        static DerivedDataCache instance; // Static local variable ensures a single instance
+        return instance;
+    }
+
+    // Set to false to always cook from source
+    bool enabled = true;
+    std::string cacheDir = "{PROJECT_ROOT}Cache/DerivedData/";
+    uint64_t maxSizeBytes = 2ull * 1024 * 1024 * 1024; // 2 GB
+
+    // Returns false on a miss (or a corrupt entry). Safe to call from any thread.
+    bool Get(const DerivedDataKey& key, std::vector<uint8_t>& outData);
+    // Stores data under key, LZ4 compressing it if that is worth it. Safe to call from any thread.
+    bool Put(const DerivedDataKey& key, const void* data, size_t size);
+    bool Put(const DerivedDataKey& key, const std::vector<uint8_t>& data) { return Put(key, data.data(), data.size()); }
+
+    // Deletes least recently used entries until the cache is below maxSizeBytes
+    void CollectGarbage();
+
+    // Stats
+    int GetHits() const { return hits; }
+    int GetMisses() const { return misses; }
+    uint64_t GetSize() const { return currentSize; }
+
+private:
+    std::mutex mutex;
+    uint64_t currentSize = 0;
+    bool sizeKnown = false;
+
+    int hits = 0;
+    int misses = 0;
+
+    std::string GetEntryPath(const DerivedDataKey& key);
+    void CollectGarbageLocked();
+
+    DerivedDataCache() = default;
+
+    DerivedDataCache(DerivedDataCache const&) = delete; // Delete copy constructor
+    void operator=(DerivedDataCache const&) = delete; // Delete assignment operator
+};
+
+#endif
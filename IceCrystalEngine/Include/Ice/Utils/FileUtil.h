@@ -3,6 +3,7 @@
 #define FILE_UTIL_H
 
 #include <filesystem>
+#include <string>
 
 class FileUtil {
 	
@@ -17,6 +18,8 @@ public:
 	static bool FileExists(const std::string& filename);
 	
 	static std::string SubstituteVariables(const std::string& str);
+	// Substitutes {VARIABLES} and normalizes the path so the same file always maps to the same string
+	static std::string NormalizePath(const std::string& path);
 
 	static std::string GetProjectRoot();
 	static std::string GetExecutableDir();
@@ -0,0 +1,63 @@
+#pragma once
+
+#ifndef HASH_UTIL_H
+#define HASH_UTIL_H
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+// Small non-cryptographic hashing helpers (64 bit FNV-1a), used to key caches by content
+class HashUtil
+{
+public:
+    static constexpr uint64_t offsetBasis = 14695981039346656037ull;
+    static constexpr uint64_t prime = 1099511628211ull;
+
+    // Hash a block of bytes, pass a previous result as the seed to chain multiple blocks together
+    static uint64_t Hash(const void* data, size_t size, uint64_t seed = offsetBasis)
+    {
+        const unsigned char* bytes = static_cast<const unsigned char*>(data);
+        uint64_t hash = seed;
+        for (size_t i = 0; i < size; i++)
+        {
+            hash ^= bytes[i];
+            hash *= prime;
+        }
+        return hash;
+    }
+
+    static uint64_t Hash(std::string_view str, uint64_t seed = offsetBasis)
+    {
+        // Mix the length in so ("ab", "c") and ("a", "bc") dont collide when chained
+        uint64_t size = str.size();
+        return Hash(str.data(), str.size(), Hash(&size, sizeof(size), seed));
+    }
+
+    static uint64_t Hash(const std::string& str, uint64_t seed = offsetBasis)
+    {
+        return Hash(std::string_view(str), seed);
+    }
+
+    // Without this a C string with a seed would pick the (data, size) overload and read seed bytes
+    static uint64_t Hash(const char* str, uint64_t seed = offsetBasis)
+    {
+        return Hash(std::string_view(str), seed);
+    }
+
+    // Hex string of a hash, handy for file names
+    static std::string ToHex(uint64_t hash)
+    {
+        static const char digits[] = "0123456789abcdef";
+        std::string out(16, '0');
+        for (int i = 15; i >= 0; i--)
+        {
+            out[i] = digits[hash & 0xF];
+            hash >>= 4;
+        }
+        return out;
+    }
+};
+
+#endif
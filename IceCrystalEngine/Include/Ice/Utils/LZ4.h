@@ -0,0 +1,22 @@
+#pragma once
+
+#ifndef LZ4_H
+#define LZ4_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+// Minimal LZ4 block format codec (no frame format), used by .pak archives.
+// The output is a standard LZ4 block, so anything packed here can also be read by the reference lz4 library.
+class LZ4
+{
+public:
+    // Greedy single pass compressor, fast rather than small
+    static std::vector<uint8_t> Compress(const uint8_t* source, size_t sourceSize);
+
+    // Decompresses into destination, which must be exactly the uncompressed size. Returns false on corrupt data.
+    static bool Decompress(const uint8_t* source, size_t sourceSize, uint8_t* destination, size_t destinationSize);
+};
+
+#endif
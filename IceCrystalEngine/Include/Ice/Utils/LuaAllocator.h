@@ -0,0 +1,63 @@
+#pragma once
+
+#ifndef LUA_ALLOCATOR_H
+#define LUA_ALLOCATOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// lua_Alloc for a single lua_State. Lua makes tons of tiny objects (strings, tables, closures, upvalues),
+// so everything up to maxPooledSize comes out of 16 byte size classes carved from big pages, freed blocks
+// go on a per class free list and get reused straight away. Bigger blocks go to malloc.
+// A lua_State is only ever used by one thread at a time, so each state gets its own allocator and the
+// free lists need no locking.
+class LuaAllocator
+{
+public:
+    static constexpr size_t granularity = 16;
+    static constexpr size_t maxPooledSize = 256;
+    static constexpr size_t classCount = maxPooledSize / granularity;
+    static constexpr size_t pageSize = 64 * 1024;
+
+    LuaAllocator() = default;
+    ~LuaAllocator();
+
+    // Pass to lua_newstate with the allocator as ud
+    static void* Alloc(void* ud, void* ptr, size_t osize, size_t nsize);
+
+    // Stats
+    size_t GetBytesInUse() const { return bytesInUse; }
+    size_t GetPeakBytesInUse() const { return peakBytesInUse; }
+    size_t GetPageBytes() const { return pages.size() * pageSize; }
+    size_t GetLargeBytes() const { return largeBytes; }
+
+private:
+    struct FreeBlock
+    {
+        FreeBlock* next;
+    };
+
+    FreeBlock* freeLists[classCount] = {};
+    std::vector<void*> pages;
+    // Unused part of the newest page
+    uint8_t* pageCursor = nullptr;
+    uint8_t* pageEnd = nullptr;
+
+    size_t bytesInUse = 0;
+    size_t peakBytesInUse = 0;
+    size_t largeBytes = 0;
+
+    static size_t ClassOf(size_t size) { return (size + granularity - 1) / granularity - 1; }
+    static bool IsPooled(size_t size) { return size <= maxPooledSize; }
+
+    void* Allocate(size_t size);
+    void Free(void* ptr, size_t size);
+    void* AllocateFromPage(size_t blockSize);
+    void Track(size_t oldSize, size_t newSize);
+
+    LuaAllocator(LuaAllocator const&) = delete; // Delete copy constructor
+    void operator=(LuaAllocator const&) = delete; // Delete assignment operator
+};
+
+#endif
@@ -0,0 +1,62 @@
+#pragma once
+
+#ifndef LUA_CHUNK_CACHE_H
+#define LUA_CHUNK_CACHE_H
+
+#include <sol/sol.hpp>
+#include <lua/lua.hpp>
+
+#include <Ice/Utils/DerivedDataCache.h>
+
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+// Compiles each script once per unique source and hands out a new function for every instance of it.
+// The source is compiled wrapped as
+//     local _ENV = ...; return function(...) <source>
+//     end
+// so calling the compiled chunk with an environment returns a new closure of the same compiled function with its own
+// globals, 1000 actors with the same script share one compiled function and only the environment differs.
+// Compiled chunks also go in the DerivedDataCache (lua_dump), so the next run doesnt parse the script at all.
+// One per lua_State, everything compiled here belongs to that state (and its threads).
+class LuaChunkCache
+{
+public:
+    // Set to false to never read/write bytecode from the DerivedDataCache (still shared in memory)
+    bool persistToDisk = true;
+
+    // Returns a new function that runs the script with env as its globals, or an invalid function (and error) if it doesnt compile.
+    // L can be the state or any of its threads, the function is created on L.
+    sol::function Instantiate(lua_State* L, const std::string& path, std::string_view source, const sol::environment& env, std::string& error);
+
+    // Drops every compiled chunk, call before the state closes
+    void Clear() { chunks.clear(); }
+
+    // Stats
+    int GetChunkCount() const { return static_cast<int>(chunks.size()); }
+    int GetMemoryHits() const { return memoryHits; }
+    int GetDiskHits() const { return diskHits; }
+    int GetCompiles() const { return compiles; }
+
+private:
+    struct Chunk
+    {
+        std::string key; // DerivedDataKey string, changes when the source does
+        // Held through the main state, the thread that first ran the script is collected once it finishes
+        sol::main_reference factory;
+    };
+
+    std::unordered_map<std::string, Chunk> chunks; // path -> newest compiled version of it
+
+    int memoryHits = 0;
+    int diskHits = 0;
+    int compiles = 0;
+
+    // These leave the compiled chunk on top of L's stack on success
+    bool LoadBytecode(lua_State* L, const DerivedDataKey& key, const std::string& chunkName);
+    bool Compile(lua_State* L, std::string_view source, const std::string& chunkName, std::string& error);
+    void SaveBytecode(lua_State* L, const DerivedDataKey& key);
+};
+
+#endif
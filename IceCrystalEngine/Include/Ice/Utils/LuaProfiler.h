@@ -0,0 +1,149 @@
+#pragma once
+
+#ifndef LUA_PROFILER_H
+#define LUA_PROFILER_H
+
+#include <lua/lua.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <chrono>
+
+// Finds out which script is eating the frame.
+// - Every coroutine resume and RunService callback is timed exactly (a Scope), and attributed to its script file
+// - Lua allocations are counted through a wrapping lua_Alloc and charged to whatever Scope is running
+// - A lua_sethook count hook samples which function is executing, so the report can point at the slow function inside a script
+// Everything is main thread only. When not running the Scopes cost a single branch.
+class LuaProfiler
+{
+public:
+    static LuaProfiler& GetInstance()
+    {
+        static LuaProfiler instance; // Static local variable ensures a single instance
+        return instance;
+    }
+
+    // Lua instructions between two samples, lower is more precise but slower
+    int sampleInterval = 1000;
+    // How many frames ExportTimeline can look back
+    size_t maxTimelineFrames = 300;
+
+    // Installs the allocator and sampling hook on the main state (threads created from it inherit the hook)
+    void Start(lua_State* L);
+    void Stop();
+    bool IsRunning() const { return running; }
+    // Throws away everything collected so far
+    void Reset();
+
+    // Call at the start of every frame, splits up the timeline
+    void BeginFrame();
+
+    // Times everything until it goes out of scope and charges it (and its allocations) to script / name
+    class Scope
+    {
+    public:
+        Scope(const std::string& script, const std::string& name, lua_State* thread = nullptr)
+        {
+            if (GetInstance().running)
+                active = GetInstance().PushScope(script, name, thread);
+        }
+        ~Scope()
+        {
+            if (active)
+                GetInstance().PopScope();
+        }
+
+        Scope(Scope const&) = delete;
+        void operator=(Scope const&) = delete;
+
+    private:
+        bool active = false;
+    };
+
+    // One row per script / name, most expensive first, with the hottest sampled functions underneath
+    std::string GetFlatReport(size_t maxRows = 30) const;
+    // script -> scopes -> sampled functions
+    std::string GetTreeReport() const;
+    // Writes the recorded frames as a Chrome trace (open in chrome://tracing or ui.perfetto.dev)
+    bool ExportTimeline(const std::string& path) const;
+
+    // "file.lua:12" for the function at index, used to name RunService callbacks
+    static std::string DescribeFunction(lua_State* L, int index, std::string* outSource = nullptr);
+
+    // Totals
+    uint64_t GetAllocatedBytes() const { return allocatedBytes; }
+    uint64_t GetSampleCount() const { return sampleCount; }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct ScopeStats
+    {
+        std::string script;
+        std::string name;
+        uint64_t calls = 0;
+        double totalMs = 0.0;
+        double maxMs = 0.0;
+        uint64_t allocBytes = 0;
+        uint64_t allocCount = 0;
+        uint64_t sampleCount = 0;
+        std::unordered_map<std::string, uint64_t> samples; // function -> samples
+    };
+
+    struct ActiveScope
+    {
+        size_t stats;
+        Clock::time_point start;
+        uint64_t allocBytesAtStart;
+        uint64_t allocCountAtStart;
+    };
+
+    struct TimelineEvent
+    {
+        size_t stats;
+        double startUs;
+        double durationUs;
+        uint64_t allocBytes;
+    };
+
+    struct TimelineFrame
+    {
+        uint64_t number;
+        double startUs;
+        std::vector<TimelineEvent> events;
+    };
+
+    bool running = false;
+    lua_State* mainState = nullptr;
+    lua_Alloc previousAlloc = nullptr;
+    void* previousAllocData = nullptr;
+
+    Clock::time_point startTime;
+    uint64_t frameNumber = 0;
+
+    std::vector<ScopeStats> scopes;
+    std::unordered_map<std::string, size_t> scopeLookup; // script + '\n' + name -> index into scopes
+    std::vector<ActiveScope> scopeStack;
+    std::deque<TimelineFrame> timeline;
+
+    uint64_t allocatedBytes = 0;
+    uint64_t allocationCount = 0;
+    uint64_t sampleCount = 0;
+
+    bool PushScope(const std::string& script, const std::string& name, lua_State* thread);
+    void PopScope();
+    double MicrosecondsSinceStart(Clock::time_point time) const;
+
+    static void* Alloc(void* ud, void* ptr, size_t osize, size_t nsize);
+    static void Hook(lua_State* L, lua_Debug* ar);
+
+    LuaProfiler() = default;
+
+    LuaProfiler(LuaProfiler const&) = delete; // Delete copy constructor
+    void operator=(LuaProfiler const&) = delete; // Delete assignment operator
+};
+
+#endif
@@ -0,0 +1,82 @@
+#pragma once
+
+#ifndef MESH_SHAPE_CACHE_H
+#define MESH_SHAPE_CACHE_H
+
+#include <Jolt/Jolt.h>
+#include <Jolt/Physics/Collision/Shape/Shape.h>
+#include <Jolt/Physics/Collision/Shape/MeshShape.h>
+
+#include <glm/glm.hpp>
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include <unordered_map>
+
+#include <Ice/Rendering/MeshHolder.h>
+#include <Ice/Utils/DerivedDataCache.h>
+
+// Cooks triangle mesh collision shapes once and shares them. Building a MeshShape (the BVH) is the slow part of a
+// MeshCollider, so the shape is built unscaled, kept in memory per unique mesh and stored in the DerivedDataCache
+// (Jolt's binary shape state), the next run just reads it back. Every MeshCollider using the same mesh shares the one
+// shape and gets its own scale through a ScaledShape.
+class MeshShapeCache
+{
+public:
+    static MeshShapeCache& GetInstance()
+    {
+        static MeshShapeCache instance; // Static local variable ensures a single instance
+        return instance;
+    }
+
+    // Set to false to never read/write cooked shapes from the DerivedDataCache (still shared in memory)
+    bool persistToDisk = true;
+
+    // Unscaled shape for one mesh of an OBJ (same mesh order as Renderer::meshHolders), nullptr if it couldnt be made
+    JPH::ShapeRefC GetShape(const std::string& modelPath, int meshIndex = 0);
+    // Unscaled shape for procedural geometry, shared with anything else made from identical vertices / indices
+    JPH::ShapeRefC GetShape(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices);
+
+    // Wraps shape in a ScaledShape, or returns it as is when the scale is 1
+    static JPH::ShapeRefC Scale(const JPH::ShapeRefC& shape, const glm::vec3& scale);
+
+    // Drops the in memory shapes, colliders that already have one keep it alive
+    void Clear();
+
+    // Stats
+    int GetShapeCount();
+    int GetMemoryHits() const { return memoryHits; }
+    int GetDiskHits() const { return diskHits; }
+    int GetCooks() const { return cooks; }
+
+private:
+    // Bump when the cooked format / mesh settings change, old shapes in the DerivedDataCache are then ignored
+    static constexpr uint32_t MESH_SHAPE_COOKER_VERSION = 1;
+
+    std::mutex mutex;
+    std::unordered_map<std::string, JPH::ShapeRefC> shapes; // DerivedDataKey string -> shape
+
+    // Atomic since the disk hit / cook counts are bumped outside the lock by concurrent callers
+    std::atomic<int> memoryHits = 0;
+    std::atomic<int> diskHits = 0;
+    std::atomic<int> cooks = 0;
+
+    DerivedDataKey MakeKey() const;
+    // Looks key up in memory, then on disk, then calls buildTriangles and cooks it
+    JPH::ShapeRefC GetOrCook(const DerivedDataKey& key, const std::function<bool(JPH::TriangleList&)>& buildTriangles);
+    JPH::ShapeRefC Cook(const JPH::TriangleList& triangles);
+    JPH::ShapeRefC LoadCooked(const DerivedDataKey& key);
+    void SaveCooked(const DerivedDataKey& key, const JPH::Shape* shape);
+
+    static void AppendTriangles(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, JPH::TriangleList& outTriangles);
+
+    MeshShapeCache() = default;
+
+    MeshShapeCache(MeshShapeCache const&) = delete; // Delete copy constructor
+    void operator=(MeshShapeCache const&) = delete; // Delete assignment operator
+};
+
+#endif
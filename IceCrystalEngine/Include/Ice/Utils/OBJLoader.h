@@ -17,6 +17,9 @@
 // Math.h - STD math Library
 #include <math.h>
 
+// Files are read through the engine's VFS
+#include <Ice/Utils/VirtualFileSystem.h>
+
 // Print progress to console while loading (large models)
 //#define OBJL_CONSOLE_OUTPUT
 
@@ -435,10 +438,11 @@ namespace objl
 				return false;
 
 
-			std::ifstream file(Path);
-
-			if (!file.is_open())
+			// Read through the VFS so models can come from a .pak
+			FileData fileData = VirtualFileSystem::GetInstance().Read(Path);
+			if (!fileData)
 				return false;
+			MemoryStream file(fileData.View());
 
 			LoadedMeshes.clear();
 			LoadedVertices.clear();
@@ -683,8 +687,6 @@ namespace objl
 				LoadedMeshes.push_back(tempMesh);
 			}
 
-			file.close();
-
 			// Set Materials for each Mesh
 			for (int i = 0; i < MeshMatNames.size(); i++)
 			{
@@ -1009,11 +1011,12 @@ namespace objl
 			if (path.substr(path.size() - 4, path.size()) != ".mtl")
 				return false;
 
-			std::ifstream file(path);
+			FileData fileData = VirtualFileSystem::GetInstance().Read(path);
 
 			// If the file is not found return false
-			if (!file.is_open())
+			if (!fileData)
 				return false;
+			MemoryStream file(fileData.View());
 
 			Material tempMaterial;
 
@@ -0,0 +1,90 @@
+#pragma once
+
+#ifndef PAK_ARCHIVE_H
+#define PAK_ARCHIVE_H
+
+#include <Ice/Utils/VirtualFileSystem.h>
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <memory>
+
+// Read only view of a whole file mapped into memory
+class MappedFile
+{
+public:
+    ~MappedFile();
+
+    // Returns nullptr if the file could not be mapped
+    static std::shared_ptr<MappedFile> Open(const std::string& path);
+
+    const std::byte* Data() const { return data; }
+    size_t Size() const { return size; }
+
+private:
+    MappedFile() = default;
+
+    const std::byte* data = nullptr;
+    size_t size = 0;
+
+#ifdef _WIN32
+    void* fileHandle = nullptr;
+    void* mappingHandle = nullptr;
+#else
+    int fd = -1;
+#endif
+};
+
+// .pak archive, a header, the file blobs (each aligned, optionally LZ4 compressed) and a table of contents at the end.
+// The whole archive is memory mapped, uncompressed files are handed out without copying.
+// Paths inside an archive are relative to the folder it was built from and are case insensitive.
+class PakArchive : public IFileSource
+{
+public:
+    static constexpr char magic[4] = { 'I', 'C', 'P', 'K' };
+    static constexpr uint32_t version = 1;
+
+    enum class Compression : uint32_t
+    {
+        None = 0,
+        LZ4 = 1,
+    };
+
+    struct Header
+    {
+        char magic[4];
+        uint32_t version;
+        uint32_t entryCount;
+        uint32_t alignment;
+        uint64_t tocOffset;
+        uint64_t tocSize;
+    };
+
+    struct Entry
+    {
+        uint64_t offset = 0;
+        uint64_t size = 0; // uncompressed size
+        uint64_t storedSize = 0; // size in the archive
+        Compression compression = Compression::None;
+    };
+
+    bool Open(const std::string& path);
+
+    bool Exists(const std::string& relativePath) const override;
+    FileData Read(const std::string& relativePath) const override;
+
+    size_t GetEntryCount() const { return entries.size(); }
+
+    // Packs every file under sourceDirectory into outputPath.
+    // Files are only stored compressed if it actually saves space (already compressed formats like .png usually dont).
+    static bool Build(const std::string& sourceDirectory, const std::string& outputPath, bool compress = true, uint32_t alignment = 64);
+
+private:
+    std::shared_ptr<MappedFile> mapping;
+    std::unordered_map<std::string, Entry> entries; // lowercase relative path -> entry
+
+    static std::string ToKey(const std::string& relativePath);
+};
+
+#endif
@@ -0,0 +1,60 @@
+#pragma once
+
+#ifndef SNAPSHOT_RING_BUFFER_H
+#define SNAPSHOT_RING_BUFFER_H
+
+#include <cstdint>
+#include <cstddef>
+#include <deque>
+#include <vector>
+
+// Keeps the last few hundred ticks of some state (physics snapshots) in as little memory as possible.
+// Every keyframeInterval ticks the full state is stored (LZ4), the ticks in between only store their XOR against that
+// keyframe (LZ4 again, mostly zeros since only the moving bodies changed). Getting any tick back is one keyframe plus
+// at most one delta, no matter how far back it is.
+class SnapshotRingBuffer
+{
+public:
+    explicit SnapshotRingBuffer(int capacity = 0, int keyframeInterval = 16);
+
+    // Changing these clears the buffer. capacity 0 turns recording off.
+    void Configure(int capacity, int keyframeInterval);
+    bool IsEnabled() const { return capacity > 0; }
+
+    // Ticks go in increasing order, pushing an already recorded tick again replaces it and drops everything after it
+    void Push(uint64_t tick, const std::vector<uint8_t>& state);
+    bool Get(uint64_t tick, std::vector<uint8_t>& outState) const;
+    bool Contains(uint64_t tick) const { return Find(tick) != entries.end(); }
+
+    // Drops every tick after tick, after rolling back to it (they get pushed again as they are resimulated)
+    void DiscardAfter(uint64_t tick);
+    void Clear();
+
+    // Stats
+    int GetCount() const { return static_cast<int>(entries.size()); }
+    uint64_t GetOldestTick() const { return entries.empty() ? 0 : entries.front().tick; }
+    uint64_t GetNewestTick() const { return entries.empty() ? 0 : entries.back().tick; }
+    size_t GetMemoryUsage() const;
+
+private:
+    struct Entry
+    {
+        uint64_t tick;
+        bool keyframe;
+        uint32_t rawSize;
+        std::vector<uint8_t> data; // LZ4, the state itself for keyframes and state ^ keyframe otherwise
+    };
+
+    int capacity = 0;
+    int keyframeInterval = 16;
+    std::deque<Entry> entries;
+
+    // Uncompressed newest keyframe, what the next deltas are made against
+    std::vector<uint8_t> keyframeState;
+    int sinceKeyframe = 0;
+
+    std::deque<Entry>::const_iterator Find(uint64_t tick) const;
+    static bool Decompress(const Entry& entry, std::vector<uint8_t>& outState);
+};
+
+#endif
@@ -0,0 +1,138 @@
+#pragma once
+
+#ifndef VIRTUAL_FILE_SYSTEM_H
+#define VIRTUAL_FILE_SYSTEM_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <span>
+#include <cstddef>
+#include <istream>
+#include <streambuf>
+
+// The contents of a file, either pointing straight into a memory mapped archive or owning its own buffer.
+// Move only, keeps the archive mapped for as long as it is alive.
+class FileData
+{
+public:
+    FileData() = default;
+    FileData(std::vector<std::byte>&& buffer);
+    FileData(const std::byte* data, size_t size, std::shared_ptr<void> keepAlive);
+
+    FileData(FileData&& other) noexcept;
+    FileData& operator=(FileData&& other) noexcept;
+    FileData(const FileData&) = delete;
+    FileData& operator=(const FileData&) = delete;
+
+    std::span<const std::byte> Span() const { return { data, size }; }
+    std::string_view View() const { return { reinterpret_cast<const char*>(data), size }; }
+    const unsigned char* Bytes() const { return reinterpret_cast<const unsigned char*>(data); }
+    size_t Size() const { return size; }
+
+    bool IsValid() const { return valid; }
+    explicit operator bool() const { return valid; }
+
+private:
+    const std::byte* data = nullptr;
+    size_t size = 0;
+    bool valid = false;
+
+    std::vector<std::byte> owned;
+    std::shared_ptr<void> keepAlive; // mapping the data lives in (if it isnt owned)
+};
+
+// std::istream over a block of memory without copying it, for loaders that want a stream
+class MemoryStream : public std::istream
+{
+public:
+    MemoryStream(std::string_view data);
+
+private:
+    class Buffer : public std::streambuf
+    {
+    public:
+        Buffer(std::string_view data);
+    protected:
+        pos_type seekoff(off_type offset, std::ios_base::seekdir dir, std::ios_base::openmode which) override;
+        pos_type seekpos(pos_type position, std::ios_base::openmode which) override;
+    };
+    Buffer buffer;
+};
+
+// Somewhere files can come from (a folder on disk, a .pak archive)
+class IFileSource
+{
+public:
+    virtual ~IFileSource() = default;
+
+    // relativePath is normalized and relative to the mount point
+    virtual bool Exists(const std::string& relativePath) const = 0;
+    virtual FileData Read(const std::string& relativePath) const = 0;
+    // For reading a file a piece at a time (streamed audio). By default this is the whole Read() behind a stream,
+    // sources that can read parts of a file straight from disk override it.
+    virtual std::unique_ptr<std::istream> OpenStream(const std::string& relativePath) const;
+};
+
+// Plain folder on disk
+class DirectorySource : public IFileSource
+{
+public:
+    DirectorySource(const std::string& directory);
+
+    bool Exists(const std::string& relativePath) const override;
+    FileData Read(const std::string& relativePath) const override;
+    std::unique_ptr<std::istream> OpenStream(const std::string& relativePath) const override;
+
+private:
+    std::string directory;
+};
+
+// Every asset load goes through here.
+// Sources are mounted onto a path prefix (usually {ASSET_DIR} or {ENGINE_ASSET_DIR}), anything that isnt covered by a mount
+// (or isnt found in one) is read straight from disk, so absolute paths keep working.
+class VirtualFileSystem
+{
+public:
+    static VirtualFileSystem& GetInstance()
+    {
+        static VirtualFileSystem instance; // Static local variable ensures a single instance
+        return instance;
+    }
+
+    // Check loose files on disk before mounted archives, so edits (and hot reload) work even when a .pak exists
+#ifdef _DEBUG
+    bool preferLooseFiles = true;
+#else
+    bool preferLooseFiles = false;
+#endif
+
+    // Later mounts take priority over earlier ones
+    void Mount(const std::string& mountPoint, std::unique_ptr<IFileSource> source);
+    bool MountArchive(const std::string& mountPoint, const std::string& archivePath);
+    void UnmountAll();
+
+    // Mounts {PROJECT_ROOT}Assets.pak onto {ASSET_DIR} and EngineAssets.pak (next to the executable) onto {ENGINE_ASSET_DIR} if they exist
+    void MountDefaultArchives();
+
+    bool Exists(const std::string& path);
+    FileData Read(const std::string& path);
+    // Same lookup as Read, but loose files are read from disk as the stream is read instead of all at once. nullptr if missing.
+    std::unique_ptr<std::istream> OpenStream(const std::string& path);
+
+private:
+    struct MountPoint
+    {
+        std::string prefix; // normalized, ends with a /
+        std::unique_ptr<IFileSource> source;
+    };
+    std::vector<MountPoint> mounts;
+
+    VirtualFileSystem() = default;
+
+    VirtualFileSystem(VirtualFileSystem const&) = delete; // Delete copy constructor
+    void operator=(VirtualFileSystem const&) = delete; // Delete assignment operator
+};
+
+#endif
@@ -0,0 +1,232 @@
+#include <Ice/Rendering/ShaderPreprocessor.h>
+
+#include <iostream>
+#include <map>
+#include <string>
+
+// Small standalone test runner, ShaderPreprocessor doesnt touch OpenGL so it runs without a window.
+// Files come from an in memory map through the FileReader hook instead of the disk.
+
+static int failures = 0;
+
+#define CHECK(condition) \
+    do { if (!(condition)) { std::cerr << __FILE__ << "(" << __LINE__ << "): CHECK failed: " #condition << std::endl; failures++; } } while (0)
+
+#define CHECK_EQUAL(actual, expected) \
+    do { if (!((actual) == (expected))) { std::cerr << __FILE__ << "(" << __LINE__ << "): CHECK_EQUAL failed: " #actual "\n  expected: " << (expected) << "\n  actual:   " << (actual) << std::endl; failures++; } } while (0)
+
+// Reader over a fixed set of files, records every path it was asked for
+struct MemoryFiles
+{
+    std::map<std::string, std::string> files;
+    std::vector<std::string> requested;
+
+    ShaderPreprocessor::FileReader Reader()
+    {
+        return [this](const std::string& path, std::string& outContents) {
+            requested.push_back(path);
+            auto it = files.find(path);
+            if (it == files.end())
+                return false;
+            outContents = it->second;
+            return true;
+        };
+    }
+};
+
+static void TestIncludeResolution()
+{
+    MemoryFiles files;
+    files.files["Shaders/Common/lighting.glsl"] = "vec3 Light() { return vec3(1.0); }\n";
+    files.files["{ENGINE_ASSET_DIR}/Shaders/noise.glsl"] = "float Noise() { return 0.5; }\n";
+
+    std::string root =
+        "#version 330 core\n"
+        "#include \"Common/lighting.glsl\"\n"
+        "#include <{ENGINE_ASSET_DIR}/Shaders/noise.glsl>\n"
+        "void main() {}\n";
+
+    ShaderPreprocessor::Result result = ShaderPreprocessor::Process(root, "Shaders/lit.frag", {}, {}, files.Reader());
+
+    CHECK(result.success);
+    // Relative includes resolve against the including file, {VARIABLE} paths are used as is
+    CHECK_EQUAL(files.requested.size(), size_t(2));
+    CHECK_EQUAL(files.requested[0], std::string("Shaders/Common/lighting.glsl"));
+    CHECK_EQUAL(files.requested[1], std::string("{ENGINE_ASSET_DIR}/Shaders/noise.glsl"));
+
+    CHECK_EQUAL(result.files.size(), size_t(3));
+    CHECK_EQUAL(result.files[0], std::string("Shaders/lit.frag"));
+    CHECK_EQUAL(result.files[1], std::string("Shaders/Common/lighting.glsl"));
+    CHECK_EQUAL(result.files[2], std::string("{ENGINE_ASSET_DIR}/Shaders/noise.glsl"));
+
+    // Nested includes resolve against the file they are in, not the root
+    MemoryFiles nested;
+    nested.files["Shaders/Common/a.glsl"] = "#include \"b.glsl\"\n";
+    nested.files["Shaders/Common/b.glsl"] = "int b;\n";
+    result = ShaderPreprocessor::Process("#include \"Common/a.glsl\"\n", "Shaders/root.frag", {}, {}, nested.Reader());
+    CHECK(result.success);
+    CHECK_EQUAL(result.files.size(), size_t(3));
+    CHECK_EQUAL(result.files[2], std::string("Shaders/Common/b.glsl"));
+
+    // A missing include fails with the line it is on
+    MemoryFiles missing;
+    result = ShaderPreprocessor::Process("\n#include \"gone.glsl\"\n", "Shaders/root.frag", {}, {}, missing.Reader());
+    CHECK(!result.success);
+    CHECK_EQUAL(result.error, std::string("Shaders/root.frag(2): failed to open include Shaders/gone.glsl"));
+
+    result = ShaderPreprocessor::Process("#include gone.glsl\n", "Shaders/root.frag", {}, {}, missing.Reader());
+    CHECK(!result.success);
+    CHECK_EQUAL(result.error, std::string("Shaders/root.frag(1): malformed #include"));
+}
+
+static void TestIncludeOnce()
+{
+    MemoryFiles files;
+    files.files["Shaders/common.glsl"] = "int shared;\n";
+    files.files["Shaders/a.glsl"] = "#include \"common.glsl\"\nint a;\n";
+
+    std::string root =
+        "#include \"common.glsl\"\n"
+        "#include \"a.glsl\"\n"
+        "#include \"common.glsl\"\n";
+
+    ShaderPreprocessor::Result result = ShaderPreprocessor::Process(root, "Shaders/root.frag", {}, {}, files.Reader());
+
+    CHECK(result.success);
+    CHECK_EQUAL(result.files.size(), size_t(3));
+    // Read once, the second and third #include of it become empty lines
+    CHECK_EQUAL(files.requested.size(), size_t(2));
+    CHECK_EQUAL(result.source,
+        "#line 1 1\n"
+        "int shared;\n"
+        "#line 2 0\n"
+        "#line 1 2\n"
+        "\n"
+        "int a;\n"
+        "#line 3 0\n"
+        "\n");
+}
+
+static void TestIncludeCycles()
+{
+    // A direct cycle is cut by include once, the file that closes the loop is skipped
+    MemoryFiles files;
+    files.files["Shaders/a.glsl"] = "#include \"b.glsl\"\nint a;\n";
+    files.files["Shaders/b.glsl"] = "#include \"a.glsl\"\nint b;\n";
+
+    ShaderPreprocessor::Result result = ShaderPreprocessor::Process("#include \"a.glsl\"\n", "Shaders/root.frag", {}, {}, files.Reader());
+    CHECK(result.success);
+    CHECK_EQUAL(result.files.size(), size_t(3));
+
+    // Paths arent normalized, so a file reaching itself through a different spelling keeps recursing until the depth limit
+    MemoryFiles aliased;
+    std::string path = "Shaders/a.glsl";
+    for (int i = 0; i <= ShaderPreprocessor::maxIncludeDepth + 1; i++)
+    {
+        aliased.files[path] = "#include \"./a.glsl\"\n";
+        path = "Shaders/" + std::string(".") + path.substr(std::string("Shaders").size());
+    }
+
+    result = ShaderPreprocessor::Process("#include \"a.glsl\"\n", "Shaders/root.frag", {}, {}, aliased.Reader());
+    CHECK(!result.success);
+    CHECK(result.error.rfind("Include depth exceeded " + std::to_string(ShaderPreprocessor::maxIncludeDepth), 0) == 0);
+}
+
+static void TestLineRemapping()
+{
+    MemoryFiles files;
+    // Only the root keeps its #version, the include's becomes an empty line
+    files.files["Shaders/common.glsl"] = "#version 330 core\nint common;\n";
+
+    std::string root =
+        "#version 330 core\n"
+        "int before;\n"
+        "#include \"common.glsl\"\n"
+        "int after;\n";
+
+    ShaderPreprocessor::Result result = ShaderPreprocessor::Process(root, "Shaders/root.frag", { "MAX_LIGHTS 4" }, {}, files.Reader());
+
+    CHECK(result.success);
+    // Defines go right after #version, followed by a #line so the root's line numbers are unchanged
+    CHECK_EQUAL(result.source,
+        "#version 330 core\n"
+        "#define MAX_LIGHTS 4\n"
+        "#line 2 0\n"
+        "int before;\n"
+        "#line 1 1\n"
+        "\n"
+        "int common;\n"
+        "#line 4 0\n"
+        "int after;\n");
+
+    // Without a #version the defines go first
+    result = ShaderPreprocessor::Process("int x;\n", "Shaders/root.frag", { "FOO" }, {}, files.Reader());
+    CHECK(result.success);
+    CHECK_EQUAL(result.source, std::string("#define FOO\n#line 1 0\nint x;\n"));
+
+    // Nothing injected, nothing to remap
+    result = ShaderPreprocessor::Process("#version 330 core\nint x;\n", "Shaders/root.frag", {}, {}, files.Reader());
+    CHECK_EQUAL(result.source, std::string("#version 330 core\nint x;\n"));
+
+    // A BOM is stripped before anything else
+    result = ShaderPreprocessor::Process("\xEF\xBB\xBF#version 330 core\n", "Shaders/root.frag", {}, {}, files.Reader());
+    CHECK_EQUAL(result.source, std::string("#version 330 core\n"));
+}
+
+static void TestKeywords()
+{
+    MemoryFiles files;
+    files.files["Shaders/shadows.glsl"] = "#pragma keywords SHADOWS FOG\n";
+
+    std::string root =
+        "#version 330 core\n"
+        "#pragma keywords FOG NORMAL_MAP\n"
+        "#include \"shadows.glsl\"\n"
+        "void main() {}\n";
+
+    // Declared keywords, in order, each once (including ones from includes)
+    ShaderPreprocessor::Result result = ShaderPreprocessor::Process(root, "Shaders/lit.frag", {}, {}, files.Reader());
+    CHECK(result.success);
+    CHECK_EQUAL(result.keywords.size(), size_t(3));
+    CHECK_EQUAL(result.keywords[0], std::string("FOG"));
+    CHECK_EQUAL(result.keywords[1], std::string("NORMAL_MAP"));
+    CHECK_EQUAL(result.keywords[2], std::string("SHADOWS"));
+
+    // Enabled keywords the shader declares are defined, unknown ones are dropped so they dont make extra variants
+    result = ShaderPreprocessor::Process(root, "Shaders/lit.frag", { "QUALITY 2" }, { "SHADOWS", "UNKNOWN", "FOG" }, files.Reader());
+    CHECK(result.success);
+    CHECK_EQUAL(result.source,
+        "#version 330 core\n"
+        "#define QUALITY 2\n"
+        "#define SHADOWS\n"
+        "#define FOG\n"
+        "#line 2 0\n"
+        "\n"
+        "#line 1 1\n"
+        "\n"
+        "#line 4 0\n"
+        "void main() {}\n");
+
+    // Every permutation of the same source expands the same way apart from the injected block
+    result = ShaderPreprocessor::Process(root, "Shaders/lit.frag", {}, { "NORMAL_MAP" }, files.Reader());
+    CHECK(result.source.find("#define NORMAL_MAP\n") != std::string::npos);
+    CHECK(result.source.find("#define FOG") == std::string::npos);
+}
+
+int main()
+{
+    TestIncludeResolution();
+    TestIncludeOnce();
+    TestIncludeCycles();
+    TestLineRemapping();
+    TestKeywords();
+
+    if (failures > 0)
+    {
+        std::cerr << failures << " ShaderPreprocessor check(s) failed" << std::endl;
+        return 1;
+    }
+
+    std::cout << "ShaderPreprocessor tests passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,47 @@
+-- Compares how much the Lua heap grows per frame with the userdata style math / component access
+-- against the flat XYZ getters, in place vec3 ops and typed (cached) component getters.
+-- Put it on any actor with a LuaExecutor, it prints both results once it is done.
+
+local frames = 120
+local iterations = 200
+
+local function measure(name, body)
+    local total = 0
+    for frame = 1, frames do
+        local before = Profiler.GetAllocatedBytes()
+        body()
+        total = total + (Profiler.GetAllocatedBytes() - before)
+        wait_frames(1)
+    end
+    print(name .. ": " .. math.floor(total / frames) .. " bytes allocated per frame")
+end
+
+local wasRunning = Profiler.IsRunning()
+Profiler.Start()
+
+-- Old style, every vec3 result and component lookup is a new userdata
+measure("vec3 userdata", function()
+    for i = 1, iterations do
+        local direction = transform.up * 2 + transform.right
+        local length = vec3.length(direction)
+        local position = transform.position
+        local rb = actor:GetComponent("RigidBody")
+    end
+end)
+
+-- New style, plain numbers and a vec3 that gets reused
+local direction = vec3(0, 0, 0)
+local rb = actor:GetRigidBody()
+measure("flat / in place", function()
+    for i = 1, iterations do
+        local ux, uy, uz = transform:GetUpXYZ()
+        local rx, ry, rz = transform:GetRightXYZ()
+        direction:set(ux * 2 + rx, uy * 2 + ry, uz * 2 + rz)
+        local length = direction:length()
+        local x, y, z = transform:GetPositionXYZ()
+    end
+end)
+
+if not wasRunning then
+    Profiler.Stop()
+end
@@ -0,0 +1,24 @@
+-- Example parallel script, put it on a LuaExecutor with parallel = true.
+-- It runs in a worker state, so only Scene (reads from the frame snapshot) and Commands (queued writes) are available,
+-- actor is just a handle to pass to them.
+
+local speed = 4
+local range = 20
+
+Parallel.Update(function(dt)
+    local x, y, z = Scene.GetPosition(actor)
+    local target, distance = Scene.FindNearestByTag("Player", x, y, z)
+    if target == nil or distance > range or distance < 0.5 then
+        return
+    end
+
+    local tx, ty, tz = Scene.GetPosition(target)
+    local step = speed * dt / distance
+    Commands.Translate(actor, (tx - x) * step, (ty - y) * step, (tz - z) * step)
+    Commands.LookAt(actor, tx, ty, tz)
+
+    if distance < 1 then
+        -- Wakes wait_event("seeker_reached") in the main state
+        Parallel.FireEvent("seeker_reached")
+    end
+end)
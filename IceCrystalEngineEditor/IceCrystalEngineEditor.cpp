@@ -1,7 +1,20 @@
 #include <Ice/Core/Engine.h>
+#include <Ice/Utils/FileUtil.h>
+#include <Ice/Utils/PakArchive.h>
+
+#include <string>
 
 int main(int argc, char* argv[])
 {
+    // "--pack" builds Assets.pak and EngineAssets.pak for shipping instead of running the engine
+    if (argc > 1 && std::string(argv[1]) == "--pack")
+    {
+        FileUtil::InitializeStaticMembers();
+        bool packed = PakArchive::Build(FileUtil::AssetDir, FileUtil::ProjectRoot + "Assets.pak");
+        packed = PakArchive::Build(FileUtil::EngineAssetDir, FileUtil::GetExecutableDir() + "EngineAssets.pak") && packed;
+        return packed ? 0 : 1;
+    }
+
     Engine &engine = Engine::GetInstance();
     engine.Run();
     return 0;
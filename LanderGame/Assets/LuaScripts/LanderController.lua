@@ -3,8 +3,8 @@
 local sceneManager = SceneManager:GetInstance()
 local input = Input:GetInstance()
 
-local rb = actor:GetComponent("RigidBody");
-local light = sceneManager:GetActorByTag("engineLight"):GetComponent("PointLight")
+local rb = actor:GetRigidBody()
+local light = sceneManager:GetActorByTag("engineLight"):GetPointLight()
 
 -- Attitude control settings
 local torqueStrength = 15000
@@ -13,7 +13,8 @@ local engineStrength = 20000
 -- Fuel
 local fuel = 100;
 local fuelBar = sceneManager:GetActorByTag("fuelBarFG")
-local fuelBarStartingScale = fuelBar.transform.scale.x;
+local fuelBarTransform = fuelBar.transform
+local fuelBarStartingScale = fuelBarTransform.scale.x;
 
 local inRefuelZone = false
 rb.OnTriggerEntered = function(other)
@@ -29,17 +30,18 @@ end
 
 -- SAS
 local sasEnabled = false
-local sasToggleImage = sceneManager:GetActorByTag("sasToggleFG"):GetComponent("RawImage")
+local sasToggleImage = sceneManager:GetActorByTag("sasToggleFG"):GetRawImage()
 
 -- Plume
 local enginePlume = sceneManager:GetActorByTag("enginePlume")
+local plumeTransform = enginePlume.transform
 
 function lerp(a, b, t)
     return a + (b - a) * t
 end
 
 -- Sound
-local engineSound = enginePlume:GetComponent("AudioSource")
+local engineSound = enginePlume:GetAudioSource()
 
 -- Cache input state for FixedUpdate
 local isThrusting = false
@@ -68,18 +70,22 @@ RunService.Update(function(dt)
     end
 
     -- Visual feedback (safe to do in Update)
+    -- Flat XYZ getters / setters so none of this makes a vec3 every frame
+    local t = dt * 10
+    local sx, sy, sz = plumeTransform:GetScaleXYZ()
     if isThrusting then
-        light.strength = lerp(light.strength, 1, dt * 10)
-        enginePlume.transform.scale = vec3.lerp(enginePlume.transform.scale, vec3(1, 1, 1), dt * 10)
-        engineSound:SetVolume(lerp(engineSound:GetVolume(), .2, dt * 10))
+        light.strength = lerp(light.strength, 1, t)
+        plumeTransform:SetScale(lerp(sx, 1, t), lerp(sy, 1, t), lerp(sz, 1, t))
+        engineSound:SetVolume(lerp(engineSound:GetVolume(), .2, t))
     else
-        light.strength = lerp(light.strength, 0, dt * 10)
-        enginePlume.transform.scale = vec3.lerp(enginePlume.transform.scale, vec3(1, 0, 1), dt * 10)
-        engineSound:SetVolume(lerp(engineSound:GetVolume(), 0, dt * 10))
+        light.strength = lerp(light.strength, 0, t)
+        plumeTransform:SetScale(lerp(sx, 1, t), lerp(sy, 0, t), lerp(sz, 1, t))
+        engineSound:SetVolume(lerp(engineSound:GetVolume(), 0, t))
     end
     
     -- Update fuel bar UI
-    fuelBar.transform:SetScale(fuelBarStartingScale * (fuel / 100), fuelBar.transform.scale.y, fuelBar.transform.scale.z)
+    local _, barY, barZ = fuelBarTransform:GetScaleXYZ()
+    fuelBarTransform:SetScale(fuelBarStartingScale * (fuel / 100), barY, barZ)
     
     -- Fuel
     if isThrusting then
@@ -92,22 +98,29 @@ end)
 
 -- Handle physics
 RunService.FixedUpdate(function(fixedDt)
+    local ux, uy, uz = transform:GetUpXYZ()
+
     -- Thrust
     if isThrusting then
-        rb:AddForce(transform.up * engineStrength)
+        rb:AddForceXYZ(ux * engineStrength, uy * engineStrength, uz * engineStrength)
     end
 
     -- Calculate torque based on cached input
-    local pitchTorque = transform.right * (-verticalInput * torqueStrength)
-    local rollTorque = transform.forward * (-horizontalInput * torqueStrength)
-    local yawTorque = transform.up * (yawInput * torqueStrength)
-    
+    local pitch = -verticalInput * torqueStrength
+    local roll = -horizontalInput * torqueStrength
+    local yaw = yawInput * torqueStrength
+    local rx, ry, rz = transform:GetRightXYZ()
+    local fx, fy, fz = transform:GetForwardXYZ()
+
     -- Apply combined torque
-    local totalTorque = pitchTorque + rollTorque + yawTorque
-    rb:AddTorque(totalTorque)
+    local tx = rx * pitch + fx * roll + ux * yaw
+    local ty = ry * pitch + fy * roll + uy * yaw
+    local tz = rz * pitch + fz * roll + uz * yaw
+    rb:AddTorqueXYZ(tx, ty, tz)
     
     -- SAS dampening
-    if sasEnabled and vec3.length(totalTorque) < 1 then
-        rb:SetAngularVelocity(rb:GetAngularVelocity() * 0.95)
+    if sasEnabled and tx * tx + ty * ty + tz * tz < 1 then
+        local ax, ay, az = rb:GetAngularVelocityXYZ()
+        rb:SetAngularVelocityXYZ(ax * 0.95, ay * 0.95, az * 0.95)
     end
 end)
\ No newline at end of file
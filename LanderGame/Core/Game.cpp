@@ -28,6 +28,7 @@
 
 #include "Ice/Components/Audio/AudioSource.h"
 #include "Ice/Resources/AudioClip.h"
+#include "Ice/Managers/AudioManager.h"
 
 #ifdef _DEBUG
 #include <Ice/IEditor/EditorUI.h>
@@ -60,7 +61,7 @@ void CreateMoon()
     Renderer* moonRenderer = new Renderer(FileUtil::AssetDir + "Models/moon.obj", moonMaterial);
     moon->AddComponent(moonRenderer);
     moon->transform->scale = glm::vec3(4, 4, 4);
-    moon->AddComponent<MeshCollider>(moonRenderer->meshHolders[0].vertices, moonRenderer->meshHolders[0].indices, moon->transform->scale);
+    moon->AddComponent<MeshCollider>(moonRenderer->ModelPath, moon->transform->scale);
     RigidBody* rb = moon->AddComponent<RigidBody>(0.0f);
 }
 
@@ -119,8 +120,8 @@ void Game::CreateLander()
 
 	// Engine Sound
 	AudioSource* as = enginePlume->AddComponent<AudioSource>();
-	AudioClip* clip = new AudioClip;
-	clip->LoadFromFile(FileUtil::AssetDir + "Sounds/engineLoop.wav");
+	// Decoded in the background while the rest of the world loads, it starts playing once its uploaded
+	AudioClip* clip = AudioManager::GetInstance().LoadClipAsync("engineLoop", FileUtil::AssetDir + "Sounds/engineLoop.wav");
 	as->SetClip(clip);
 	as->SetVolume(0.0f);
 	as->SetMinDistance(5.0f);
@@ -150,7 +151,7 @@ void Game::CreateObject(std::string type, glm::vec3 position, glm::quat rotation
     	Renderer* padRenderer = pad->AddComponent<Renderer>(FileUtil::AssetDir + "Models/pad.obj", mainMaterial);
     	pad->transform->SetPosition(position);
     	pad->transform->SetRotation(rotation);
-    	pad->AddComponent<MeshCollider>(padRenderer->meshHolders[0].vertices, padRenderer->meshHolders[0].indices, pad->transform->scale);
+    	pad->AddComponent<MeshCollider>(padRenderer->ModelPath, pad->transform->scale);
     	pad->AddComponent<RigidBody>(0.0f);
     	// Lights
     	Actor* padLights = new Actor("Pad Lights");
@@ -178,12 +179,11 @@ void Game::CreateObject(std::string type, glm::vec3 position, glm::quat rotation
     	Renderer* baseRenderer = base->AddComponent<Renderer>(FileUtil::AssetDir + "Models/base.obj", mainMaterial);
     	base->transform->SetPosition(position);
     	base->transform->SetRotation(rotation);
-    	base->AddComponent<MeshCollider>(baseRenderer->meshHolders[0].vertices, baseRenderer->meshHolders[0].indices, base->transform->scale);
+    	base->AddComponent<MeshCollider>(baseRenderer->ModelPath, base->transform->scale);
     	base->AddComponent<RigidBody>(0.0f);
 
 		AudioSource* as = base->AddComponent<AudioSource>();
-		AudioClip* clip = new AudioClip;
-		clip->LoadFromFile(FileUtil::AssetDir + "Sounds/kspSpaceThemeKevinMaclead.wav");
+		AudioClip* clip = AudioManager::GetInstance().LoadClip("music", FileUtil::AssetDir + "Sounds/kspSpaceThemeKevinMaclead.wav", true); // streamed, its several minutes long
 		as->SetClip(clip);
 		as->SetVolume(.2f);
 		as->SetMinDistance(5.0f);